@@ -32,6 +32,21 @@ function vim.api.nvim__buf_stats(buffer) end
 --- - bufnr: (number) buffer id in floating window
 function vim.api.nvim__complete_set(index, opts) end
 
+--- EXPERIMENTAL: this API may change in the future.
+---
+--- Gets the time spent in the callbacks of each decoration provider, to find
+--- out which one makes redrawing slow. Times are in nanoseconds.
+---
+--- @return any[] # Array of dictionaries, one for each provider, with these keys:
+---   - ns_id: `namespace` of the provider
+---   - calls: number of callbacks called
+---   - time_total: time spent in all callbacks
+---   - time_last: time spent in callbacks during the last screen redraw
+---   - time_max: longest time spent in callbacks during a screen redraw
+---   - budget: the `budget` given to `nvim_set_decoration_provider()`, or 0
+---   - skipped_lines: `on_line` calls skipped because the budget was used up
+function vim.api.nvim__decoration_provider_stats() end
+
 --- @return string
 function vim.api.nvim__get_lib_dir() end
 
@@ -145,6 +160,20 @@ function vim.api.nvim__screenshot(path) end
 --- @return table<string,any> # Map of various internal stats.
 function vim.api.nvim__stats() end
 
+--- Starts writing a trace of events to a file, like `--trace`.
+---
+--- The trace records the time spent sourcing scripts, running autocommands,
+--- redrawing, in decoration providers, handling RPC requests and in Lua
+--- callbacks. Load it in chrome://tracing or https://ui.perfetto.dev.
+--- A trace which was running is stopped first.
+---
+--- @param file string Path of the file to write, it is overwritten.
+function vim.api.nvim__trace_start(file) end
+
+--- Stops the trace started with `nvim__trace_start()` or `--trace`, and
+--- finishes writing its file.
+function vim.api.nvim__trace_stop() end
+
 --- @param str string
 --- @return any
 function vim.api.nvim__unpack(str) end
@@ -689,6 +718,40 @@ function vim.api.nvim_buf_line_count(buffer) end
 --- @return integer # Id of the created/updated extmark
 function vim.api.nvim_buf_set_extmark(buffer, ns_id, line, col, opts) end
 
+--- Creates many `extmark`s in one call.
+---
+--- Equivalent to calling `nvim_buf_set_extmark()` with `end_row`, `end_col`,
+--- `hl_group` and `priority` for each mark, but much faster when adding a
+--- large number of highlights at once, e.g. for semantic tokens. The marks
+--- are validated first, so either all of them are created or none.
+---
+--- Example:
+---
+--- ```lua
+--- local ns = vim.api.nvim_create_namespace('my_tokens')
+--- -- "Keyword" on row 0, col 0-5 and "String" on row 1, col 2-8
+--- vim.api.nvim_buf_set_extmarks(0, ns, { 0, 0, 0, 5, 1, 2, 1, 8 }, {
+---   hl_group = { 'Keyword', 'String' },
+---   priority = 125,
+--- })
+--- ```
+---
+--- @param buffer integer Buffer id, or 0 for current buffer
+--- @param ns_id integer Namespace id from `nvim_create_namespace()`
+--- @param pos integer[] Positions of the marks, packed as `row, col, end_row, end_col`
+---             for each mark (0-based, like `nvim_buf_set_extmark()`).
+---             Use -1 for `end_row` and `end_col` to not set an end position.
+--- @param opts vim.api.keyset.set_extmarks Optional parameters.
+---               - hl_group : highlight group used for all marks, or a list with
+---                   one highlight group (name or id) per mark.
+---               - priority : priority used for all marks, or a list with one
+---                   priority per mark.
+---               - hl_eol, right_gravity, end_right_gravity, undo_restore,
+---                 invalidate, strict : see `nvim_buf_set_extmark()`. Applies
+---                 to all marks.
+--- @return integer[] # Ids of the created extmarks, in the order of {pos}
+function vim.api.nvim_buf_set_extmarks(buffer, ns_id, pos, opts) end
+
 --- Sets a buffer-local `mapping` for the given mode.
 ---
 ---
@@ -2147,6 +2210,11 @@ function vim.api.nvim_set_current_win(window) end
 ---   ```
 ---     ["end", tick]
 ---   ```
+--- - budget: time in milliseconds the callbacks may take during
+---   a screen redraw. When it is used up, `on_line` is not called
+---   for the remaining lines, which are drawn without the
+---   decorations of this provider and redrawn once more right
+---   after. See `nvim__decoration_provider_stats()`.
 function vim.api.nvim_set_decoration_provider(ns_id, opts) end
 
 --- Sets a highlight group.
@@ -380,6 +380,7 @@ error('Cannot require a meta file')
 --- @field _on_hl_def? fun(_: "hl_def")
 --- @field _on_spell_nav? fun(_: "spell_nav")
 --- @field _on_conceal_line? fun(_: "conceal_line")
+--- @field budget? integer
 
 --- @class vim.api.keyset.set_extmark
 --- @field id? integer
@@ -417,6 +418,16 @@ error('Cannot require a meta file')
 --- @field url? string
 --- @field scoped? boolean
 
+--- @class vim.api.keyset.set_extmarks
+--- @field hl_group? any
+--- @field priority? integer|integer[]
+--- @field hl_eol? boolean
+--- @field invalidate? boolean
+--- @field right_gravity? boolean
+--- @field end_right_gravity? boolean
+--- @field strict? boolean
+--- @field undo_restore? boolean
+
 --- @class vim.api.keyset.user_command
 --- @field addr? any
 --- @field bang? boolean
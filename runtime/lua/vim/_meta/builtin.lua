@@ -75,6 +75,42 @@ vim.NIL = ...
 --- to other restrictions such as |textlock|).
 function vim.in_fast_event() end
 
+--- Gets a read-only view on the lines of a buffer, like |nvim_buf_get_lines()| but without
+--- copying them: a line is only read from the buffer when it is indexed. The view supports:
+---
+--- - `view[i]`: line {i} (1-based), or `nil` if out of range.
+--- - `#view`: the number of lines.
+--- - `view:iter()`: iterates over the index and text of each line, like |ipairs()|.
+--- - `view:find(str, init)`: finds the first line from {init} (default 1) which contains the
+---   plain string {str}, returning the line index and the start and end byte of the match like
+---   |string.find()|, or `nil`.
+---
+--- Using the view after the buffer changed is an error.
+---
+--- Example:
+---
+--- ```lua
+--- local lines = vim.buf_lines(0)
+--- for i, line in lines:iter() do
+---   if line:match('^%s*$') then
+---     print('empty line', i)
+---   end
+--- end
+--- ```
+---
+--- @param bufnr integer Buffer handle, or 0 for current buffer
+--- @param start? integer First line index (zero-based, default 0)
+--- @param end_? integer Last line index, exclusive (default -1). Negative indices are counted
+---   from the end like in |nvim_buf_get_lines()|. Out of range indices are clamped.
+--- @return vim.BufLines
+function vim.buf_lines(bufnr, start, end_) end
+
+--- @nodoc
+--- @class vim.BufLines
+--- @field [integer] string?
+--- @field iter fun(self: vim.BufLines): fun(view: vim.BufLines, i: integer): integer?, string?
+--- @field find fun(self: vim.BufLines, str: string, init?: integer): integer?, integer?, integer?
+
 --- Creates a special empty table (marked with a metatable), which Nvim
 --- converts to an empty dictionary when translating Lua values to Vimscript
 --- or API types. Nvim by default converts an empty table `{}` without this
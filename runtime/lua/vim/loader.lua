@@ -1,17 +1,30 @@
 local fs = vim.fs -- "vim.fs" is a dependency, so must be loaded early.
 local uv = vim.uv
-local uri_encode = vim.uri_encode --- @type function
 
 --- @type (fun(modename: string): fun()|string)[]
 local loaders = package.loaders
 local _loadfile = loadfile
 
-local VERSION = 4
+local VERSION = 5
 
 local M = {}
 
 --- @alias vim.loader.CacheHash {mtime: {nsec: integer, sec: integer}, size: integer, type?: string}
---- @alias vim.loader.CacheEntry {hash:vim.loader.CacheHash, chunk:string}
+
+--- @class (private) vim.loader.PackEntry
+--- @field hash vim.loader.CacheHash
+--- @field offset integer Start of the bytecode in the pack file, starting at 1
+--- @field len integer Length of the bytecode
+--- @field rlen integer Length of the whole record
+--- @field chunk? string Bytecode written after the pack was read
+
+--- @class (private) vim.loader.Pack
+--- @field fd? integer The pack file, kept open to read the bytecode from
+--- @field entries table<string, vim.loader.PackEntry>
+--- @field size integer Size of the pack file
+--- @field live integer Size of the records which are not replaced by later ones
+--- @field broken boolean The pack file ends with an incomplete record
+--- @field failed? true Rewriting the pack failed, nothing is written to it anymore
 
 --- @class vim.loader.find.Opts
 --- @inlinedoc
@@ -112,73 +125,221 @@ local function get_rtp()
   return rtp_cached, updated
 end
 
---- Returns the cache file name
---- @param name string can be a module name, or a file name
---- @return string file_name
-local function cache_filename(name)
-  local ret = ('%s/%s'):format(M.path, uri_encode(name, 'rfc2396'))
-  return ret:sub(-4) == '.lua' and (ret .. 'c') or (ret .. '.luac')
-end
+--- The bytecode of all cached files is kept in a single pack file, which is
+--- indexed once and then only appended to. The bytecode is read from it when
+--- it is loaded. It starts with `PACK_HEADER`, followed
+--- by records of the form
+---
+---     <modpath> \0 <size>,<mtime.sec>,<mtime.nsec>,<bytecode length> \0 <bytecode>
+---
+--- A later record for a path replaces earlier ones. The pack is rewritten
+--- without those when they take up more than half of it.
+local PACK_HEADER = ('nvim luac pack %d\n'):format(VERSION)
 
---- Saves the cache entry for a given module or file
---- @param cname string cache filename
---- @param hash vim.loader.CacheHash
---- @param chunk function
-local function write_cachefile(cname, hash, chunk)
-  local f = assert(uv.fs_open(cname, 'w', 438))
-  local header = {
-    VERSION,
-    hash.size,
-    hash.mtime.sec,
-    hash.mtime.nsec,
-  }
-  uv.fs_write(f, table.concat(header, ',') .. '\0')
-  uv.fs_write(f, string.dump(chunk))
-  uv.fs_close(f)
+--- Size from which a pack file with mostly replaced records is compacted.
+local PACK_COMPACT_SIZE = 1024 * 1024
+
+--- @type vim.loader.Pack?
+local pack
+
+--- @return string
+local function pack_filename()
+  return M.path .. '/pack'
 end
 
---- @param path string
---- @param mode integer
---- @return string? data
-local function readfile(path, mode)
-  local f = uv.fs_open(path, 'r', mode)
-  if f then
-    local size = assert(uv.fs_fstat(f)).size
-    local data = uv.fs_read(f, size, 0)
-    uv.fs_close(f)
-    return data
+--- Reads the pack file and indexes its records.
+--- @return vim.loader.Pack
+local function read_pack()
+  if pack then
+    return pack
+  end
+
+  -- The file stays open, so that the offsets of the records remain valid when another instance
+  -- replaces it.
+  local fd = uv.fs_open(pack_filename(), 'r', 438)
+  local stat = fd and uv.fs_fstat(fd)
+  local data = stat and uv.fs_read(fd, stat.size, 0) or ''
+  pack = { fd = fd, entries = {}, size = 0, live = 0, broken = false }
+  if data:sub(1, #PACK_HEADER) ~= PACK_HEADER then
+    pack.broken = #data > 0
+    return pack
+  end
+
+  local entries = pack.entries
+  local pos = #PACK_HEADER + 1
+  while pos <= #data do
+    if data:sub(pos, pos + #PACK_HEADER - 1) == PACK_HEADER then
+      -- Another instance started the pack while this one was appending to it. The records
+      -- after the second header may be cut off, ignore them.
+      pack.broken = true
+      break
+    end
+    local path_end = data:find('\0', pos, true)
+    local hash_end = path_end and data:find('\0', path_end + 1, true)
+    local hash = hash_end and data:sub(path_end + 1, hash_end - 1) or ''
+    local size, sec, nsec, len = hash:match('^(%d+),(%-?%d+),(%d+),(%d+)$')
+    if not len or hash_end + tonumber(len) > #data then
+      -- Incomplete record, e.g. from a write that was interrupted.
+      pack.broken = true
+      break
+    end
+    local path = data:sub(pos, path_end - 1)
+    local rlen = hash_end + tonumber(len) - pos + 1
+    if entries[path] then
+      pack.live = pack.live - entries[path].rlen
+    end
+    entries[path] = {
+      hash = {
+        size = tonumber(size),
+        mtime = { sec = tonumber(sec), nsec = tonumber(nsec) },
+      },
+      offset = hash_end + 1,
+      len = tonumber(len),
+      rlen = rlen,
+    }
+    pack.live = pack.live + rlen
+    pos = pos + rlen
   end
+  pack.size = pos - 1
+  return pack
 end
 
 --- Loads the cache entry for a given module or file
---- @param cname string cache filename
+--- @param modpath string
 --- @return vim.loader.CacheHash? hash
 --- @return string? chunk
-local function read_cachefile(cname)
-  local data = readfile(cname, 438)
-  if not data then
+local function read_cachefile(modpath)
+  local p = read_pack()
+  local entry = p.entries[modpath]
+  if not entry then
     return
   end
+  if entry.chunk then
+    return entry.hash, entry.chunk
+  end
+  local chunk = p.fd and uv.fs_read(p.fd, entry.len, entry.offset - 1)
+  if chunk and #chunk == entry.len then
+    return entry.hash, chunk
+  end
+end
 
-  local zero = data:find('\0', 1, true)
-  if not zero then
+--- Writes the pack with only the current record of each path, and reindexes it.
+--- @param p vim.loader.Pack
+local function compact_pack(p)
+  local parts = { PACK_HEADER } --- @type string[]
+  local entries = {} --- @type table<string, vim.loader.PackEntry>
+  local size = #PACK_HEADER
+  for path, entry in pairs(p.entries) do
+    local hash, chunk = read_cachefile(path)
+    if not chunk then
+      goto continue
+    end
+    ---@cast hash -nil
+    local header = ('%s\0%d,%d,%d,%d\0'):format(
+      path,
+      hash.size,
+      hash.mtime.sec,
+      hash.mtime.nsec,
+      #chunk
+    )
+    parts[#parts + 1] = header
+    parts[#parts + 1] = chunk
+    entries[path] = {
+      hash = hash,
+      offset = size + #header + 1,
+      len = #chunk,
+      rlen = #header + #chunk,
+    }
+    size = size + #header + #chunk
+    ::continue::
+  end
+  local data = table.concat(parts)
+
+  -- Write to a temporary file first, so that other instances never read a partial pack.
+  local tmpname = ('%s.%d'):format(pack_filename(), uv.os_getpid())
+  local f = uv.fs_open(tmpname, 'w+', 438)
+  local ok = f and uv.fs_write(f, data) == #data
+  if not (ok and uv.fs_rename(tmpname, pack_filename())) then
+    if f then
+      uv.fs_close(f)
+    end
+    uv.fs_unlink(tmpname)
+    -- Don't compact again on every write, or append to a pack which could not be rewritten.
+    p.failed = true
     return
   end
+  ---@cast f -nil
 
-  --- @type integer[]|{[0]:integer}
-  local header = vim.split(data:sub(1, zero - 1), ',')
-  if tonumber(header[1]) ~= VERSION then
-    return
+  if p.fd then
+    uv.fs_close(p.fd)
+  end
+  p.fd = f
+  p.entries = entries
+  p.size = size
+  p.live = size - #PACK_HEADER
+  p.broken = false
+end
+
+--- Removes the cache files of versions before the pack file, which had one file per module.
+local function remove_old_cachefiles()
+  for name, type in fs.dir(M.path) do
+    if type == 'file' and vim.endswith(name, '.luac') then
+      uv.fs_unlink(M.path .. '/' .. name)
+    end
   end
+end
 
-  local hash = {
-    size = tonumber(header[2]),
-    mtime = { sec = tonumber(header[3]), nsec = tonumber(header[4]) },
+--- Saves the cache entry for a given module or file
+--- @param modpath string
+--- @param hash vim.loader.CacheHash
+--- @param chunk function
+local function write_cachefile(modpath, hash, chunk)
+  local p = read_pack()
+  if p.failed then
+    return
+  end
+  local bytecode = string.dump(chunk)
+  local header = ('%s\0%d,%d,%d,%d\0'):format(
+    modpath,
+    hash.size,
+    hash.mtime.sec,
+    hash.mtime.nsec,
+    #bytecode
+  )
+  local old = p.entries[modpath]
+  p.entries[modpath] = {
+    hash = {
+      size = hash.size,
+      mtime = { sec = hash.mtime.sec, nsec = hash.mtime.nsec },
+    },
+    offset = 0,
+    len = #bytecode,
+    rlen = #header + #bytecode,
+    chunk = bytecode,
   }
+  p.live = p.live - (old and old.rlen or 0) + #header + #bytecode
 
-  local chunk = data:sub(zero + 1)
+  if p.broken or (p.size > PACK_COMPACT_SIZE and p.live * 2 < p.size) then
+    compact_pack(p)
+    return
+  end
 
-  return hash, chunk
+  local f = uv.fs_open(pack_filename(), 'a', 438)
+  if not f then
+    return
+  end
+  -- The pack may have been created by another instance since it was read.
+  local stat = uv.fs_fstat(f)
+  local new = stat ~= nil and stat.size == 0
+  -- A single write, so that records of other instances appending to the same
+  -- pack are not interleaved with this one.
+  local record = (new and PACK_HEADER or '') .. header .. bytecode
+  local ok = uv.fs_write(f, record) == #record
+  uv.fs_close(f)
+  p.size = p.size + #record
+  if new and ok then
+    remove_old_cachefiles()
+  end
 end
 
 --- The `package.loaders` loader for Lua files using the cache.
@@ -243,9 +404,8 @@ end
 local function loadfile_cached(filename, mode, env)
   local modpath = normalize(filename)
   local stat = fs_stat_cached(modpath)
-  local cname = cache_filename(modpath)
   if stat then
-    local e_hash, e_chunk = read_cachefile(cname)
+    local e_hash, e_chunk = read_cachefile(modpath)
     if hash_eq(e_hash, stat) and e_chunk then
       -- found in cache and up to date
       local chunk, err = load(e_chunk, '@' .. modpath, mode, env)
@@ -257,7 +417,7 @@ local function loadfile_cached(filename, mode, env)
 
   local chunk, err = _loadfile(modpath, mode, env)
   if chunk and stat then
-    write_cachefile(cname, stat, chunk)
+    write_cachefile(modpath, stat, chunk)
   end
   return chunk, err
 end
@@ -476,6 +636,7 @@ end
 --- @param opts vim.loader._profile.Opts?
 function M._profile(opts)
   get_rtp = track('get_rtp', get_rtp)
+  read_pack = track('read_pack', read_pack)
   read_cachefile = track('read', read_cachefile)
   loader_cached = track('loader', loader_cached)
   loader_lib_cached = track('loader_lib', loader_lib_cached)
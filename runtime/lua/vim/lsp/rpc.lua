@@ -321,13 +321,8 @@ end
 -- them with an error then, perhaps.
 
 --- @package
---- @param body string
-function Client:handle_body(body)
-  local ok, decoded = pcall(vim.json.decode, body, { luanil = { object = true } })
-  if not ok then
-    self:on_error(M.client_errors.INVALID_SERVER_JSON, decoded)
-    return
-  end
+--- @param decoded any The decoded body of a message
+function Client:handle_message(decoded)
   log.debug('rpc.receive', decoded)
 
   if type(decoded) ~= 'table' then
@@ -535,16 +530,25 @@ end
 --- @param client vim.lsp.rpc.Client
 --- @param on_exit? fun()
 local function create_client_read_loop(client, on_exit)
-  --- @param body string
-  local function handle_body(body)
-    client:handle_body(body)
-  end
+  -- Splits the messages and decodes them in C, large messages on a worker thread.
+  local reader = vim._jsonrpc_reader(function(decoded, err)
+    if err then
+      client:on_error(M.client_errors.INVALID_SERVER_JSON, err)
+    else
+      client:handle_message(decoded)
+    end
+  end, { luanil = { object = true } })
 
-  local function on_error(err)
-    client:on_error(M.client_errors.READ_ERROR, err)
+  return function(err, chunk)
+    if err then
+      client:on_error(M.client_errors.READ_ERROR, err)
+    elseif chunk then
+      reader:feed(chunk)
+    elseif on_exit then
+      -- messages still being decoded are delivered first
+      reader:finish(on_exit)
+    end
   end
-
-  return M.create_read_loop(handle_body, on_exit, on_error)
 end
 
 --- Create a LSP RPC client factory that connects to either:
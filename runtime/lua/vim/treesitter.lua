@@ -238,13 +238,31 @@ function M.get_node_text(node, source, opts)
 
   if metadata.text then
     return metadata.text
-  elseif type(source) == 'number' then
+  elseif type(source) == 'number' and (metadata.range or metadata.offset) then
     local range = M.get_range(node, source, metadata)
     return buf_range_get_text(source, range)
   end
 
-  ---@cast source string
-  return source:sub(select(3, node:start()) + 1, select(3, node:end_()))
+  return node:text(source)
+end
+
+--- Gets the ranges of a list of nodes as one flat list, without creating a table per node.
+---
+--- Example:
+---
+--- ```lua
+--- local ranges = vim.treesitter.get_node_ranges(nodes)
+--- for i = 1, #ranges, 4 do
+---   local start_row, start_col, end_row, end_col = unpack(ranges, i, i + 3)
+--- end
+--- ```
+---
+---@param nodes TSNode[]
+---@param include_bytes boolean? Include the start and end byte of each node.
+---@return integer[] ranges Four values per node (six with {include_bytes}), in the order
+---        returned by |TSNode:range()|.
+function M.get_node_ranges(nodes, include_bytes)
+  return vim._ts_get_node_ranges(nodes, include_bytes == true)
 end
 
 --- Determines whether (line, col) position is in node range
@@ -5,12 +5,13 @@ local Range = require('vim.treesitter._range')
 local api = vim.api
 
 ---Treesitter folding is done in two steps:
----(1) compute the fold levels with the syntax tree and cache the result (`compute_folds_levels`)
----(2) evaluate foldexpr for each window, which reads from the cache (`foldupdate`)
+---(1) compute the fold levels with the syntax tree and store them in the buffer
+---    (`compute_folds_levels`)
+---(2) update the folds of each window (`foldupdate`). The first evaluation of foldexpr in a window
+---    attaches it to the fold levels of the buffer, which are then read without evaluating foldexpr.
 ---@class TS.FoldInfo
 ---
----@field levels string[] the cached foldexpr result for each line
----@field levels0 integer[] the cached raw fold levels
+---@field bufnr integer
 ---
 ---The range edited since the last invocation of the callback scheduled in on_bytes.
 ---Should compute fold levels in this range.
@@ -28,9 +29,9 @@ FoldInfo.__index = FoldInfo
 ---@private
 ---@param bufnr integer
 function FoldInfo.new(bufnr)
+  vim._fold_levels_reset(bufnr, true)
   return setmetatable({
-    levels0 = {},
-    levels = {},
+    bufnr = bufnr,
     parser = ts.get_parser(bufnr, nil, { error = false }),
   }, FoldInfo)
 end
@@ -39,16 +40,14 @@ end
 ---@param srow integer
 ---@param erow integer 0-indexed, exclusive
 function FoldInfo:remove_range(srow, erow)
-  vim._list_remove(self.levels, srow + 1, erow)
-  vim._list_remove(self.levels0, srow + 1, erow)
+  vim._fold_levels_splice(self.bufnr, srow, erow - srow, 0)
 end
 
 ---@package
 ---@param srow integer
 ---@param erow integer 0-indexed, exclusive
 function FoldInfo:add_range(srow, erow)
-  vim._list_insert(self.levels, srow + 1, erow, -1)
-  vim._list_insert(self.levels0, srow + 1, erow, -1)
+  vim._fold_levels_splice(self.bufnr, srow, 0, erow - srow)
 end
 
 ---@param range Range2
@@ -63,6 +62,41 @@ local function edit_range(range, srow, erow_old, erow_new)
   range[2] = math.max(range[2], erow_new)
 end
 
+---@type table<integer,TS.FoldInfo>
+local foldinfos = {}
+
+---@type table<vim.treesitter.Query,[boolean,boolean]>
+local query_in_c = setmetatable({}, { __mode = 'k' })
+
+--- Whether the folds of {query} can be counted in C: its predicates are evaluated by the query
+--- cursor and no directive changes the range of a capture.
+---@param query vim.treesitter.Query
+---@return boolean
+local function counts_in_c(query)
+  local native_predicates = ts.query._has_native_predicates()
+  local cached = query_in_c[query]
+  if cached and cached[1] == native_predicates then
+    return cached[2]
+  end
+
+  local result = true
+  for pattern_i in pairs(query.info.patterns) do
+    local metadata = query:_static_metadata(pattern_i, native_predicates)
+    if not metadata then
+      result = false
+      break
+    end
+    for _, v in pairs(metadata) do
+      if type(v) == 'table' and v.range then
+        result = false
+      end
+    end
+  end
+
+  query_in_c[query] = { native_predicates, result }
+  return result
+end
+
 -- TODO(lewis6991): Setup a decor provider so injections folds can be parsed
 -- as the window is redrawn
 ---@param bufnr integer
@@ -88,14 +122,11 @@ local function compute_folds_levels(bufnr, info, srow, erow, callback)
   end
 
   parser:parse(nil, function(_, trees)
-    if not trees then
+    if not trees or foldinfos[bufnr] ~= info then
       return
     end
 
-    local enter_counts = {} ---@type table<integer, integer>
-    local leave_counts = {} ---@type table<integer, integer>
-    local prev_start = -1
-    local prev_stop = -1
+    local folds = vim._create_ts_folds(bufnr, srow, erow, vim.wo.foldminlines)
 
     parser:for_each_tree(function(tree, ltree)
       local query = ts.query.get(ltree:lang(), 'folds')
@@ -103,92 +134,28 @@ local function compute_folds_levels(bufnr, info, srow, erow, callback)
         return
       end
 
+      if counts_in_c(query) then
+        folds:add_matches(tree:root(), query.query)
+        return
+      end
+
       -- Collect folds starting from srow - 1, because we should first subtract the folds that end at
       -- srow - 1 from the level of srow - 1 to get accurate level of srow.
       for _, match, metadata in query:iter_matches(tree:root(), bufnr, math.max(srow - 1, 0), erow) do
         for id, nodes in pairs(match) do
           if query.captures[id] == 'fold' then
-            local range = ts.get_range(nodes[1], bufnr, metadata[id])
-            local start, _, stop, stop_col = Range.unpack4(range)
-
-            if #nodes > 1 then
-              -- assumes nodes are ordered by range
-              local end_range = ts.get_range(nodes[#nodes], bufnr, metadata[id])
-              local _, _, end_stop, end_stop_col = Range.unpack4(end_range)
-              stop = end_stop
-              stop_col = end_stop_col
-            end
-
-            if stop_col == 0 then
-              stop = stop - 1
-            end
-
-            local fold_length = stop - start + 1
-
-            -- Fold only multiline nodes that are not exactly the same as previously met folds
-            -- Checking against just the previously found fold is sufficient if nodes
-            -- are returned in preorder or postorder when traversing tree
-            if
-              fold_length > vim.wo.foldminlines and not (start == prev_start and stop == prev_stop)
-            then
-              enter_counts[start + 1] = (enter_counts[start + 1] or 0) + 1
-              leave_counts[stop + 1] = (leave_counts[stop + 1] or 0) + 1
-              prev_start = start
-              prev_stop = stop
-            end
+            local start = ts.get_range(nodes[1], bufnr, metadata[id])[1]
+            -- assumes nodes are ordered by range
+            local end_range = ts.get_range(nodes[#nodes], bufnr, metadata[id])
+            local _, _, stop, stop_col = Range.unpack4(end_range)
+            folds:add(start, stop, stop_col)
           end
         end
       end
     end)
 
-    local nestmax = vim.wo.foldnestmax
-    local level0_prev = info.levels0[srow] or 0
-    local leave_prev = leave_counts[srow] or 0
-
-    -- We now have the list of fold opening and closing, fill the gaps and mark where fold start
-    for lnum = srow + 1, erow do
-      local enter_line = enter_counts[lnum] or 0
-      local leave_line = leave_counts[lnum] or 0
-      local level0 = level0_prev - leave_prev + enter_line
-
-      -- Determine if it's the start/end of a fold
-      -- NB: vim's fold-expr interface does not have a mechanism to indicate that
-      -- two (or more) folds start at this line, so it cannot distinguish between
-      --  ( \n ( \n )) \n (( \n ) \n )
-      -- versus
-      --  ( \n ( \n ) \n ( \n ) \n )
-      -- Both are represented by ['>1', '>2', '2', '>2', '2', '1'], and
-      -- vim interprets as the second case.
-      -- If it did have such a mechanism, (clamped - clamped_prev)
-      -- would be the correct number of starts to pass on.
-      local adjusted = level0 ---@type integer
-      local prefix = ''
-      if enter_line > 0 then
-        prefix = '>'
-        if leave_line > 0 then
-          -- If this line ends a fold f1 and starts a fold f2, then move f1's end to the previous line
-          -- so that f2 gets the correct level on this line. This may reduce the size of f1 below
-          -- foldminlines, but we don't handle it for simplicity.
-          --- @type integer avoid flaky error
-          adjusted = level0 - leave_line
-          leave_line = 0
-        end
-      end
-
-      -- Clamp at foldnestmax.
-      local clamped = adjusted
-      if adjusted > nestmax then
-        prefix = ''
-        clamped = nestmax
-      end
-
-      -- Record the "real" level, so that it can be used as "base" of later compute_folds_levels().
-      info.levels0[lnum] = adjusted
-      info.levels[lnum] = prefix .. tostring(clamped)
-
-      leave_prev = leave_line
-      level0_prev = adjusted
-    end
+    -- Fills the gaps between the fold openings and closings, see fold_levels_set().
+    folds:apply()
 
     if callback then
       callback()
@@ -198,9 +165,6 @@ end
 
 local M = {}
 
----@type table<integer,TS.FoldInfo>
-local foldinfos = {}
-
 local group = api.nvim_create_augroup('nvim.treesitter.fold', {})
 
 --- Update the folds in the windows that contain the buffer and use expr foldmethod (assuming that
@@ -381,6 +345,17 @@ local function on_bytes(bufnr, start_row, start_col, old_row, old_col, new_row,
   end
 end
 
+local FOLDEXPR = 'v:lua.vim.treesitter.foldexpr()'
+
+--- Stops reading the fold levels of {bufnr} instead of evaluating foldexpr, so that the next
+--- evaluation sets up folding again.
+---@param bufnr integer
+local function detach(bufnr)
+  if api.nvim_buf_is_valid(bufnr) then
+    vim._fold_levels_reset(bufnr, false)
+  end
+end
+
 ---@param lnum integer|nil
 ---@return string
 function M.foldexpr(lnum)
@@ -394,6 +369,7 @@ function M.foldexpr(lnum)
       once = true,
       callback = function()
         foldinfos[bufnr] = nil
+        detach(bufnr)
       end,
     })
 
@@ -415,11 +391,14 @@ function M.foldexpr(lnum)
 
       on_detach = function()
         foldinfos[bufnr] = nil
+        detach(bufnr)
       end,
     })
   end
 
-  return foldinfos[bufnr].levels[lnum] or '0'
+  -- Attach the window only if its foldexpr is exactly this function, not an expression that
+  -- uses its result.
+  return vim._fold_level(lnum, vim.trim(vim.wo.foldexpr) == FOLDEXPR)
 end
 
 api.nvim_create_autocmd('OptionSet', {
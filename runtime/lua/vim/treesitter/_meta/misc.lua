@@ -6,6 +6,7 @@ error('Cannot require a meta file')
 
 ---@class TSParser: userdata
 ---@field parse fun(self: TSParser, tree: TSTree?, source: integer|string, include_bytes: boolean, timeout_ns: integer?): TSTree?, (Range4|Range6)[]
+---@field _parse_async fun(self: TSParser, tree: TSTree?, source: integer, include_bytes: boolean, callback: fun(tree: TSTree?, changes: (Range4|Range6)[]?)): boolean
 ---@field reset fun(self: TSParser)
 ---@field included_ranges fun(self: TSParser, include_bytes: boolean?): integer[]
 ---@field set_included_ranges fun(self: TSParser, ranges: (Range6|TSNode)[])
@@ -37,6 +38,10 @@ vim._ts_inspect_language = function(lang) end
 ---@return integer
 vim._ts_get_language_version = function() end
 
+--- @param lang string
+--- @return string
+vim._ts_language_fingerprint = function(lang) end
+
 --- @param path string
 --- @param lang string
 --- @param symbol_name? string
@@ -49,6 +54,11 @@ vim._ts_add_language_from_wasm = function(path, lang) end
 ---@return integer
 vim._ts_get_minimum_language_version = function() end
 
+---@param nodes TSNode[]
+---@param include_bytes boolean
+---@return integer[]
+vim._ts_get_node_ranges = function(nodes, include_bytes) end
+
 ---@param lang string Language to use for the query
 ---@param query string Query string in s-expr syntax
 ---@return TSQuery
@@ -82,6 +92,36 @@ function TSQueryCursor:next_match() end
 --- @param query TSQuery
 --- @param start integer?
 --- @param stop integer?
---- @param opts? { max_start_depth?: integer, match_limit?: integer}
+--- @param opts? { max_start_depth?: integer, match_limit?: integer, source?: integer|string }
 --- @return TSQueryCursor
 function vim._create_ts_querycursor(node, query, start, stop, opts) end
+
+--- @class TSQueryHighlighter: userdata
+local TSQueryHighlighter = {} -- luacheck: no unused
+
+--- @param start integer
+function TSQueryHighlighter:exec(start) end
+
+--- @param line integer
+--- @param next_row integer
+--- @param on_spell boolean
+--- @param on_conceal boolean
+--- @param on_capture fun(capture: integer, node: TSNode, match: TSQueryMatch, line: integer, on_spell: boolean, on_conceal: boolean): integer?
+--- @return integer next_row
+function TSQueryHighlighter:on_line(line, next_row, on_spell, on_conceal, on_capture) end
+
+--- @param line integer
+--- @param start_row integer
+--- @param start_col integer
+--- @param end_row integer
+--- @param end_col integer
+--- @param opts { hl_group: integer, priority: integer, conceal: string?, spell: boolean?, url: string? }
+function TSQueryHighlighter:add_mark(line, start_row, start_col, end_row, end_col, opts) end
+
+--- @param node TSNode
+--- @param query TSQuery
+--- @param buf integer
+--- @param ns integer
+--- @param program table
+--- @return TSQueryHighlighter
+function vim._create_ts_highlighter(node, query, buf, ns, program) end
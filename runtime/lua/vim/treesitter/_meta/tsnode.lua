@@ -192,3 +192,9 @@ function TSNode:equal(node) end
 --- Return the number of bytes spanned by this node.
 --- @return integer
 function TSNode:byte_length() end
+
+--- Get the text of the node from {source}, like |vim.treesitter.get_node_text()| without
+--- metadata. A node that ends at column zero ends on the previous line.
+--- @param source integer|string Buffer (0 for the current buffer) or string the node was parsed from
+--- @return string
+function TSNode:text(source) end
@@ -18,6 +18,12 @@ local TSQuery = {} -- luacheck: no unused
 ---@return TSQueryInfo
 function TSQuery:inspect() end
 
+--- Get the builtin predicates which query cursors evaluate when given a source,
+--- by pattern and predicate index.
+---@nodoc
+---@return table<integer,table<integer,true>>
+function TSQuery:_compiled_predicates() end
+
 --- Disable a specific capture in this query; once disabled the capture cannot be re-enabled.
 --- {capture_name} should not include a leading "@".
 ---
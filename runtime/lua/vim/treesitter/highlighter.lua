@@ -4,12 +4,11 @@ local Range = require('vim.treesitter._range')
 
 local ns = api.nvim_create_namespace('nvim.treesitter.highlighter')
 
----@alias vim.treesitter.highlighter.Iter fun(end_line: integer|nil): integer, TSNode, vim.treesitter.query.TSMetadata, TSQueryMatch
-
 ---@class (private) vim.treesitter.highlighter.Query
 ---@field private _query vim.treesitter.Query?
 ---@field private lang string
 ---@field private hl_cache table<integer,integer>
+---@field private _program table?
 local TSHighlighterQuery = {}
 TSHighlighterQuery.__index = TSHighlighterQuery
 
@@ -52,14 +51,188 @@ function TSHighlighterQuery:query()
   return self._query
 end
 
----@alias MarkInfo { start_line: integer, start_col: integer, opts: vim.api.keyset.set_extmark }
+--- @param capture_name string
+--- @return boolean?, integer
+local function get_spell(capture_name)
+  if capture_name == 'spell' then
+    return true, 0
+  elseif capture_name == 'nospell' then
+    -- Give nospell a higher priority so it always overrides spell captures.
+    return false, 1
+  end
+  return nil, 0
+end
+
+--- Returns the description of the query used by `vim._create_ts_highlighter()`.
+---
+--- Captures of patterns whose metadata is the same for every match are highlighted in C. Patterns
+--- with predicates, other directives or metadata which the C highlighter does not know about are
+--- handled by the Lua callback. Builtin predicates are evaluated in C unless they were overridden.
+---@package
+---@return table
+function TSHighlighterQuery:program()
+  local native_predicates = vim.treesitter.query._has_native_predicates()
+  if self._program and self._program.predicates == native_predicates then
+    return self._program
+  end
+
+  local q = self._query
+  local hl = {} ---@type table<integer,integer>
+  local spell = {} ---@type table<integer,boolean>
+  for capture, name in ipairs(q.captures) do
+    hl[capture] = self:get_hl_from_capture(capture)
+    spell[capture] = get_spell(name)
+  end
+
+  local patterns = {} ---@type table<integer,table|false>
+  for pattern_i in pairs(q.info.patterns) do
+    local metadata = q:_static_metadata(pattern_i, native_predicates)
+    local native = metadata ~= nil
+    for k, v in pairs(metadata or {}) do
+      if
+        type(k) ~= 'string'
+        or (k == 'priority' and tonumber(v) == nil)
+        or (k == 'conceal' and type(v) ~= 'string')
+        or (k == 'url' and type(v) ~= 'string')
+        or k == 'conceal_lines'
+      then
+        native = false
+      end
+    end
+    patterns[pattern_i] = native
+        and {
+          priority = metadata.priority and tonumber(metadata.priority),
+          conceal = metadata.conceal,
+          url = metadata.url,
+        }
+      or false
+  end
+
+  self._program = {
+    hl = hl,
+    spell = spell,
+    priority = vim.hl.priorities.treesitter,
+    patterns = patterns,
+    predicates = native_predicates,
+  }
+  return self._program
+end
 
 ---@class (private) vim.treesitter.highlighter.State
 ---@field tstree TSTree
 ---@field next_row integer
----@field iter vim.treesitter.highlighter.Iter?
+--- Whether the query cursor of `highlighter` was started.
+---@field active boolean
+---@field highlighter TSQueryHighlighter
 ---@field highlighter_query vim.treesitter.highlighter.Query
----@field prev_marks MarkInfo[]
+--- Whether `highlighter` evaluates the builtin predicates.
+---@field native_predicates boolean
+--- Metadata of the matches handled in Lua, by match id.
+---@field match_cache table<integer, vim.treesitter.query.TSMetadata>
+--- Included ranges of `tstree`, only computed for captures handled in Lua.
+---@field regions Range6[]?
+---@field on_capture fun(capture: integer, node: TSNode, match: TSQueryMatch, line: integer, on_spell: boolean, on_conceal: boolean): integer?
+
+--- @param match TSQueryMatch
+--- @param bufnr integer
+--- @param capture integer
+--- @param metadata vim.treesitter.query.TSMetadata
+--- @return string?
+local function get_url(match, bufnr, capture, metadata)
+  ---@type string|number|nil
+  local url = metadata[capture] and metadata[capture].url
+
+  if not url or type(url) == 'string' then
+    return url
+  end
+
+  local captures = match:captures()
+
+  if not captures[url] then
+    return
+  end
+
+  -- Assume there is only one matching node. If there is more than one, take the URL
+  -- from the first.
+  local other_node = captures[url][1]
+
+  return vim.treesitter.get_node_text(other_node, bufnr, {
+    metadata = metadata[url],
+  })
+end
+
+--- Handles a capture of a pattern which the C highlighter leaves to Lua.
+---
+---@param state vim.treesitter.highlighter.State
+---@param buf integer
+---@param capture integer
+---@param node TSNode
+---@param match TSQueryMatch
+---@param line integer
+---@param on_spell boolean
+---@param on_conceal boolean
+---@return integer? start row of the capture, nil if the match was rejected
+local function on_capture(state, buf, capture, node, match, line, on_spell, on_conceal)
+  local hl_query = state.highlighter_query
+  local match_id = match:info()
+  local metadata = state.match_cache[match_id]
+  if not metadata then
+    metadata = hl_query:query():_match_metadata(match, buf, state.native_predicates)
+    if not metadata then
+      return nil
+    end
+    state.match_cache[match_id] = metadata
+  end
+
+  local outer_range = vim.treesitter.get_range(node, buf, metadata[capture])
+
+  state.regions = state.regions or state.tstree:included_ranges(true)
+  for _, range in ipairs(state.regions) do
+    local intersection = Range.intersection(range, outer_range)
+    if intersection then
+      local start_row, start_col, end_row, end_col = Range.unpack4(intersection)
+
+      local hl = hl_query:get_hl_from_capture(capture)
+
+      local capture_name = hl_query:query().captures[capture]
+
+      local spell, spell_pri_offset = get_spell(capture_name)
+
+      -- The "priority" attribute can be set at the pattern level or on a particular capture
+      local priority = (
+        tonumber(metadata.priority or metadata[capture] and metadata[capture].priority)
+        or vim.hl.priorities.treesitter
+      ) + spell_pri_offset
+
+      -- The "conceal" attribute can be set at the pattern level or on a particular capture
+      local conceal = metadata.conceal or metadata[capture] and metadata[capture].conceal
+
+      local url = get_url(match, buf, capture, metadata)
+
+      if hl and end_row >= line and not on_conceal and (not on_spell or spell ~= nil) then
+        state.highlighter:add_mark(line, start_row, start_col, end_row, end_col, {
+          hl_group = hl,
+          priority = priority,
+          conceal = conceal,
+          spell = spell,
+          url = url,
+        })
+      end
+
+      if
+        (metadata.conceal_lines or metadata[capture] and metadata[capture].conceal_lines)
+        and #api.nvim_buf_get_extmarks(buf, ns, { start_row, 0 }, { start_row, 0 }, {}) == 0
+      then
+        api.nvim_buf_set_extmark(buf, ns, start_row, 0, {
+          end_line = end_row,
+          conceal_lines = '',
+        })
+      end
+    end
+  end
+
+  return outer_range[1]
+end
 
 ---@nodoc
 ---@class vim.treesitter.highlighter
@@ -227,13 +400,26 @@ function TSHighlighter:prepare_highlight_states(win, srow, erow)
 
     -- _highlight_states should be a list so that the highlights are added in the same order as
     -- for_each_tree traversal. This ensures that parents' highlight don't override children's.
-    table.insert(self._highlight_states[win], {
+    local program = hl_query:program()
+    local state = {
       tstree = tstree,
       next_row = 0,
-      iter = nil,
+      active = false,
+      highlighter = vim._create_ts_highlighter(
+        root_node,
+        hl_query:query().query,
+        self.bufnr,
+        ns,
+        program
+      ),
       highlighter_query = hl_query,
-      prev_marks = {},
-    })
+      native_predicates = program.predicates,
+      match_cache = {},
+    }
+    state.on_capture = function(...)
+      return on_capture(state, self.bufnr, ...)
+    end
+    table.insert(self._highlight_states[win], state)
   end)
 end
 
@@ -284,82 +470,12 @@ function TSHighlighter:get_query(lang)
   return self._queries[lang]
 end
 
---- @param match TSQueryMatch
---- @param bufnr integer
---- @param capture integer
---- @param metadata vim.treesitter.query.TSMetadata
---- @return string?
-local function get_url(match, bufnr, capture, metadata)
-  ---@type string|number|nil
-  local url = metadata[capture] and metadata[capture].url
-
-  if not url or type(url) == 'string' then
-    return url
-  end
-
-  local captures = match:captures()
-
-  if not captures[url] then
-    return
-  end
-
-  -- Assume there is only one matching node. If there is more than one, take the URL
-  -- from the first.
-  local other_node = captures[url][1]
-
-  return vim.treesitter.get_node_text(other_node, bufnr, {
-    metadata = metadata[url],
-  })
-end
-
---- @param capture_name string
---- @return boolean?, integer
-local function get_spell(capture_name)
-  if capture_name == 'spell' then
-    return true, 0
-  elseif capture_name == 'nospell' then
-    -- Give nospell a higher priority so it always overrides spell captures.
-    return false, 1
-  end
-  return nil, 0
-end
-
----Adds the mark to the buffer, clipped by the line.
----Queues the remainder if the mark continues after the line.
----@param m MarkInfo
----@param buf integer
----@param line integer
----@param next_marks MarkInfo[]
-local function add_mark(m, buf, line, next_marks)
-  local cur_start_l = m.start_line
-  local cur_start_c = m.start_col
-  if cur_start_l < line then
-    cur_start_l = line
-    cur_start_c = 0
-  end
-
-  local cur_opts = m.opts
-  if cur_opts.end_line >= line + 1 then
-    cur_opts = vim.deepcopy(cur_opts, true)
-    cur_opts.end_line = line + 1
-    cur_opts.end_col = 0
-    table.insert(next_marks, m)
-  end
-
-  local empty = cur_opts.end_line < cur_start_l
-    or (cur_opts.end_line == cur_start_l and cur_opts.end_col <= cur_start_c)
-  if cur_start_l <= line and not empty then
-    api.nvim_buf_set_extmark(buf, ns, cur_start_l, cur_start_c, cur_opts)
-  end
-end
-
 ---@param self vim.treesitter.highlighter
 ---@param win integer
----@param buf integer
 ---@param line integer
 ---@param on_spell boolean
 ---@param on_conceal boolean
-local function on_line_impl(self, win, buf, line, on_spell, on_conceal)
+local function on_line_impl(self, win, line, on_spell, on_conceal)
   self._conceal_checked[line] = self._conceal_line and true or nil
   self:for_each_highlight_state(win, function(state)
     local root_node = state.tstree:root()
@@ -370,91 +486,18 @@ local function on_line_impl(self, win, buf, line, on_spell, on_conceal)
       return
     end
 
-    local tree_region = state.tstree:included_ranges(true)
-
-    local next_marks = {}
-
-    for _, mark in ipairs(state.prev_marks) do
-      add_mark(mark, buf, line, next_marks)
-    end
-
-    if state.iter == nil or state.next_row < line then
+    if not state.active or state.next_row < line then
       -- Mainly used to skip over folds
 
-      -- TODO(lewis6991): Creating a new iterator loses the cached predicate results for query
-      -- matches. Move this logic inside iter_captures() so we can maintain the cache.
-      state.iter =
-        state.highlighter_query:query():iter_captures(root_node, self.bufnr, line, root_end_row + 1)
-    end
-
-    local captures = state.highlighter_query:query().captures
-
-    while line >= state.next_row do
-      local capture, node, metadata, match = state.iter(line)
-
-      local outer_range = { root_end_row + 1, 0, root_end_row + 1, 0 }
-      if node then
-        outer_range = vim.treesitter.get_range(node, buf, metadata and metadata[capture])
-      end
-      local outer_range_start_row = outer_range[1]
-
-      for _, range in ipairs(tree_region) do
-        local intersection = Range.intersection(range, outer_range)
-        if intersection then
-          local start_row, start_col, end_row, end_col = Range.unpack4(intersection)
-
-          if capture then
-            local hl = state.highlighter_query:get_hl_from_capture(capture)
-
-            local capture_name = captures[capture]
-
-            local spell, spell_pri_offset = get_spell(capture_name)
-
-            -- The "priority" attribute can be set at the pattern level or on a particular capture
-            local priority = (
-              tonumber(metadata.priority or metadata[capture] and metadata[capture].priority)
-              or vim.hl.priorities.treesitter
-            ) + spell_pri_offset
-
-            -- The "conceal" attribute can be set at the pattern level or on a particular capture
-            local conceal = metadata.conceal or metadata[capture] and metadata[capture].conceal
-
-            local url = get_url(match, buf, capture, metadata)
-
-            if hl and end_row >= line and not on_conceal and (not on_spell or spell ~= nil) then
-              local opts = {
-                end_line = end_row,
-                end_col = end_col,
-                hl_group = hl,
-                ephemeral = true,
-                priority = priority,
-                conceal = conceal,
-                spell = spell,
-                url = url,
-              }
-              local mark = { start_line = start_row, start_col = start_col, opts = opts }
-              add_mark(mark, buf, line, next_marks)
-            end
-
-            if
-              (metadata.conceal_lines or metadata[capture] and metadata[capture].conceal_lines)
-              and #api.nvim_buf_get_extmarks(buf, ns, { start_row, 0 }, { start_row, 0 }, {}) == 0
-            then
-              api.nvim_buf_set_extmark(buf, ns, start_row, 0, {
-                end_line = end_row,
-                conceal_lines = '',
-              })
-            end
-          end
-        end
-      end
-
-      if outer_range_start_row > line then
-        state.next_row = outer_range_start_row
-      end
+      -- TODO(lewis6991): Restarting the cursor loses the cached predicate results for query
+      -- matches.
+      state.highlighter:exec(line)
+      state.match_cache = {}
+      state.active = true
     end
 
-    state.prev_marks = next_marks
+    state.next_row =
+      state.highlighter:on_line(line, state.next_row, on_spell, on_conceal, state.on_capture)
   end)
 end
 
@@ -468,7 +511,7 @@ function TSHighlighter._on_line(_, win, buf, line, _)
     return
   end
 
-  on_line_impl(self, win, buf, line, false, false)
+  on_line_impl(self, win, line, false, false)
 end
 
 ---@private
@@ -488,7 +531,7 @@ function TSHighlighter._on_spell_nav(_, win, buf, srow, _, erow, _)
   self:prepare_highlight_states(win, srow, erow)
 
   for row = srow, erow do
-    on_line_impl(self, win, buf, row, true, false)
+    on_line_impl(self, win, row, true, false)
   end
   self._highlight_states[win] = highlight_states
 end
@@ -507,7 +550,7 @@ function TSHighlighter._on_conceal_line(_, win, buf, row)
   local highlight_states = self._highlight_states[win]
   self.tree:parse({ row, row })
   self:prepare_highlight_states(win, row, row)
-  on_line_impl(self, win, buf, row, false, true)
+  on_line_impl(self, win, row, false, true)
   self._highlight_states[win] = highlight_states
 end
 
@@ -541,7 +584,7 @@ function TSHighlighter._on_win(_, win, buf, topline, botline)
       --
       -- Currently this is not possible because the parser discards previously parsed injection
       -- trees upon parsing a different region.
-      state.iter = nil
+      state.active = false
       state.next_row = 0
     end)
   end
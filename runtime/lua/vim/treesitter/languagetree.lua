@@ -48,6 +48,19 @@ local hrtime = vim.uv.hrtime
 -- Parse in 3ms chunks.
 local default_parse_timeout_ns = 3 * 1000000
 
+-- Background parses run on the libuv threadpool. Only this many are started at once, the other
+-- regions wait in `background_queue`, so that the parses don't hold up other work on the pool.
+local max_background_jobs = tonumber(vim.uv.os_getenv('UV_THREADPOOL_SIZE')) or 4
+
+-- Parsers kept per LanguageTree for parsing regions in the background.
+local max_idle_parsers = max_background_jobs
+
+-- Number of background parses running on the threadpool.
+local background_running = 0
+
+---@type { first: integer, last: integer, [integer]: vim.treesitter.languagetree.BackgroundParse }
+local background_queue = { first = 1, last = 0 }
+
 ---@type Range2
 local entire_document_range = {
   0,
@@ -68,7 +81,12 @@ local entire_document_range = {
 ---| 'on_child_added'
 ---| 'on_child_removed'
 
----@alias ParserThreadState { timeout: integer? }
+---@class ParserThreadState
+---@field timeout? integer
+---Resumes the parse after a background parse is done. Set when parsing in the background.
+---@field background? fun()
+---Whether the parse is suspended waiting for a background parse.
+---@field waiting? boolean
 
 --- @type table<TSCallbackNameOn,TSCallbackName>
 local TSCallbackNames = {
@@ -85,6 +103,9 @@ local TSCallbackNames = {
 ---@field package _callbacks_rec table<TSCallbackName,function[]> Callback handlers (recursive)
 ---@field private _children table<string,vim.treesitter.LanguageTree> Injected languages
 ---@field private _injection_query vim.treesitter.Query Queries defining injected languages
+---Injections found in each tree by a full scan, keyed like _trees. Updated on edits, so that a
+---rescan only needs to query the rows that changed.
+---@field private _injection_cache table<integer, vim.treesitter.languagetree.InjectionCache>
 ---@field private _processed_injection_range Range? Range for which injections have been processed
 ---@field private _opts table Options
 ---@field private _parser TSParser Parser for language
@@ -105,6 +126,10 @@ local TSCallbackNames = {
 ---@field private _valid_regions table<integer,true> Set of valid region IDs.
 ---@field private _num_valid_regions integer Number of valid regions
 ---@field private _is_entirely_valid boolean Whether the entire tree (excluding children) is valid.
+---Parses of regions running on worker threads, by region index.
+---@field private _background_jobs table<integer, vim.treesitter.languagetree.BackgroundParse>
+---@field private _idle_parsers TSParser[] Parsers for background parses which are not in use
+---@field private _no_background? true Set if the language can't be parsed in the background
 ---@field private _logger? fun(logtype: string, msg: string)
 ---@field private _logfile? file*
 local LanguageTree = {}
@@ -146,11 +171,14 @@ function LanguageTree.new(source, lang, opts)
     _injection_query = injections[lang] and query.parse(lang, injections[lang])
       or query.get(lang, 'injections'),
     _processed_injection_range = nil,
+    _injection_cache = {},
     _valid_regions = {},
     _num_valid_regions = 0,
     _num_regions = 1,
     _is_entirely_valid = false,
     _parser = vim._create_ts_parser(lang),
+    _background_jobs = {},
+    _idle_parsers = {},
     _ranges_being_parsed = {},
     _cb_queues = {},
     _callbacks = {},
@@ -200,7 +228,10 @@ function LanguageTree:_set_logger()
 
   local log_lex = vim.g.__ts_debug >= 3
   local log_parse = vim.g.__ts_debug >= 2
-  self._parser:_set_logger(log_lex, log_parse, self._logger)
+  -- A parser with a logger can't parse in the background.
+  if log_lex or log_parse then
+    self._parser:_set_logger(log_lex, log_parse, self._logger)
+  end
 end
 
 ---Measure execution time of a function, in nanoseconds.
@@ -258,6 +289,11 @@ function LanguageTree:invalidate(reload)
   self._valid_regions = {}
   self._num_valid_regions = 0
   self._is_entirely_valid = false
+  self._injection_cache = {}
+  for _, job in pairs(self._background_jobs) do
+    job.dropped = true
+  end
+  self._background_jobs = {}
   self._parser:reset()
 
   -- buffer was reloaded, reparse all trees
@@ -315,6 +351,124 @@ local function intercepts_region(region, range)
   return false
 end
 
+---@nodoc
+---@class vim.treesitter.languagetree.BackgroundParse
+---@field old_tree TSTree? Tree of the region when the parse was started
+---@field waiters table<fun(), true> Functions to call when the parse is done
+---@field result? { tree: TSTree?, changes: Range6[]? } Empty if the parse was not run
+---@field start fun(): boolean Starts the parse on the threadpool
+---@field dropped? true Set when the LanguageTree no longer needs the result
+
+---@nodoc
+---@class vim.treesitter.languagetree.CachedInjection
+---@field pattern integer
+---@field lang string
+---@field combined boolean
+---@field ranges Range6[] Content ranges, not clipped to the parent region
+---@field extent Range6 Range spanning the captured nodes and the content ranges
+
+---@nodoc
+---@class vim.treesitter.languagetree.InjectionCache
+---@field injections vim.treesitter.languagetree.CachedInjection[] Ordered by start of extent
+---Rows whose injections must be queried again, in the coordinates of the current tree.
+---@field dirty? [integer, integer]
+
+---@nodoc
+---@class vim.treesitter.languagetree.Edit
+---@field start_byte integer
+---@field end_byte_old integer
+---@field end_byte_new integer
+---@field start_row integer
+---@field end_row_old integer
+---@field end_col_old integer
+---@field end_row_new integer
+---@field end_col_new integer
+
+--- @param cache vim.treesitter.languagetree.InjectionCache
+--- @param start_row integer
+--- @param end_row integer
+local function mark_rows_dirty(cache, start_row, end_row)
+  local dirty = cache.dirty
+  if dirty then
+    cache.dirty = { math.min(dirty[1], start_row), math.max(dirty[2], end_row) }
+  else
+    cache.dirty = { start_row, end_row }
+  end
+end
+
+--- Maps a row from before {edit} to after it. Rows inside the edited text map into the new text.
+--- @param row integer
+--- @param edit vim.treesitter.languagetree.Edit
+--- @return integer
+local function edit_row(row, edit)
+  if row > edit.end_row_old then
+    return row + edit.end_row_new - edit.end_row_old
+  end
+  return math.min(row, edit.end_row_new)
+end
+
+--- Moves a range that starts after the old end of {edit}.
+--- @param range Range6
+--- @param edit vim.treesitter.languagetree.Edit
+--- @return Range6
+local function shift_range(range, edit)
+  local srow, scol, sbyte, erow, ecol, ebyte = Range.unpack6(range)
+  if srow == edit.end_row_old then
+    scol = scol + edit.end_col_new - edit.end_col_old
+  end
+  if erow == edit.end_row_old then
+    ecol = ecol + edit.end_col_new - edit.end_col_old
+  end
+  local drow = edit.end_row_new - edit.end_row_old
+  local dbyte = edit.end_byte_new - edit.end_byte_old
+  return { srow + drow, scol, sbyte + dbyte, erow + drow, ecol, ebyte + dbyte }
+end
+
+--- Updates cached injections for {edit}: injections after the edit are moved, and the ones
+--- touching it are dropped and their rows marked for a rescan.
+--- @param cache vim.treesitter.languagetree.InjectionCache
+--- @param edit vim.treesitter.languagetree.Edit
+local function edit_injection_cache(cache, edit)
+  local dirty = cache.dirty
+  cache.dirty = nil
+  if dirty then
+    mark_rows_dirty(cache, edit_row(dirty[1], edit), edit_row(dirty[2], edit))
+  end
+  mark_rows_dirty(cache, edit.start_row, edit.end_row_new)
+
+  local injections = {} ---@type vim.treesitter.languagetree.CachedInjection[]
+  for _, injection in ipairs(cache.injections) do
+    local extent = injection.extent
+    if extent[6] < edit.start_byte then
+      injections[#injections + 1] = injection
+    elseif extent[3] > edit.end_byte_old then
+      local ranges = {} ---@type Range6[]
+      for i, range in ipairs(injection.ranges) do
+        ranges[i] = shift_range(range, edit)
+      end
+      injections[#injections + 1] = {
+        pattern = injection.pattern,
+        lang = injection.lang,
+        combined = injection.combined,
+        ranges = ranges,
+        extent = shift_range(extent, edit),
+      }
+    else
+      mark_rows_dirty(cache, edit_row(extent[1], edit), edit_row(extent[4], edit))
+    end
+  end
+  cache.injections = injections
+end
+
+--- Whether a match spanning {extent} is returned by a query over rows {start_row}..{end_row}.
+--- @param extent Range6
+--- @param start_row integer
+--- @param end_row integer
+--- @return boolean
+local function extent_in_rows(extent, start_row, end_row)
+  return extent[1] <= end_row and Range.cmp_pos.gt(extent[4], extent[5], start_row, 0)
+end
+
 --- Returns whether this LanguageTree is valid, i.e., |LanguageTree:trees()| reflects the latest
 --- state of the source. If invalid, user should call |LanguageTree:parse()|.
 ---@param exclude_children boolean? whether to ignore the validity of children (default `false`)
@@ -382,31 +536,21 @@ function LanguageTree:_parse_regions(range, thread_state)
   local no_regions_parsed = 0
   local total_parse_time = 0
 
+  if thread_state.background then
+    self:_start_background_parses(range)
+  end
+
   -- If there are no ranges, set to an empty list
   -- so the included ranges in the parser are cleared.
   for i, ranges in pairs(self:included_regions()) do
-    if
-      not self._valid_regions[i]
-      and (
-        intercepts_region(ranges, range)
-        or (self._trees[i] and intercepts_region(self._trees[i]:included_ranges(false), range))
-      )
-    then
-      self._parser:set_included_ranges(ranges)
-
-      local parse_time, tree, tree_changes = tcall(
-        self._parser.parse,
-        self._parser,
-        self._trees[i],
-        self._source,
-        true,
-        thread_state.timeout
-      )
-      while true do
-        if tree then
-          break
-        end
-        coroutine.yield(self._trees, false)
+    if self:_region_needs_parse(i, ranges, range) then
+      local parse_time, tree, tree_changes = 0, nil, nil
+      if thread_state.background then
+        tree, tree_changes = self:_parse_region_background(i, ranges, thread_state)
+      end
+
+      if not tree then
+        self._parser:set_included_ranges(ranges)
 
         parse_time, tree, tree_changes = tcall(
           self._parser.parse,
@@ -416,6 +560,21 @@ function LanguageTree:_parse_regions(range, thread_state)
           true,
           thread_state.timeout
         )
+        while true do
+          if tree then
+            break
+          end
+          coroutine.yield(self._trees, false)
+
+          parse_time, tree, tree_changes = tcall(
+            self._parser.parse,
+            self._parser,
+            self._trees[i],
+            self._source,
+            true,
+            thread_state.timeout
+          )
+        end
       end
 
       self:_subtract_time(thread_state, parse_time)
@@ -424,10 +583,20 @@ function LanguageTree:_parse_regions(range, thread_state)
       self._trees[i] = tree
       vim.list_extend(changes, tree_changes)
 
+      local cache = self._injection_cache[i]
+      if cache then
+        for _, change in ipairs(tree_changes) do
+          mark_rows_dirty(cache, change[1], change[4])
+        end
+      end
+
       total_parse_time = total_parse_time + parse_time
       no_regions_parsed = no_regions_parsed + 1
-      self._valid_regions[i] = true
-      self._num_valid_regions = self._num_valid_regions + 1
+      -- the region can have been parsed synchronously while this parse was suspended
+      if not self._valid_regions[i] then
+        self._valid_regions[i] = true
+        self._num_valid_regions = self._num_valid_regions + 1
+      end
 
       if self._num_valid_regions == self._num_regions then
         self._is_entirely_valid = true
@@ -438,6 +607,149 @@ function LanguageTree:_parse_regions(range, thread_state)
   return changes, no_regions_parsed, total_parse_time
 end
 
+--- @private
+--- @param i integer
+--- @param ranges Range6[]
+--- @param range boolean|Range?
+--- @return boolean
+function LanguageTree:_region_needs_parse(i, ranges, range)
+  return not self._valid_regions[i]
+    and (
+      intercepts_region(ranges, range)
+      or (self._trees[i] and intercepts_region(self._trees[i]:included_ranges(false), range))
+    )
+end
+
+--- @param job vim.treesitter.languagetree.BackgroundParse
+local function resume_background_waiters(job)
+  for resume in pairs(job.waiters) do
+    resume()
+  end
+end
+
+--- Starts queued background parses while there are free threads in the pool.
+local function run_background_queue()
+  local queue = background_queue
+  while background_running < max_background_jobs and queue.first <= queue.last do
+    local job = queue[queue.first]
+    queue[queue.first] = nil
+    queue.first = queue.first + 1
+    if job.dropped or not job.start() then
+      -- The waiting parse starts a new job or parses the region itself.
+      job.result = {}
+      resume_background_waiters(job)
+    end
+  end
+end
+
+--- Starts parsing region {i} on a worker thread, with a parser of its own so that it runs in
+--- parallel with the other regions. If the threadpool is busy with other background parses, the
+--- parse is queued.
+---
+--- @private
+--- @param i integer
+--- @param ranges Range6[]
+--- @return vim.treesitter.languagetree.BackgroundParse? job `nil` if this parser can't parse in
+--- the background
+function LanguageTree:_start_background_parse(i, ranges)
+  -- The logger is set on the main parser only.
+  if self._no_background or self._parser:_logger() then
+    return nil
+  end
+
+  --- @type vim.treesitter.languagetree.BackgroundParse
+  local job = { old_tree = self._trees[i], waiters = {} }
+  job.start = function()
+    local parser = table.remove(self._idle_parsers) or vim._create_ts_parser(self._lang)
+    parser:set_included_ranges(ranges)
+    local started = parser:_parse_async(job.old_tree, self._source, true, function(tree, changes)
+      background_running = background_running - 1
+      if #self._idle_parsers < max_idle_parsers then
+        table.insert(self._idle_parsers, parser)
+      end
+      job.result = { tree = tree, changes = changes }
+      run_background_queue()
+      resume_background_waiters(job)
+    end)
+    if started then
+      background_running = background_running + 1
+    else
+      self._no_background = true
+    end
+    return started
+  end
+
+  if background_running < max_background_jobs then
+    if not job.start() then
+      return nil
+    end
+  else
+    background_queue.last = background_queue.last + 1
+    background_queue[background_queue.last] = job
+  end
+
+  if self._background_jobs[i] then
+    self._background_jobs[i].dropped = true
+  end
+  self._background_jobs[i] = job
+  return job
+end
+
+--- Starts background parses of all the regions in {range} which need to be parsed, so that
+--- they are parsed in parallel instead of one after the other.
+---
+--- @private
+--- @param range boolean|Range?
+function LanguageTree:_start_background_parses(range)
+  for i, ranges in pairs(self:included_regions()) do
+    local job = self._background_jobs[i]
+    if
+      (not job or job.old_tree ~= self._trees[i])
+      and self:_region_needs_parse(i, ranges, range)
+      and not self:_start_background_parse(i, ranges)
+    then
+      return
+    end
+  end
+end
+
+--- Parses region {i} on a worker thread, suspending the parse until it is done.
+---
+--- @private
+--- @param i integer
+--- @param ranges Range6[]
+--- @param thread_state ParserThreadState
+--- @return TSTree? tree `nil` if this parser can't parse in the background
+--- @return Range6[]? changes
+function LanguageTree:_parse_region_background(i, ranges, thread_state)
+  while true do
+    local job = self._background_jobs[i]
+    if not job or job.old_tree ~= self._trees[i] then
+      job = self:_start_background_parse(i, ranges)
+      if not job then
+        return nil
+      end
+    end
+
+    while not job.result do
+      job.waiters[thread_state.background] = true
+      thread_state.waiting = true
+      coroutine.yield(self._trees, false)
+    end
+
+    if self._valid_regions[i] then
+      -- parsed synchronously in the meantime
+      return self._trees[i], {}
+    end
+
+    -- Otherwise the region was edited or replaced while parsing, and the result is outdated.
+    if self._background_jobs[i] == job and self._trees[i] == job.old_tree then
+      self._background_jobs[i] = nil
+      return job.result.tree, job.result.changes
+    end
+  end
+end
+
 --- @private
 --- @param injections_by_lang table<string, Range6[][]>
 function LanguageTree:_add_injections(injections_by_lang)
@@ -543,12 +855,21 @@ function LanguageTree:_async_parse(range, on_parse)
     end
 
     thread_state.timeout = not vim.g._ts_force_sync_parsing and default_parse_timeout_ns or nil
+    thread_state.background = is_buffer_parser
+        and vim.g._ts_background_parsing
+        and not vim.g._ts_force_sync_parsing
+        and step
+      or nil
+    thread_state.waiting = false
     local parse_time, trees, finished = tcall(parse, self, range, thread_state)
     total_parse_time = total_parse_time + parse_time
 
     if finished then
       self:_run_async_callbacks(range, nil, trees)
       return trees
+    elseif thread_state.waiting then
+      -- step() is called again when the background parse is done
+      return nil
     elseif total_parse_time > redrawtime then
       self:_run_async_callbacks(range, 'TIMEOUT', nil)
       return nil
@@ -580,6 +901,9 @@ end
 ---
 ---     If parsing was still able to finish synchronously (within 3ms), `parse()` returns the list
 ---     of trees. Otherwise, it returns `nil`.
+---
+---     When `vim.g._ts_background_parsing` is set, buffers are instead parsed on a worker thread
+---     from a copy of the buffer text, so that the editor doesn't wait for the parse.
 --- @return table<integer, TSTree>?
 function LanguageTree:parse(range, on_parse)
   if on_parse then
@@ -649,6 +973,13 @@ function LanguageTree:_parse(range, thread_state)
     range = range,
   })
 
+  if thread_state.background then
+    -- Parse the injected languages in parallel rather than one after the other.
+    for _, child in pairs(self._children) do
+      child:_start_background_parses(range)
+    end
+  end
+
   for _, child in pairs(self._children) do
     child:_parse(range, thread_state)
   end
@@ -725,6 +1056,9 @@ end
 --- `remove_child` must be called on the parent to remove it.
 function LanguageTree:destroy()
   -- Cleanup here
+  for _, job in pairs(self._background_jobs) do
+    job.dropped = true
+  end
   for _, child in pairs(self._children) do
     child:destroy()
   end
@@ -776,6 +1110,16 @@ function LanguageTree:_iter_regions(fn)
   self._is_entirely_valid = all_valid
 end
 
+---@param region Range6[]
+---@return string
+local function region_key(region)
+  local parts = {} ---@type string[]
+  for i, range in ipairs(region) do
+    parts[i] = table.concat(range, ',', 1, 6)
+  end
+  return table.concat(parts, ';')
+end
+
 --- Sets the included regions that should be parsed by this |LanguageTree|.
 --- A region is a set of nodes and/or ranges that will be parsed in the same context.
 ---
@@ -805,23 +1149,82 @@ function LanguageTree:set_included_regions(new_regions)
     end
   end
 
-  -- included_regions is not guaranteed to be list-like, but this is still sound, i.e. if
-  -- new_regions is different from included_regions, then outdated regions in included_regions are
-  -- invalidated. For example, if included_regions = new_regions ++ hole ++ outdated_regions, then
-  -- outdated_regions is invalidated by _iter_regions in else branch.
-  if #self:included_regions() ~= #new_regions then
-    -- TODO(lewis6991): inefficient; invalidate trees incrementally
-    for _, t in pairs(self._trees) do
+  -- Regions are matched to the old ones by their ranges, so that inserting or removing an
+  -- injection only reparses the regions that changed, whatever their index.
+  local old_trees = self._trees
+  local old_valid = self._valid_regions
+  local old_cache = self._injection_cache
+  local old_jobs = self._background_jobs
+  local old_indices = {} ---@type table<string,integer[]>
+  for i, region in pairs(self:included_regions()) do
+    local key = region_key(region)
+    old_indices[key] = old_indices[key] or {}
+    table.insert(old_indices[key], i)
+  end
+
+  local trees = {} ---@type table<integer, TSTree>
+  local valid = {} ---@type table<integer,true>
+  local cache = {} ---@type table<integer, vim.treesitter.languagetree.InjectionCache>
+  local jobs = {} ---@type table<integer, vim.treesitter.languagetree.BackgroundParse>
+  local used = {} ---@type table<integer,true>
+  local num_valid = 0
+  local changed = false
+  local added = {} ---@type integer[]
+
+  for i, region in ipairs(new_regions) do
+    local indices = old_indices[region_key(region)]
+    local j = indices and table.remove(indices, 1)
+    if j then
+      used[j] = true
+      trees[i] = old_trees[j]
+      cache[i] = old_cache[j]
+      jobs[i] = old_jobs[j]
+      if old_valid[j] then
+        valid[i] = true
+        num_valid = num_valid + 1
+      end
+      changed = changed or i ~= j
+    else
+      added[#added + 1] = i
+    end
+  end
+
+  for _, i in ipairs(added) do
+    -- Start from the tree that was at this index, so that e.g. an edited region is parsed
+    -- incrementally.
+    if old_trees[i] and not used[i] then
+      used[i] = true
+      trees[i] = old_trees[i]
+    end
+    changed = true
+  end
+
+  for j, t in pairs(old_trees) do
+    if not used[j] then
       self:_do_callback('changedtree', t:included_ranges(true), t)
+      changed = true
     end
-    self._trees = {}
-    self:invalidate()
-  else
-    self:_iter_regions(function(i, region)
-      return vim.deep_equal(new_regions[i], region)
-    end)
   end
 
+  if changed then
+    self._parser:reset()
+    -- Injections of regions that moved or were dropped must be updated in the children.
+    self._processed_injection_range = nil
+  end
+
+  for _, job in pairs(old_jobs) do
+    job.dropped = true
+  end
+  for _, job in pairs(jobs) do
+    job.dropped = nil
+  end
+
+  self._trees = trees
+  self._valid_regions = valid
+  self._num_valid_regions = num_valid
+  self._injection_cache = cache
+  self._background_jobs = jobs
+  self._is_entirely_valid = num_valid == #new_regions
   self._regions = new_regions
   self._num_regions = #new_regions
 end
@@ -991,9 +1394,10 @@ end
 --- https://tree-sitter.github.io/tree-sitter/syntax-highlighting#language-injection
 ---@param match table<integer,TSNode[]>
 ---@param metadata vim.treesitter.query.TSMetadata
----@return string?, boolean, Range6[]
+---@return string?, boolean, Range6[], Range6? extent nil if the match captured no nodes
 function LanguageTree:_get_injection(match, metadata)
   local ranges = {} ---@type Range6[]
+  local extent ---@type Range6?
   local combined = metadata['injection.combined'] ~= nil
   local injection_lang = metadata['injection.language'] --[[@as string?]]
   local lang = metadata['injection.self'] ~= nil and self:lang()
@@ -1001,8 +1405,23 @@ function LanguageTree:_get_injection(match, metadata)
     or (injection_lang and resolve_lang(injection_lang))
   local include_children = metadata['injection.include-children'] ~= nil
 
+  ---@param range Range6
+  local function extend(range)
+    if not extent then
+      extent = { Range.unpack6(range) }
+      return
+    end
+    if range[3] < extent[3] then
+      extent[1], extent[2], extent[3] = range[1], range[2], range[3]
+    end
+    if range[6] > extent[6] then
+      extent[4], extent[5], extent[6] = range[4], range[5], range[6]
+    end
+  end
+
   for id, nodes in pairs(match) do
     for _, node in ipairs(nodes) do
+      extend({ node:range(true) })
       local name = self._injection_query.captures[id]
       -- Lang should override any other language tag
       if name == 'injection.language' then
@@ -1015,12 +1434,13 @@ function LanguageTree:_get_injection(match, metadata)
       elseif name == 'injection.content' then
         for _, range in ipairs(get_node_ranges(node, self._source, metadata[id], include_children)) do
           ranges[#ranges + 1] = range
+          extend(range)
         end
       end
     end
   end
 
-  return lang, combined, ranges
+  return lang, combined, ranges, extent
 end
 
 --- Gets language injection regions by language.
@@ -1049,29 +1469,37 @@ function LanguageTree:_get_injections(range, thread_state)
   for tree_index, tree in pairs(self._trees) do
     ---@type vim.treesitter.languagetree.Injection
     local injections = {}
-    local root_node = tree:root()
     local parent_ranges = self._regions and self._regions[tree_index] or nil
-    local start_line, end_line ---@type integer, integer
+
     if full_scan then
-      start_line, _, end_line = root_node:range()
+      for _, injection in ipairs(self:_scan_injections(tree_index, tree, thread_state)) do
+        add_injection(
+          injections,
+          injection.pattern,
+          injection.lang,
+          injection.combined,
+          injection.ranges,
+          parent_ranges,
+          result
+        )
+      end
     else
-      start_line, _, end_line = Range.unpack4(range --[[@as Range]])
-    end
+      local start_line, _, end_line = Range.unpack4(range --[[@as Range]])
+      for pattern, match, metadata in
+        self._injection_query:iter_matches(tree:root(), self._source, start_line, end_line + 1)
+      do
+        local lang, combined, ranges = self:_get_injection(match, metadata)
+        if lang then
+          add_injection(injections, pattern, lang, combined, ranges, parent_ranges, result)
+        else
+          self:_log('match from injection query failed for pattern', pattern)
+        end
 
-    for pattern, match, metadata in
-      self._injection_query:iter_matches(root_node, self._source, start_line, end_line + 1)
-    do
-      local lang, combined, ranges = self:_get_injection(match, metadata)
-      if lang then
-        add_injection(injections, pattern, lang, combined, ranges, parent_ranges, result)
-      else
-        self:_log('match from injection query failed for pattern', pattern)
+        -- Check the current function duration against the timeout, if it exists.
+        local current_time = hrtime()
+        self:_subtract_time(thread_state, current_time - start)
+        start = hrtime()
       end
-
-      -- Check the current function duration against the timeout, if it exists.
-      local current_time = hrtime()
-      self:_subtract_time(thread_state, current_time - start)
-      start = hrtime()
     end
   end
 
@@ -1084,6 +1512,101 @@ function LanguageTree:_get_injections(range, thread_state)
   return result
 end
 
+--- Gets the injections in a tree, querying only the rows that changed since the last scan.
+---
+--- @private
+--- @param tree_index integer
+--- @param tree TSTree
+--- @param thread_state ParserThreadState
+--- @return vim.treesitter.languagetree.CachedInjection[]
+function LanguageTree:_scan_injections(tree_index, tree, thread_state)
+  local cache = self._injection_cache[tree_index]
+  if cache and not cache.dirty then
+    return cache.injections
+  end
+
+  local root_node = tree:root()
+  local kept = {} ---@type vim.treesitter.languagetree.CachedInjection[]
+  local start_line, end_line ---@type integer, integer
+  if cache then
+    start_line, end_line = cache.dirty[1], cache.dirty[2]
+    -- The injections touching the dirty rows are dropped, and must be found again by the query.
+    -- It only returns them if it covers their captured nodes, which their content ranges may
+    -- reach past (`#offset!`), so extend the rows to the extents of the dropped injections.
+    local extended = true
+    while extended do
+      extended = false
+      for _, injection in ipairs(cache.injections) do
+        local extent = injection.extent
+        if
+          extent_in_rows(extent, start_line, end_line)
+          and (extent[1] < start_line or extent[4] > end_line)
+        then
+          start_line = math.min(start_line, extent[1])
+          end_line = math.max(end_line, extent[4])
+          extended = true
+        end
+      end
+    end
+    for _, injection in ipairs(cache.injections) do
+      if not extent_in_rows(injection.extent, start_line, end_line) then
+        kept[#kept + 1] = injection
+      end
+    end
+  else
+    start_line, _, end_line = root_node:range()
+  end
+
+  local found = {} ---@type vim.treesitter.languagetree.CachedInjection[]
+  local start = hrtime()
+  for pattern, match, metadata in
+    self._injection_query:iter_matches(root_node, self._source, start_line, end_line + 1)
+  do
+    local lang, combined, ranges, extent = self:_get_injection(match, metadata)
+    if not lang then
+      self:_log('match from injection query failed for pattern', pattern)
+    elseif
+      #ranges > 0
+      and extent
+      and (not cache or extent_in_rows(extent, start_line, end_line))
+    then
+      found[#found + 1] = {
+        pattern = pattern,
+        lang = lang,
+        combined = combined,
+        ranges = ranges,
+        extent = extent,
+      }
+    end
+
+    -- Check the current function duration against the timeout, if it exists.
+    local current_time = hrtime()
+    self:_subtract_time(thread_state, current_time - start)
+    start = hrtime()
+  end
+
+  -- Merge the rescanned injections back in document order.
+  local injections = {} ---@type vim.treesitter.languagetree.CachedInjection[]
+  local k, f = 1, 1
+  while k <= #kept or f <= #found do
+    if f > #found or (k <= #kept and kept[k].extent[3] <= found[f].extent[3]) then
+      injections[#injections + 1] = kept[k]
+      k = k + 1
+    else
+      injections[#injections + 1] = found[f]
+      f = f + 1
+    end
+  end
+
+  -- Otherwise the tree was edited while the query was suspended, and the cache was updated for
+  -- the edit instead.
+  if self._trees[tree_index] == tree then
+    self._injection_cache[tree_index] = { injections = injections }
+  end
+
+  return injections
+end
+
 ---@private
 ---@param cb_name TSCallbackName
 function LanguageTree:_do_callback(cb_name, ...)
@@ -1123,6 +1646,21 @@ function LanguageTree:_edit(
 
   self._parser:reset()
 
+  ---@type vim.treesitter.languagetree.Edit
+  local edit = {
+    start_byte = start_byte,
+    end_byte_old = end_byte_old,
+    end_byte_new = end_byte_new,
+    start_row = start_row,
+    end_row_old = end_row_old,
+    end_col_old = end_col_old,
+    end_row_new = end_row_new,
+    end_col_new = end_col_new,
+  }
+  for _, cache in pairs(self._injection_cache) do
+    edit_injection_cache(cache, edit)
+  end
+
   if self._regions then
     local regions = {} ---@type table<integer, Range6[]>
     for i, tree in pairs(self._trees) do
@@ -20,6 +20,7 @@ local M = {}
 ---@field has_combined_injections boolean whether the query contains combined injections
 ---@field query TSQuery userdata query object
 ---@field private _processed_patterns table<integer, vim.treesitter.query.ProcessedPattern>
+---@field private _text? string source of a query loaded from the cache, until it is compiled
 local Query = {}
 Query.__index = Query
 
@@ -32,6 +33,7 @@ end
 ---@field [1] string predicate name
 ---@field [2] boolean should match
 ---@field [3] (integer|string)[] the original predicate
+---@field [4] boolean whether query cursors evaluate the predicate when given a source
 
 ---@alias vim.treesitter.query.ProcessedDirective (integer|string)[]
 
@@ -41,7 +43,8 @@ end
 ---@field directives vim.treesitter.query.ProcessedDirective[]
 
 --- Splits the query patterns into predicates and directives.
-function Query:_process_patterns()
+---@param compiled table<integer,table<integer,true>> see |TSQuery:_compiled_predicates()|
+function Query:_process_patterns(compiled)
   self._processed_patterns = {}
 
   for k, pattern_list in pairs(self.info.patterns) do
@@ -50,7 +53,7 @@ function Query:_process_patterns()
     ---@type vim.treesitter.query.ProcessedDirective[]
     local directives = {}
 
-    for _, pattern in ipairs(pattern_list) do
+    for i, pattern in ipairs(pattern_list) do
       -- Note: tree-sitter strips the leading # from predicates for us.
       local pred_name = pattern[1]
       ---@cast pred_name string
@@ -69,7 +72,8 @@ function Query:_process_patterns()
           pred_name = pred_name:sub(5)
           should_match = false
         end
-        table.insert(predicates, { pred_name, should_match, pattern })
+        local native = compiled[k] and compiled[k][i] or false
+        table.insert(predicates, { pred_name, should_match, pattern, native })
       end
     end
 
@@ -92,7 +96,37 @@ function Query.new(lang, ts_query)
     patterns = query_info.patterns,
   }
   self.captures = self.info.captures
-  self:_process_patterns()
+  self:_process_patterns(ts_query:_compiled_predicates())
+  return self
+end
+
+--- Query whose TSQuery is compiled when it is first accessed.
+local LazyQuery = {
+  ---@param self vim.treesitter.Query
+  __index = function(self, k)
+    if k ~= 'query' then
+      return Query[k]
+    end
+    local ts_query = vim._ts_parse_query(self.lang, self._text)
+    setmetatable(self, Query)
+    self._text = nil
+    self.query = ts_query
+    return ts_query
+  end,
+}
+
+--- Creates a query from the tables cached by |Query.new()| in an earlier session.
+---@param lang string
+---@param text string query source, compiled on first use
+---@param cached { info: vim.treesitter.QueryInfo, compiled: table<integer,table<integer,true>> }
+---@return vim.treesitter.Query
+local function query_from_cache(lang, text, cached)
+  local self = setmetatable({}, LazyQuery)
+  self._text = text
+  self.lang = lang
+  self.info = cached.info
+  self.captures = self.info.captures
+  self:_process_patterns(cached.compiled)
   return self
 end
 
@@ -244,6 +278,80 @@ local function read_query_files(filenames)
   return table.concat(contents, '')
 end
 
+--- Bump when the format of the cached tables changes.
+local QUERY_CACHE_VERSION = 1
+
+--- Gets the file which caches the tables of a query, keyed on the grammar and
+--- the query text.
+---@param lang string
+---@param text string
+---@return string
+local function query_cache_file(lang, text)
+  local key = table.concat({
+    QUERY_CACHE_VERSION,
+    lang,
+    vim._ts_language_fingerprint(lang),
+    vim.fn.sha256(text),
+  }, '-')
+  return ('%s/treesitter/queries/%s.mpack'):format(vim.fn.stdpath('cache'), vim.fn.sha256(key))
+end
+
+---@param file string
+---@return { info: vim.treesitter.QueryInfo, compiled: table<integer,table<integer,true>> }?
+local function read_query_cache(file)
+  local f = io.open(file, 'rb')
+  if not f then
+    return nil
+  end
+  local data = f:read('*a')
+  f:close()
+  local ok, cached = pcall(vim.mpack.decode, data)
+  if ok and type(cached) == 'table' and type(cached.info) == 'table' then
+    return cached
+  end
+end
+
+---@param file string
+---@param query vim.treesitter.Query
+local function write_query_cache(file, query)
+  local data = vim.mpack.encode({
+    info = query.info,
+    compiled = query.query:_compiled_predicates(),
+  })
+  -- Write to a temporary file first, so other instances never read a partial cache.
+  pcall(function()
+    vim.fn.mkdir(vim.fs.dirname(file), 'p')
+    local tmp = ('%s.%d'):format(file, vim.uv.os_getpid())
+    local f = assert(io.open(tmp, 'wb'))
+    f:write(data)
+    f:close()
+    assert(vim.uv.fs_rename(tmp, file))
+  end)
+end
+
+--- Parses a runtime query. With `vim.g._ts_query_cache` set, the patterns and
+--- predicates of the query are cached on disk, and a query found there is only
+--- compiled when it is first executed.
+---@param lang string
+---@param text string
+---@return vim.treesitter.Query
+local function parse_cached(lang, text)
+  if not vim.g._ts_query_cache then
+    return M.parse(lang, text)
+  end
+
+  assert(language.add(lang))
+  local file = query_cache_file(lang, text)
+  local cached = read_query_cache(file)
+  if cached then
+    return query_from_cache(lang, text, cached)
+  end
+
+  local query = M.parse(lang, text)
+  write_query_cache(file, query)
+  return query
+end
+
 -- The explicitly set query strings from |vim.treesitter.query.set()|
 ---@type table<string,table<string,string>>
 local explicit_queries = setmetatable({}, {
@@ -329,7 +437,7 @@ M.get = memoize('concat-2', function(lang, query_name)
     return nil
   end
 
-  return M.parse(lang, query_string)
+  return parse_cached(lang, query_string)
 end, false)
 
 api.nvim_create_autocmd('OptionSet', {
@@ -390,21 +498,24 @@ local impl = {
       return true
     end
 
+    local str ---@type string
+    if type(predicate[3]) == 'string' then
+      -- (#eq? @aa "foo")
+      str = predicate[3]
+    else
+      -- (#eq? @aa @bb)
+      local other = match[predicate[3]]
+      if not other or #other == 0 then
+        return false
+      end
+      assert(#other == 1, '#eq? does not support comparison with captures on multiple nodes')
+      str = vim.treesitter.get_node_text(other[1], source)
+    end
+
     for _, node in ipairs(nodes) do
       local node_text = vim.treesitter.get_node_text(node, source)
 
-      local str ---@type string
-      if type(predicate[3]) == 'string' then
-        -- (#eq? @aa "foo")
-        str = predicate[3]
-      else
-        -- (#eq? @aa @bb)
-        local other = assert(match[predicate[3]])
-        assert(#other == 1, '#eq? does not support comparison with captures on multiple nodes')
-        str = vim.treesitter.get_node_text(other[1], source)
-      end
-
-      local res = str ~= nil and node_text == str
+      local res = node_text == str
       if any and res then
         return true
       elseif not any and not res then
@@ -604,6 +715,15 @@ local predicate_handlers = {
 predicate_handlers['vim-match?'] = predicate_handlers['match?']
 predicate_handlers['any-vim-match?'] = predicate_handlers['any-match?']
 
+--- The predicates above are also implemented in C, where query cursors evaluate
+--- them without building the match table or the node text. This is only done
+--- as long as none of them is overridden.
+local native_predicates = true
+local builtin_predicates = {} ---@type table<string,true>
+for name in pairs(predicate_handlers) do
+  builtin_predicates[name] = true
+end
+
 ---@nodoc
 ---@class vim.treesitter.query.TSMetadata
 ---@field range? Range
@@ -757,6 +877,9 @@ local directive_handlers = {
   end,
 }
 
+-- The builtin `set!`, its result does not depend on the match.
+local set_directive = directive_handlers['set!']
+
 --- @class vim.treesitter.query.add_predicate.Opts
 --- @inlinedoc
 ---
@@ -786,6 +909,10 @@ function M.add_predicate(name, handler, opts)
     error(string.format('Overriding existing predicate %s', name))
   end
 
+  if builtin_predicates[name] then
+    native_predicates = false
+  end
+
   if opts.all ~= false then
     predicate_handlers[name] = handler
   else
@@ -856,27 +983,37 @@ function M.list_predicates()
   return vim.tbl_keys(predicate_handlers)
 end
 
+--- Whether query cursors created with a source evaluate the builtin predicates.
+---@nodoc
+---@return boolean
+function M._has_native_predicates()
+  return native_predicates
+end
+
 ---@private
 ---@param pattern_i integer
 ---@param predicates vim.treesitter.query.ProcessedPredicate[]
 ---@param captures table<integer, TSNode[]>
 ---@param source integer|string
+---@param native? boolean skip the predicates already evaluated by the query cursor
 ---@return boolean whether the predicates match
-function Query:_match_predicates(predicates, pattern_i, captures, source)
+function Query:_match_predicates(predicates, pattern_i, captures, source, native)
   for _, predicate in ipairs(predicates) do
     local processed_name = predicate[1]
     local should_match = predicate[2]
     local orig_predicate = predicate[3]
 
-    local handler = predicate_handlers[processed_name]
-    if not handler then
-      error(string.format('No handler for %s', orig_predicate[1]))
-      return false
-    end
+    if not (native and predicate[4]) then
+      local handler = predicate_handlers[processed_name]
+      if not handler then
+        error(string.format('No handler for %s', orig_predicate[1]))
+        return false
+      end
 
-    local does_match = handler(captures, pattern_i, source, orig_predicate)
-    if does_match ~= should_match then
-      return false
+      local does_match = handler(captures, pattern_i, source, orig_predicate)
+      if does_match ~= should_match then
+        return false
+      end
     end
   end
   return true
@@ -905,6 +1042,73 @@ function Query:_apply_directives(directives, pattern_i, captures, source)
   return metadata
 end
 
+--- Evaluates the predicates and directives of the pattern of a match.
+---@nodoc
+---@param match TSQueryMatch
+---@param source integer|string
+---@param native? boolean skip the predicates already evaluated by the query cursor
+---@return vim.treesitter.query.TSMetadata? metadata, or nil if the predicates do not match
+function Query:_match_metadata(match, source, native)
+  local _, pattern_i = match:info()
+  local processed_pattern = self._processed_patterns[pattern_i]
+  if not processed_pattern then
+    return {}
+  end
+
+  local captures = match:captures()
+  local predicates = processed_pattern.predicates
+  if not self:_match_predicates(predicates, pattern_i, captures, source, native) then
+    return nil
+  end
+  return self:_apply_directives(processed_pattern.directives, pattern_i, captures, source)
+end
+
+--- Returns the metadata of a pattern if it is the same for every match, that is
+--- if the pattern has no predicates (other than those evaluated by the query
+--- cursor if {native} is true) and only uses the builtin `set!` directive.
+---@nodoc
+---@param pattern_i integer
+---@param native? boolean
+---@return vim.treesitter.query.TSMetadata?
+function Query:_static_metadata(pattern_i, native)
+  local processed_pattern = self._processed_patterns[pattern_i]
+  if not processed_pattern then
+    return {}
+  end
+
+  for _, predicate in ipairs(processed_pattern.predicates) do
+    if not (native and predicate[4]) then
+      return nil
+    end
+  end
+  for _, directive in ipairs(processed_pattern.directives) do
+    if directive[1] ~= 'set!' or directive_handlers['set!'] ~= set_directive then
+      return nil
+    end
+  end
+  return self:_apply_directives(processed_pattern.directives, pattern_i, {}, '')
+end
+
+--- Creates a query cursor which evaluates the builtin predicates against
+--- {source} if possible.
+---@param query vim.treesitter.Query
+---@param node TSNode
+---@param source integer|string
+---@param start integer
+---@param stop integer
+---@param opts table
+---@return TSQueryCursor cursor
+---@return boolean native whether the cursor evaluates the builtin predicates
+local function create_cursor(query, node, source, start, stop, opts)
+  local native = native_predicates and (type(source) == 'number' or type(source) == 'string')
+  local cursor = vim._create_ts_querycursor(node, query.query, start, stop, {
+    max_start_depth = opts.max_start_depth,
+    match_limit = opts.match_limit,
+    source = native and source or nil,
+  })
+  return cursor, native
+end
+
 --- Returns the start and stop value if set else the node's range.
 -- When the node's range is used, the stop is incremented by 1
 -- to make the search inclusive.
@@ -973,7 +1177,7 @@ function Query:iter_captures(node, source, start, stop, opts)
   start, stop = value_or_node_range(start, stop, node)
 
   local tree = node:tree()
-  local cursor = vim._create_ts_querycursor(node, self.query, start, stop, opts)
+  local cursor, native = create_cursor(self, node, source, start, stop, opts)
 
   -- For faster checks that a match is not in the cache.
   local highest_cached_match_id = -1
@@ -987,32 +1191,22 @@ function Query:iter_captures(node, source, start, stop, opts)
       return
     end
 
-    local match_id, pattern_i = match:info()
+    local match_id = match:info()
 
-    --- @type vim.treesitter.query.TSMetadata
+    --- @type vim.treesitter.query.TSMetadata?
     local metadata
     if match_id <= highest_cached_match_id then
       metadata = match_cache[match_id]
     end
 
     if not metadata then
-      metadata = {}
-
-      local processed_pattern = self._processed_patterns[pattern_i]
-      if processed_pattern then
-        local captures = match:captures()
-
-        local predicates = processed_pattern.predicates
-        if not self:_match_predicates(predicates, pattern_i, captures, source) then
-          cursor:remove_match(match_id)
-          if end_line and captured_node:range() > end_line then
-            return nil, captured_node, nil, nil
-          end
-          return iter(end_line) -- tail call: try next match
+      metadata = self:_match_metadata(match, source, native)
+      if not metadata then
+        cursor:remove_match(match_id)
+        if end_line and captured_node:range() > end_line then
+          return nil, captured_node, nil, nil
         end
-
-        local directives = processed_pattern.directives
-        metadata = self:_apply_directives(directives, pattern_i, captures, source)
+        return iter(end_line) -- tail call: try next match
       end
 
       highest_cached_match_id = math.max(highest_cached_match_id, match_id)
@@ -1072,7 +1266,7 @@ function Query:iter_matches(node, source, start, stop, opts)
   start, stop = value_or_node_range(start, stop, node)
 
   local tree = node:tree()
-  local cursor = vim._create_ts_querycursor(node, self.query, start, stop, opts)
+  local cursor, native = create_cursor(self, node, source, start, stop, opts)
 
   local function iter()
     local match = cursor:next_match()
@@ -1089,7 +1283,7 @@ function Query:iter_matches(node, source, start, stop, opts)
     local metadata = {}
     if processed_pattern then
       local predicates = processed_pattern.predicates
-      if not self:_match_predicates(predicates, pattern_i, captures, source) then
+      if not self:_match_predicates(predicates, pattern_i, captures, source, native) then
         cursor:remove_match(match_id)
         return iter() -- tail call: try next match
       end
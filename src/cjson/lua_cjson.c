@@ -41,6 +41,8 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 // #include <stdint.h>
@@ -48,6 +50,7 @@
 #include <lua.h>
 #include <lauxlib.h>
 
+#include "nvim/json_scan.h"
 #include "nvim/lua/executor.h"
 
 #include "lua_cjson.h"
@@ -195,6 +198,7 @@ typedef struct {
 typedef struct {
     const char *data;
     const char *ptr;
+    const char *end;
     strbuf_t *tmp;    /* Temporary storage for strings */
     json_config_t *cfg;
     json_options_t *options;
@@ -503,10 +507,11 @@ static int json_destroy_config(lua_State *l)
     return 0;
 }
 
+static void json_init_decode_tables(json_config_t *cfg);
+
 static void json_create_config(lua_State *l)
 {
     json_config_t *cfg;
-    int i;
 
     cfg = (json_config_t *)lua_newuserdata(l, sizeof(*cfg));
     if (!cfg)
@@ -538,6 +543,13 @@ static void json_create_config(lua_State *l)
     strbuf_init(&cfg->encode_buf, 0);
 #endif
 
+    json_init_decode_tables(cfg);
+}
+
+static void json_init_decode_tables(json_config_t *cfg)
+{
+    int i;
+
     /* Decoding init */
 
     /* Tag all characters as an error */
@@ -607,6 +619,8 @@ static void json_append_string(lua_State *l, json_encode_t *ctx, int lindex)
     const char *str;
     size_t len;
     size_t i;
+    size_t plain_len;
+    int escape_slash;
     strbuf_t *json = ctx->json;
 
     str = lua_tolstring(l, lindex, &len);
@@ -619,13 +633,26 @@ static void json_append_string(lua_State *l, json_encode_t *ctx, int lindex)
         abort(); /*Overflow check */
     strbuf_ensure_empty_length(json, len * 6 + 2);
 
+    /* Copy runs of characters which never need escaping at once. '/' is
+     * one of them, so only do that when it is not escaped either. */
+    escape_slash = (*ctx->options->char2escape)['/'] != NULL;
+
     strbuf_append_char_unsafe(json, '\"');
-    for (i = 0; i < len; i++) {
+    i = 0;
+    while (i < len) {
+        if (!escape_slash) {
+            plain_len = json_plain_len(str + i, len - i);
+            strbuf_append_mem_unsafe(json, str + i, plain_len);
+            i += plain_len;
+            if (i == len)
+                break;
+        }
         escstr = (*ctx->options->char2escape)[(unsigned char)str[i]];
         if (escstr)
             strbuf_append_string(json, escstr);
         else
             strbuf_append_char_unsafe(json, str[i]);
+        i++;
     }
     strbuf_append_char_unsafe(json, '\"');
 }
@@ -1182,6 +1209,7 @@ static void json_next_string_token(json_parse_t *json, json_token_t *token)
 {
     char *escape2char = json->cfg->escape2char;
     char ch;
+    size_t plain_len;
 
     /* Caller must ensure a string is next */
     assert(*json->ptr == '"');
@@ -1196,6 +1224,14 @@ static void json_next_string_token(json_parse_t *json, json_token_t *token)
     strbuf_reset(json->tmp);
 
     while ((ch = *json->ptr) != '"') {
+        /* Copy characters which are not escapes at once */
+        plain_len = json_plain_len(json->ptr, (size_t)(json->end - json->ptr));
+        if (plain_len > 0) {
+            strbuf_append_mem_unsafe(json->tmp, json->ptr, plain_len);
+            json->ptr += plain_len;
+            continue;
+        }
+
         if (!ch) {
             /* Premature end of the string */
             json_set_token_error(token, json, "unexpected end of string");
@@ -1609,6 +1645,7 @@ static int json_decode(lua_State *l)
     json.options = &options;
     json.current_depth = 0;
     json.ptr = json.data;
+    json.end = json.data + json_len;
 
     /* Detect Unicode other than UTF-8 (see RFC 4627, Sec 3)
      *
@@ -1637,6 +1674,366 @@ static int json_decode(lua_State *l)
     return 1;
 }
 
+/* ===== PRE-PARSED DECODING ===== */
+
+/* Nvim: decoding in two steps, so that the expensive part can run on a
+ * worker thread.
+ *
+ * lua_cjson_tape_parse() tokenizes and validates a document without a Lua
+ * state. Values are stored in a flat "tape" in document order, strings are
+ * already unescaped. lua_cjson_tape_push() then builds the Lua value from the
+ * tape, creating every table with its final size.
+ */
+
+typedef struct {
+    json_token_type_t type;
+    /* T_STRING: length of the string
+     * T_OBJ_BEGIN, T_ARR_BEGIN: number of pairs/items which follow */
+    size_t len;
+    union {
+        size_t offset;      /* T_STRING: offset in json_tape_t.strings */
+        double number;
+        lua_Integer integer;
+        int boolean;
+    } value;
+} json_tape_entry_t;
+
+struct json_tape {
+    json_tape_entry_t *entries;
+    size_t count;
+    size_t size;
+    strbuf_t strings;
+    char error[256];        /* Empty unless parsing failed */
+};
+
+/* The tape functions have no module table to fetch the config from, they use
+ * this one. It is initialised once by lua_cjson_new() on the main thread. */
+static json_config_t json_tape_cfg;
+static bool json_tape_cfg_ready = false;
+
+static void json_tape_init_config(void)
+{
+    if (json_tape_cfg_ready)
+        return;
+
+    memset(&json_tape_cfg, 0, sizeof(json_tape_cfg));
+    json_tape_cfg.decode_max_depth = DEFAULT_DECODE_MAX_DEPTH;
+    json_tape_cfg.decode_invalid_numbers = DEFAULT_DECODE_INVALID_NUMBERS;
+    json_tape_cfg.decode_array_with_array_mt = DEFAULT_DECODE_ARRAY_WITH_ARRAY_MT;
+    json_init_decode_tables(&json_tape_cfg);
+    json_tape_cfg_ready = true;
+}
+
+static size_t json_tape_add(json_tape_t *tape, json_token_type_t type)
+{
+    json_tape_entry_t *entry;
+
+    if (tape->count == tape->size) {
+        tape->size = tape->size ? tape->size * 2 : 64;
+        tape->entries = (json_tape_entry_t *)realloc(tape->entries,
+                                                     tape->size * sizeof(*tape->entries));
+        if (!tape->entries)
+            abort();
+    }
+
+    entry = &tape->entries[tape->count];
+    entry->type = type;
+    entry->len = 0;
+    return tape->count++;
+}
+
+/* Same message as json_throw_parse_error() */
+static int json_tape_parse_error(json_tape_t *tape, const char *exp,
+                                 json_token_t *token)
+{
+    const char *found;
+
+    if (token->type == T_ERROR)
+        found = token->value.string;
+    else
+        found = json_token_type_name[token->type];
+
+    snprintf(tape->error, sizeof(tape->error),
+             "Expected %s but found %s at character %zu",
+             exp, found, token->index + 1);
+    return -1;
+}
+
+static int json_tape_descend(json_tape_t *tape, json_parse_t *json)
+{
+    json->current_depth++;
+
+    if (json->current_depth <= json->cfg->decode_max_depth)
+        return 0;
+
+    snprintf(tape->error, sizeof(tape->error),
+             "Found too many nested data structures (%d) at character %td",
+             json->current_depth, json->ptr - json->data);
+    return -1;
+}
+
+static int json_tape_value(json_tape_t *tape, json_parse_t *json,
+                           json_token_t *token);
+
+static int json_tape_object(json_tape_t *tape, json_parse_t *json)
+{
+    json_token_t token;
+    size_t obj;
+
+    if (json_tape_descend(tape, json) < 0)
+        return -1;
+
+    obj = json_tape_add(tape, T_OBJ_BEGIN);
+
+    json_next_token(json, &token);
+
+    /* Handle empty objects */
+    if (token.type == T_OBJ_END) {
+        json_decode_ascend(json);
+        return 0;
+    }
+
+    while (1) {
+        if (token.type != T_STRING)
+            return json_tape_parse_error(tape, "object key string", &token);
+
+        /* Key */
+        if (json_tape_value(tape, json, &token) < 0)
+            return -1;
+
+        json_next_token(json, &token);
+        if (token.type != T_COLON)
+            return json_tape_parse_error(tape, "colon", &token);
+
+        /* Value */
+        json_next_token(json, &token);
+        if (json_tape_value(tape, json, &token) < 0)
+            return -1;
+        tape->entries[obj].len++;
+
+        json_next_token(json, &token);
+
+        if (token.type == T_OBJ_END) {
+            json_decode_ascend(json);
+            return 0;
+        }
+
+        if (token.type != T_COMMA)
+            return json_tape_parse_error(tape, "comma or object end", &token);
+
+        json_next_token(json, &token);
+    }
+}
+
+static int json_tape_array(json_tape_t *tape, json_parse_t *json)
+{
+    json_token_t token;
+    size_t arr;
+
+    if (json_tape_descend(tape, json) < 0)
+        return -1;
+
+    arr = json_tape_add(tape, T_ARR_BEGIN);
+
+    json_next_token(json, &token);
+
+    /* Handle empty arrays */
+    if (token.type == T_ARR_END) {
+        json_decode_ascend(json);
+        return 0;
+    }
+
+    while (1) {
+        if (json_tape_value(tape, json, &token) < 0)
+            return -1;
+        tape->entries[arr].len++;
+
+        json_next_token(json, &token);
+
+        if (token.type == T_ARR_END) {
+            json_decode_ascend(json);
+            return 0;
+        }
+
+        if (token.type != T_COMMA)
+            return json_tape_parse_error(tape, "comma or array end", &token);
+
+        json_next_token(json, &token);
+    }
+}
+
+static int json_tape_value(json_tape_t *tape, json_parse_t *json,
+                           json_token_t *token)
+{
+    size_t i;
+
+    switch (token->type) {
+    case T_STRING:
+        i = json_tape_add(tape, T_STRING);
+        tape->entries[i].len = token->string_len;
+        tape->entries[i].value.offset = strbuf_length(&tape->strings);
+        strbuf_append_mem(&tape->strings, token->value.string, token->string_len);
+        return 0;
+    case T_NUMBER:
+        i = json_tape_add(tape, T_NUMBER);
+        tape->entries[i].value.number = token->value.number;
+        return 0;
+    case T_INTEGER:
+        i = json_tape_add(tape, T_INTEGER);
+        tape->entries[i].value.integer = token->value.integer;
+        return 0;
+    case T_BOOLEAN:
+        i = json_tape_add(tape, T_BOOLEAN);
+        tape->entries[i].value.boolean = token->value.boolean;
+        return 0;
+    case T_NULL:
+        json_tape_add(tape, T_NULL);
+        return 0;
+    case T_OBJ_BEGIN:
+        return json_tape_object(tape, json);
+    case T_ARR_BEGIN:
+        return json_tape_array(tape, json);
+    default:
+        return json_tape_parse_error(tape, "value", token);
+    }
+}
+
+/* Parses the JSON document "data" of "len" bytes, which must be followed by a
+ * NUL byte. Does not use Lua, can be called from any thread.
+ *
+ * Always returns a tape, check lua_cjson_tape_error() for the result. */
+json_tape_t *lua_cjson_tape_parse(const char *data, size_t len)
+{
+    json_tape_t *tape;
+    json_parse_t json;
+    json_token_t token;
+
+    assert(json_tape_cfg_ready);
+
+    tape = (json_tape_t *)calloc(1, sizeof(*tape));
+    if (!tape)
+        abort();
+
+    /* Decoded strings are never longer than the document */
+    strbuf_init(&tape->strings, len);
+
+    /* See json_decode() */
+    if (len >= 2 && (!data[0] || !data[1])) {
+        snprintf(tape->error, sizeof(tape->error),
+                 "JSON parser does not support UTF-16 or UTF-32");
+        return tape;
+    }
+
+    json.cfg = &json_tape_cfg;
+    json.data = data;
+    json.ptr = data;
+    json.end = data + len;
+    json.options = NULL;
+    json.current_depth = 0;
+    json.tmp = strbuf_new(len);
+
+    json_next_token(&json, &token);
+    if (json_tape_value(tape, &json, &token) == 0) {
+        /* Ensure there is no more input left */
+        json_next_token(&json, &token);
+        if (token.type != T_END)
+            json_tape_parse_error(tape, "the end", &token);
+    }
+
+    strbuf_free(json.tmp);
+
+    return tape;
+}
+
+/* Returns the parse error, or NULL if "tape" holds a valid document */
+const char *lua_cjson_tape_error(const json_tape_t *tape)
+{
+    return tape->error[0] ? tape->error : NULL;
+}
+
+static void json_tape_push_value(lua_State *l, json_tape_t *tape, size_t *pos,
+                                 json_options_t *options, bool use_luanil)
+{
+    json_tape_entry_t *entry = &tape->entries[(*pos)++];
+    size_t i;
+
+    switch (entry->type) {
+    case T_STRING:
+        lua_pushlstring(l, strbuf_string(&tape->strings, NULL) + entry->value.offset,
+                        entry->len);
+        break;
+    case T_NUMBER:
+        lua_pushnumber(l, entry->value.number);
+        break;
+    case T_INTEGER:
+        lua_pushinteger(l, entry->value.integer);
+        break;
+    case T_BOOLEAN:
+        lua_pushboolean(l, entry->value.boolean);
+        break;
+    case T_NULL:
+        if (use_luanil) {
+            lua_pushnil(l);
+        } else {
+            nlua_pushref(l, nlua_get_nil_ref(l));
+        }
+        break;
+    case T_OBJ_BEGIN:
+        /* .., table, key, value */
+        luaL_checkstack(l, 3, "too many nested data structures");
+        lua_createtable(l, 0, (int)entry->len);
+        if (entry->len == 0) {
+            nlua_pushref(l, nlua_get_empty_dict_ref(l));
+            lua_setmetatable(l, -2);
+        }
+        for (i = 0; i < entry->len; i++) {
+            json_tape_push_value(l, tape, pos, options, false);
+            json_tape_push_value(l, tape, pos, options, options->luanil_object);
+            lua_rawset(l, -3);
+        }
+        break;
+    case T_ARR_BEGIN:
+        /* .., table, value */
+        luaL_checkstack(l, 2, "too many nested data structures");
+        lua_createtable(l, (int)entry->len, 0);
+        if (json_tape_cfg.decode_array_with_array_mt) {
+            lua_pushlightuserdata(l, json_lightudata_mask(&json_array));
+            lua_rawget(l, LUA_REGISTRYINDEX);
+            lua_setmetatable(l, -2);
+        }
+        for (i = 0; i < entry->len; i++) {
+            json_tape_push_value(l, tape, pos, options, options->luanil_array);
+            lua_rawseti(l, -2, (int)i + 1);
+        }
+        break;
+    default:
+        abort();
+    }
+}
+
+/* Pushes the value parsed by lua_cjson_tape_parse(), like vim.json.decode()
+ * with the given "luanil" options. The tape must not have an error. */
+void lua_cjson_tape_push(lua_State *l, json_tape_t *tape, bool luanil_object,
+                         bool luanil_array)
+{
+    json_options_t options = { .luanil_object = luanil_object,
+                               .luanil_array = luanil_array };
+    size_t pos = 0;
+
+    assert(!lua_cjson_tape_error(tape));
+    json_tape_push_value(l, tape, &pos, &options, luanil_object);
+}
+
+void lua_cjson_tape_free(json_tape_t *tape)
+{
+    if (!tape)
+        return;
+
+    free(tape->entries);
+    strbuf_free(&tape->strings);
+    free(tape);
+}
+
 /* ===== INITIALISATION ===== */
 
 #if !defined(LUA_VERSION_NUM) || LUA_VERSION_NUM < 502
@@ -1724,6 +2121,7 @@ int lua_cjson_new(lua_State *l)
     // thread safe, it should only be called in the main thread.
     if (!is_thread) {
         fpconv_init();
+        json_tape_init_config();
     }
 
     /* Test if array metatables are in registry */
@@ -1,10 +1,21 @@
 #ifndef CJSON_LUACJSON_H
 #define CJSON_LUACJSON_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "lua.h"
 
+typedef struct json_tape json_tape_t;
+
 int lua_cjson_new(lua_State *l);
 int luaopen_cjson(lua_State *l);
 int luaopen_cjson_safe(lua_State *l);
 
+json_tape_t *lua_cjson_tape_parse(const char *data, size_t len);
+const char *lua_cjson_tape_error(const json_tape_t *tape);
+void lua_cjson_tape_push(lua_State *l, json_tape_t *tape, bool luanil_object,
+                         bool luanil_array);
+void lua_cjson_tape_free(json_tape_t *tape);
+
 #endif  // CJSON_LUACJSON_H
@@ -18,6 +18,7 @@
 #include "nvim/decoration_provider.h"
 #include "nvim/drawscreen.h"
 #include "nvim/extmark.h"
+#include "nvim/extmark_defs.h"
 #include "nvim/globals.h"
 #include "nvim/grid.h"
 #include "nvim/highlight_group.h"
@@ -29,6 +30,7 @@
 #include "nvim/memory.h"
 #include "nvim/memory_defs.h"
 #include "nvim/move.h"
+#include "nvim/plines.h"
 #include "nvim/pos_defs.h"
 #include "nvim/sign.h"
 
@@ -937,6 +939,234 @@ error:
   return 0;
 }
 
+/// Creates many |extmark|s in one call.
+///
+/// Equivalent to calling |nvim_buf_set_extmark()| with `end_row`, `end_col`,
+/// `hl_group` and `priority` for each mark, but much faster when adding a
+/// large number of highlights at once, e.g. for semantic tokens. The marks
+/// are validated first, so either all of them are created or none.
+///
+/// Example:
+///
+/// ```lua
+/// local ns = vim.api.nvim_create_namespace('my_tokens')
+/// -- "Keyword" on row 0, col 0-5 and "String" on row 1, col 2-8
+/// vim.api.nvim_buf_set_extmarks(0, ns, { 0, 0, 0, 5, 1, 2, 1, 8 }, {
+///   hl_group = { 'Keyword', 'String' },
+///   priority = 125,
+/// })
+/// ```
+///
+/// @param buffer  Buffer id, or 0 for current buffer
+/// @param ns_id  Namespace id from |nvim_create_namespace()|
+/// @param pos  Positions of the marks, packed as `row, col, end_row, end_col`
+///             for each mark (0-based, like |nvim_buf_set_extmark()|).
+///             Use -1 for `end_row` and `end_col` to not set an end position.
+/// @param opts  Optional parameters.
+///               - hl_group : highlight group used for all marks, or a list with
+///                   one highlight group (name or id) per mark.
+///               - priority : priority used for all marks, or a list with one
+///                   priority per mark.
+///               - hl_eol, right_gravity, end_right_gravity, undo_restore,
+///                 invalidate, strict : see |nvim_buf_set_extmark()|. Applies
+///                 to all marks.
+/// @param[out] err   Error details, if any
+/// @return Ids of the created extmarks, in the order of {pos}
+ArrayOf(Integer) nvim_buf_set_extmarks(Buffer buffer, Integer ns_id, ArrayOf(Integer) pos,
+                                       Dict(set_extmarks) *opts, Arena *arena, Error *err)
+  FUNC_API_SINCE(14)
+{
+  buf_T *buf = find_buffer_by_handle(buffer, err);
+  if (!buf) {
+    return (Array)ARRAY_DICT_INIT;
+  }
+
+  VALIDATE_INT(ns_initialized((uint32_t)ns_id), "ns_id", ns_id, {
+    return (Array)ARRAY_DICT_INIT;
+  });
+
+  VALIDATE_EXP((pos.size % 4 == 0), "pos", "row, col, end_row, end_col for each mark", NULL, {
+    return (Array)ARRAY_DICT_INIT;
+  });
+  size_t count = pos.size / 4;
+
+  Array hl_groups = ARRAY_DICT_INIT;
+  int hl_id = 0;
+  if (HAS_KEY(opts, set_extmarks, hl_group)) {
+    if (opts->hl_group.type == kObjectTypeArray) {
+      hl_groups = opts->hl_group.data.array;
+      VALIDATE_EXP((hl_groups.size == count), "hl_group", "one item per mark", NULL, {
+        return (Array)ARRAY_DICT_INIT;
+      });
+    } else {
+      hl_id = object_to_hl_id(opts->hl_group, "hl_group", err);
+      if (ERROR_SET(err)) {
+        return (Array)ARRAY_DICT_INIT;
+      }
+    }
+  }
+
+  Array priorities = ARRAY_DICT_INIT;
+  Integer priority = DECOR_PRIORITY_BASE;
+  if (HAS_KEY(opts, set_extmarks, priority)) {
+    if (opts->priority.type == kObjectTypeArray) {
+      priorities = opts->priority.data.array;
+      VALIDATE_EXP((priorities.size == count), "priority", "one item per mark", NULL, {
+        return (Array)ARRAY_DICT_INIT;
+      });
+    } else {
+      VALIDATE_T("priority", kObjectTypeInteger, opts->priority.type, {
+        return (Array)ARRAY_DICT_INIT;
+      });
+      priority = opts->priority.data.integer;
+    }
+  }
+
+  bool strict = GET_BOOL_OR_TRUE(opts, set_extmarks, strict);
+  ExtmarkBulkItem *items = xcalloc(MAX(count, 1), sizeof(*items));
+
+  for (size_t i = 0; i < count; i++) {
+    Integer p[4];
+    for (size_t j = 0; j < 4; j++) {
+      VALIDATE_T("pos item", kObjectTypeInteger, pos.items[4 * i + j].type, {
+        goto error;
+      });
+      p[j] = pos.items[4 * i + j].data.integer;
+    }
+    if (!extmark_bulk_pos(buf, p, strict, &items[i], err)) {
+      goto error;
+    }
+    // Only error out if they try to set end_right_gravity for a mark without
+    // end_row or end_col
+    VALIDATE(!(p[2] == -1 && p[3] == -1 && HAS_KEY(opts, set_extmarks, end_right_gravity)),
+             "%s", "cannot set end_right_gravity without end_row or end_col", {
+      goto error;
+    });
+
+    int item_hl_id = hl_id;
+    if (hl_groups.size > 0) {
+      item_hl_id = object_to_hl_id(hl_groups.items[i], "hl_group item", err);
+      if (ERROR_SET(err)) {
+        goto error;
+      }
+    }
+
+    Integer item_priority = priority;
+    if (priorities.size > 0) {
+      VALIDATE_T("priority item", kObjectTypeInteger, priorities.items[i].type, {
+        goto error;
+      });
+      item_priority = priorities.items[i].data.integer;
+    }
+    VALIDATE_RANGE((item_priority >= 0 && item_priority <= UINT16_MAX), "priority", {
+      goto error;
+    });
+
+    DecorHighlightInline hl = DECOR_HIGHLIGHT_INLINE_INIT;
+    hl.hl_id = item_hl_id;
+    hl.priority = (DecorPriority)item_priority;
+    hl.flags |= opts->hl_eol ? kSHHlEol : 0;
+    items[i].decor = (DecorInline){ .ext = false, .data.hl = hl };
+    items[i].decor_flags = item_hl_id > 0 ? MT_FLAG_DECOR_HL : 0;
+  }
+
+  extmark_set_bulk(buf, (uint32_t)ns_id, items, count,
+                   GET_BOOL_OR_TRUE(opts, set_extmarks, right_gravity), opts->end_right_gravity,
+                   !GET_BOOL_OR_TRUE(opts, set_extmarks, undo_restore), opts->invalidate);
+
+  Array rv = arena_array(arena, count);
+  for (size_t i = 0; i < count; i++) {
+    ADD_C(rv, INTEGER_OBJ((Integer)items[i].id));
+  }
+  xfree(items);
+  return rv;
+
+error:
+  xfree(items);
+  return (Array)ARRAY_DICT_INIT;
+}
+
+/// Validates and clamps the position of one mark for nvim_buf_set_extmarks(),
+/// following the rules of nvim_buf_set_extmark().
+///
+/// @param p  row, col, end_row, end_col
+/// @return false and sets "err" if the position is invalid
+static bool extmark_bulk_pos(buf_T *buf, const Integer *p, bool strict, ExtmarkBulkItem *item,
+                             Error *err)
+{
+  Integer line = p[0];
+  Integer col = p[1];
+  int line2 = -1;
+  colnr_T col2 = -1;
+
+  if (p[2] != -1) {
+    VALIDATE_RANGE((p[2] >= 0 && !(p[2] > buf->b_ml.ml_line_count && strict)), "end_row", {
+      return false;
+    });
+    line2 = (int)p[2];
+  }
+
+  if (p[3] != -1) {
+    VALIDATE_RANGE((p[3] >= 0 && p[3] <= MAXCOL), "end_col", {
+      return false;
+    });
+    col2 = (colnr_T)p[3];
+  }
+
+  VALIDATE_RANGE((line >= 0), "line", {
+    return false;
+  });
+
+  colnr_T len = 0;
+  if (line > buf->b_ml.ml_line_count) {
+    VALIDATE_RANGE(!strict, "line", {
+      return false;
+    });
+    line = buf->b_ml.ml_line_count;
+  } else if (line < buf->b_ml.ml_line_count) {
+    len = ml_get_buf_len(buf, (linenr_T)line + 1);
+  }
+
+  if (col == -1) {
+    col = len;
+  } else if (col > len) {
+    VALIDATE_RANGE(!strict, "col", {
+      return false;
+    });
+    col = len;
+  } else if (col < -1) {
+    VALIDATE_RANGE(false, "col", {
+      return false;
+    });
+  }
+
+  if (col2 >= 0) {
+    if (line2 >= 0 && line2 < buf->b_ml.ml_line_count) {
+      len = ml_get_buf_len(buf, (linenr_T)line2 + 1);
+    } else if (line2 == buf->b_ml.ml_line_count) {
+      // We are trying to add an extmark past final newline
+      len = 0;
+    } else {
+      // reuse len from before
+      line2 = (int)line;
+    }
+    if (col2 > len) {
+      VALIDATE_RANGE(!strict, "end_col", {
+        return false;
+      });
+      col2 = len;
+    }
+  } else if (line2 >= 0) {
+    col2 = 0;
+  }
+
+  item->row = (int)line;
+  item->col = (colnr_T)col;
+  item->end_row = line2;
+  item->end_col = col2;
+  return true;
+}
+
 /// Removes an |extmark|.
 ///
 /// @param buffer Buffer id, or 0 for current buffer
@@ -1044,12 +1274,22 @@ void nvim_buf_clear_namespace(Buffer buffer, Integer ns_id, Integer line_start,
 ///               ```
 ///                 ["end", tick]
 ///               ```
+///             - budget: time in milliseconds the callbacks may take during
+///               a screen redraw. When it is used up, `on_line` is not called
+///               for the remaining lines, which are drawn without the
+///               decorations of this provider and redrawn once more right
+///               after. See |nvim__decoration_provider_stats()|.
 void nvim_set_decoration_provider(Integer ns_id, Dict(set_decoration_provider) *opts, Error *err)
   FUNC_API_SINCE(7) FUNC_API_LUA_ONLY
 {
+  VALIDATE_RANGE(opts->budget >= 0, "budget", {
+    return;
+  });
+
   DecorProvider *p = get_decor_provider((NS)ns_id, true);
   assert(p != NULL);
   decor_provider_clear(p);
+  decor_provider_reset_stats(p, (uint64_t)opts->budget * 1000000);
 
   // regardless of what happens, it seems good idea to redraw
   redraw_all_later(UPD_NOT_VALID);  // TODO(bfredl): too soon?
@@ -1085,6 +1325,24 @@ void nvim_set_decoration_provider(Integer ns_id, Dict(set_decoration_provider) *
   p->hl_cached = false;
 }
 
+/// EXPERIMENTAL: this API may change in the future.
+///
+/// Gets the time spent in the callbacks of each decoration provider, to find
+/// out which one makes redrawing slow. Times are in nanoseconds.
+///
+/// @return Array of dictionaries, one for each provider, with these keys:
+///   - ns_id: |namespace| of the provider
+///   - calls: number of callbacks called
+///   - time_total: time spent in all callbacks
+///   - time_last: time spent in callbacks during the last screen redraw
+///   - time_max: longest time spent in callbacks during a screen redraw
+///   - budget: the `budget` given to |nvim_set_decoration_provider()|, or 0
+///   - skipped_lines: `on_line` calls skipped because the budget was used up
+Array nvim__decoration_provider_stats(Arena *arena)
+{
+  return decor_providers_stats(arena);
+}
+
 /// Gets the line and column of an |extmark|.
 ///
 /// Extmarks may be queried by position, name or even special names
@@ -1286,6 +1544,9 @@ void nvim__ns_set(Integer ns_id, Dict(ns_opts) *opts, Error *err)
       }
     }
   }
+
+  // Inline virtual text of the namespace may now be displayed differently.
+  plines_cache_invalidate_all();
 }
 
 /// EXPERIMENTAL: this API will change in the future.
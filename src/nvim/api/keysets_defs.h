@@ -22,6 +22,7 @@ typedef struct {
   LuaRefOf(("hl_def" _)) _on_hl_def;
   LuaRefOf(("spell_nav" _)) _on_spell_nav;
   LuaRefOf(("conceal_line" _)) _on_conceal_line;
+  Integer budget;
 } Dict(set_decoration_provider);
 
 typedef struct {
@@ -62,6 +63,18 @@ typedef struct {
   Boolean scoped;
 } Dict(set_extmark);
 
+typedef struct {
+  OptionalKeys is_set__set_extmarks_;
+  Object hl_group;
+  Union(Integer, ArrayOf(Integer)) priority;
+  Boolean hl_eol;
+  Boolean invalidate;
+  Boolean right_gravity;
+  Boolean end_right_gravity;
+  Boolean strict;
+  Boolean undo_restore;
+} Dict(set_extmarks);
+
 typedef struct {
   OptionalKeys is_set__get_extmark_;
   Boolean details;
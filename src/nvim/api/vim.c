@@ -81,6 +81,7 @@
 #include "nvim/statusline.h"
 #include "nvim/statusline_defs.h"
 #include "nvim/terminal.h"
+#include "nvim/trace.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/vim_defs.h"
@@ -1691,16 +1692,45 @@ Float nvim__id_float(Float flt)
 /// @return Map of various internal stats.
 Dict nvim__stats(Arena *arena)
 {
-  Dict rv = arena_dict(arena, 6);
+  Dict rv = arena_dict(arena, 12);
   PUT_C(rv, "fsync", INTEGER_OBJ(g_stats.fsync));
   PUT_C(rv, "log_skip", INTEGER_OBJ(g_stats.log_skip));
   PUT_C(rv, "lua_refcount", INTEGER_OBJ(nlua_get_global_ref_count()));
   PUT_C(rv, "redraw", INTEGER_OBJ(g_stats.redraw));
   PUT_C(rv, "arena_alloc_count", INTEGER_OBJ((Integer)arena_alloc_count));
   PUT_C(rv, "ts_query_parse_count", INTEGER_OBJ((Integer)tslua_query_parse_count));
+  PUT_C(rv, "gc_count", INTEGER_OBJ(g_stats.gc));
+  PUT_C(rv, "gc_skip_count", INTEGER_OBJ(g_stats.gc_skip));
+  PUT_C(rv, "gc_freed", INTEGER_OBJ(g_stats.gc_freed));
+  PUT_C(rv, "gc_time_last", INTEGER_OBJ((Integer)g_stats.gc_time_last));
+  PUT_C(rv, "gc_time_max", INTEGER_OBJ((Integer)g_stats.gc_time_max));
+  PUT_C(rv, "gc_time_total", INTEGER_OBJ((Integer)g_stats.gc_time_total));
   return rv;
 }
 
+/// Starts writing a trace of events to a file, like |--trace|.
+///
+/// The trace records the time spent sourcing scripts, running autocommands,
+/// redrawing, in decoration providers, handling RPC requests and in Lua
+/// callbacks. Load it in chrome://tracing or https://ui.perfetto.dev.
+/// A trace which was running is stopped first.
+///
+/// @param file Path of the file to write, it is overwritten.
+/// @param[out] err Error details, if any
+void nvim__trace_start(String file, Error *err)
+{
+  if (!trace_start(file.data)) {
+    api_set_error(err, kErrorTypeException, "Failed to open trace file: %s", file.data);
+  }
+}
+
+/// Stops the trace started with |nvim__trace_start()| or |--trace|, and
+/// finishes writing its file.
+void nvim__trace_stop(void)
+{
+  trace_stop();
+}
+
 /// Gets a list of dictionaries representing attached UIs.
 ///
 /// Example: The Nvim builtin |TUI| sets its channel info as described in |startup-tui|. In
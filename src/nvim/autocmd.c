@@ -56,6 +56,7 @@
 #include "nvim/state.h"
 #include "nvim/state_defs.h"
 #include "nvim/strings.h"
+#include "nvim/trace.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/ui_compositor.h"
@@ -1874,7 +1875,9 @@ bool apply_autocmds_group(event_T event, char *fname, char *fname_io, bool force
     const bool save_ex_pressedreturn = get_pressedreturn();
 
     // Execute the autocmd. The `getnextac` callback handles iteration.
+    TRACE_BEGIN("autocmd", event_nr2name(event));
     do_cmdline(NULL, getnextac, &patcmd, DOCMD_NOWAIT | DOCMD_VERBOSE | DOCMD_REPEAT);
+    TRACE_END("autocmd");
 
     did_emsg += save_did_emsg;
     set_pressedreturn(save_ex_pressedreturn);
@@ -707,6 +707,11 @@ struct file_buffer {
                                 // normally points to this, but some windows
                                 // may use a different synblock_T.
 
+  // Fold levels of the lines, maintained by the treesitter fold module and read
+  // by windows which use it for 'foldexpr', see fold_levels_get().
+  kvec_t(int32_t) b_fold_levels;
+  bool b_fold_levels_active;    // b_fold_levels is maintained
+
   struct {
     int max;                    // maximum number of signs on a single line
     int last_max;               // value of max when the buffer was last drawn
@@ -856,6 +861,24 @@ typedef struct {
   linenr_T wl_lastlnum;         // last buffer line number for logical line
 } wline_T;
 
+/// Cache of the number of screen lines each buffer line takes in a window, as
+/// computed by plines_win_nofold().  A Fenwick tree over the heights gives the
+/// height of a range of lines in O(log n).  See plines.c.
+typedef struct {
+  int *heights;               ///< height of line "lnum" at index "lnum - 1", -1 when unknown
+  int64_t *tree;              ///< Fenwick tree over "heights", only used when "tree_valid"
+  linenr_T size;              ///< number of lines in "heights"
+  linenr_T dirty_top;         ///< first line that may have an unknown height, zero if none
+  linenr_T dirty_bot;         ///< last line that may have an unknown height
+  bool tree_valid;            ///< "tree" is up to date with "heights"
+  handle_T buf_handle;        ///< buffer the heights were computed for
+  int generation;             ///< value of plines_cache_generation when (re)initialized
+  int width1;                 ///< text width of the first screen line
+  int width2;                 ///< text width of continuation screen lines
+  bool wrap;                  ///< value of 'wrap' the heights were computed with
+  bool list;                  ///< value of 'list' the heights were computed with
+} LineHeightCache;
+
 // Windows are kept in a tree of frames.  Each frame has a column (FR_COL)
 // or row (FR_ROW) layout or is a leaf, which has a window.
 struct frame_S {
@@ -1244,11 +1267,15 @@ struct window_S {
   wline_T *w_lines;
   int w_lines_size;
 
+  LineHeightCache w_plines_cache;   // height of every buffer line, see plines.c
+
   garray_T w_folds;                 // array of nested folds
   bool w_fold_manual;               // when true: some folds are opened/closed
                                     // manually
   bool w_foldinvalid;               // when true: folding needs to be
                                     // recomputed
+  char *w_fold_levels_fde;          // 'foldexpr' which reads b_fold_levels
+                                    // instead of being evaluated, or NULL
   int w_nrwidth;                    // width of 'number' and 'relativenumber'
                                     // column being used
   int w_scwidth;                    // width of 'signcolumn'
@@ -194,6 +194,8 @@ static void changed_lines_invalidate_win(win_T *wp, linenr_T lnum, colnr_T col,
       || (xtra != 0 && buf_meta_total(wp->w_buffer, kMTMetaLines))) {
     lnume++;
   }
+  plines_cache_invalidate(wp, lnum, lnume, xtra);
+
   // Check if any w_lines[] entries have become invalid.
   // For entries below the change: Correct the lnums for inserted/deleted lines.
   // Makes it possible to stop displaying after the change.
@@ -340,6 +340,8 @@ void decor_state_free(DecorState *state)
 {
   kv_destroy(state->slots);
   kv_destroy(state->ranges_i);
+  kv_destroy(state->ends_heap);
+  kv_destroy(state->prefix);
 }
 
 void clear_virttext(VirtText *text)
@@ -443,6 +445,9 @@ bool decor_redraw_reset(win_T *wp, DecorState *state)
 
   kv_size(state->slots) = 0;
   kv_size(state->ranges_i) = 0;
+  kv_size(state->ends_heap) = 0;
+  kv_size(state->prefix) = 0;
+  state->index_row = -1;
   state->free_slot_i = -1;
   state->current_end = 0;
   state->future_begin = 0;
@@ -527,6 +532,7 @@ bool decor_redraw_line(win_T *wp, int row, DecorState *state)
   }
 
   state->row = row;
+  state->index_row = -1;
   state->col_until = -1;
   state->eol_col = -1;
 
@@ -685,6 +691,97 @@ void decor_recheck_draw_col(int win_col, bool hidden, DecorState *state)
   }
 }
 
+/// @return true if range "r" ends before or at "row", "col".
+static inline bool decor_range_ended(const DecorRange *r, int row, int col)
+{
+  return r->end_row < row || (r->end_row == row && r->end_col <= col);
+}
+
+/// @return true if the range in slot "a" ends before the one in slot "b".
+static inline bool decor_heap_less(const DecorRangeSlot *slots, int a, int b)
+{
+  const DecorRange *ra = &slots[a].range;
+  const DecorRange *rb = &slots[b].range;
+  return ra->end_row < rb->end_row || (ra->end_row == rb->end_row && ra->end_col < rb->end_col);
+}
+
+static void decor_heap_sift_down(DecorState *state, size_t i)
+{
+  int *const heap = state->ends_heap.items;
+  DecorRangeSlot *const slots = state->slots.items;
+  size_t const size = kv_size(state->ends_heap);
+
+  while (true) {
+    size_t min = i;
+    size_t const l = 2 * i + 1;
+    size_t const r = l + 1;
+    if (l < size && decor_heap_less(slots, heap[l], heap[min])) {
+      min = l;
+    }
+    if (r < size && decor_heap_less(slots, heap[r], heap[min])) {
+      min = r;
+    }
+    if (min == i) {
+      return;
+    }
+    int const tmp = heap[i];
+    heap[i] = heap[min];
+    heap[min] = tmp;
+    i = min;
+  }
+}
+
+static void decor_heap_push(DecorState *state, int index)
+{
+  kv_push(state->ends_heap, index);
+  int *const heap = state->ends_heap.items;
+  DecorRangeSlot *const slots = state->slots.items;
+
+  size_t i = kv_size(state->ends_heap) - 1;
+  while (i > 0) {
+    size_t const parent = (i - 1) / 2;
+    if (!decor_heap_less(slots, heap[i], heap[parent])) {
+      break;
+    }
+    int const tmp = heap[i];
+    heap[i] = heap[parent];
+    heap[parent] = tmp;
+    i = parent;
+  }
+}
+
+static int decor_heap_pop(DecorState *state)
+{
+  int const top = kv_A(state->ends_heap, 0);
+  kv_A(state->ends_heap, 0) = kv_last(state->ends_heap);
+  kv_size(state->ends_heap)--;
+  decor_heap_sift_down(state, 0);
+  return top;
+}
+
+/// Find the position of the range in slot "index" among the active ranges,
+/// which are sorted by priority and order of insertion.
+static int decor_active_find(DecorState *state, int cur_end, int index)
+{
+  int *const indices = state->ranges_i.items;
+  DecorRangeSlot *const slots = state->slots.items;
+  DecorPriority const priority = slots[index].range.priority;
+  int const ordering = slots[index].range.ordering;
+
+  int begin = 0;
+  int end = cur_end;
+  while (begin < end) {
+    int mid = begin + ((end - begin) >> 1);
+    DecorRange *mr = &slots[indices[mid]].range;
+    if (mr->priority < priority || (mr->priority == priority && mr->ordering < ordering)) {
+      begin = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  return begin;
+}
+
 int decor_redraw_col_impl(win_T *wp, int col, int win_col, bool hidden, DecorState *state)
 {
   buf_T *const buf = wp->w_buffer;
@@ -721,6 +818,12 @@ next_mark:
   int cur_end = state->current_end;
   int fut_beg = state->future_begin;
 
+  // `ends_heap` and `prefix` are updated incrementally while moving forward
+  // on the same row. Otherwise all active ranges are recombined.
+  bool const rebuild = state->index_row != row || col < state->index_col;
+  // Active ranges before "dirty_from" are unchanged, and so is their prefix.
+  int dirty_from = rebuild ? 0 : cur_end;
+
   // Promote future ranges before the cursor to active.
   for (; fut_beg < count; fut_beg++) {
     int const index = indices[fut_beg];
@@ -748,6 +851,21 @@ next_mark:
     memmove(item + 1, item, (size_t)(cur_end - begin) * sizeof(*item));
     *item = index;
     cur_end++;
+
+    dirty_from = MIN(dirty_from, begin);
+    if (!rebuild) {
+      decor_heap_push(state, index);
+    }
+  }
+
+  // Ranges which ended are found through the heap, instead of checking every
+  // active range.
+  if (!rebuild) {
+    while (kv_size(state->ends_heap) > 0
+           && decor_range_ended(&slots[kv_A(state->ends_heap, 0)].range, row, col)) {
+      int const index = decor_heap_pop(state);
+      dirty_from = MIN(dirty_from, decor_active_find(state, cur_end, index));
+    }
   }
 
   if (fut_beg < count) {
@@ -757,29 +875,34 @@ next_mark:
     }
   }
 
-  int new_cur_end = 0;
+  if (kv_max(state->prefix) < (size_t)cur_end) {
+    kv_resize(state->prefix, (size_t)cur_end);
+  }
+
+  DecorRangePrefix acc = { .attr = 0, .spell = kNone, .conceal = false };
+  if (dirty_from > 0) {
+    acc = kv_A(state->prefix, dirty_from - 1);
+  }
+
+  int new_cur_end = dirty_from;
 
-  int attr = 0;
-  int conceal = 0;
+  int attr = acc.attr;
+  int conceal = acc.conceal ? 1 : 0;
   schar_T conceal_char = 0;
   int conceal_attr = 0;
-  TriState spell = kNone;
+  TriState spell = acc.spell;
 
-  for (int i = 0; i < cur_end; i++) {
+  for (int i = dirty_from; i < cur_end; i++) {
     int const index = indices[i];
     DecorRangeSlot *const slot = slots + index;
     DecorRange *const r = &slot->range;
 
     bool keep;
-    if (r->end_row < row || (r->end_row == row && r->end_col <= col)) {
+    if (decor_range_ended(r, row, col)) {
       keep = r->start_row >= row && decor_virt_pos(r);
     } else {
       keep = true;
 
-      if (r->end_row == row && r->end_col > col) {
-        col_until = MIN(col_until, r->end_col - 1);
-      }
-
       if (r->attr_id > 0) {
         attr = hl_combine_attr(attr, r->attr_id);
       }
@@ -813,6 +936,9 @@ next_mark:
     }
 
     if (keep) {
+      kv_A(state->prefix, new_cur_end) = (DecorRangePrefix){
+        .attr = attr, .spell = spell, .conceal = conceal > 0
+      };
       indices[new_cur_end++] = index;
     } else {
       if (r->owned) {
@@ -830,6 +956,29 @@ next_mark:
     }
   }
   cur_end = new_cur_end;
+  kv_size(state->prefix) = (size_t)cur_end;
+
+  if (rebuild) {
+    kv_size(state->ends_heap) = 0;
+    for (int i = 0; i < cur_end; i++) {
+      if (!decor_range_ended(&slots[indices[i]].range, row, col)) {
+        kv_push(state->ends_heap, indices[i]);
+      }
+    }
+    for (size_t i = kv_size(state->ends_heap) / 2; i > 0; i--) {
+      decor_heap_sift_down(state, i - 1);
+    }
+    state->index_row = row;
+  }
+  state->index_col = col;
+
+  // The first range to end on this row limits how long the result is valid.
+  if (kv_size(state->ends_heap) > 0) {
+    DecorRange *r = &slots[kv_A(state->ends_heap, 0)].range;
+    if (r->end_row == row) {
+      col_until = MIN(col_until, r->end_col - 1);
+    }
+  }
 
   if (fut_beg == count) {
     fut_beg = count = cur_end;
@@ -68,6 +68,13 @@ typedef union {
   int next_free_i;
 } DecorRangeSlot;
 
+/// Combined highlight state of a prefix of the active ranges in `DecorState`.
+typedef struct {
+  int attr;
+  TriState spell;
+  bool conceal;
+} DecorRangePrefix;
+
 typedef struct {
   MarkTreeIter itr[1];
   kvec_t(DecorRangeSlot) slots;
@@ -78,6 +85,16 @@ typedef struct {
   /// Indices in [future_begin, kv_size(ranges_i)) of `ranges_i` point to
   /// ranges that start after current position. Sorted by starting position.
   int future_begin;
+  /// Min-heap of `slots` indices of the ranges in [0; current_end) of
+  /// `ranges_i` that have not ended yet, ordered by end position.
+  kvec_t(int) ends_heap;
+  /// Element i is the combined state of ranges [0; i] in [0; current_end) of
+  /// `ranges_i`, so that only the part after a changed range is recombined.
+  kvec_t(DecorRangePrefix) prefix;
+  /// Row and column `ends_heap` and `prefix` were last updated for.
+  /// `index_row` is -1 when they must be rebuilt.
+  int index_row;
+  int index_col;
   /// Head of DecorRangeSlot freelist. -1 if none are freed.
   int free_slot_i;
   /// Index for keeping track of range insertion order.
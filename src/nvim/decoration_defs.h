@@ -157,4 +157,13 @@ typedef struct {
   bool hl_cached;
 
   uint8_t error_count;
+
+  // Times are in nanoseconds.
+  uint64_t budget;  ///< time for callbacks per redraw before on_line is skipped, 0 for no limit
+  uint64_t time_redraw;  ///< time spent in callbacks during the current redraw
+  uint64_t time_redraw_last;  ///< time spent in callbacks during the last redraw
+  uint64_t time_redraw_max;
+  uint64_t time_total;
+  int64_t calls;
+  int64_t skipped_lines;  ///< on_line calls skipped because "budget" was exceeded
 } DecorProvider;
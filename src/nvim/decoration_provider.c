@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <lauxlib.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "klib/kvec.h"
@@ -11,13 +12,19 @@
 #include "nvim/decoration.h"
 #include "nvim/decoration_defs.h"
 #include "nvim/decoration_provider.h"
+#include "nvim/drawscreen.h"
 #include "nvim/globals.h"
 #include "nvim/highlight.h"
 #include "nvim/log.h"
 #include "nvim/lua/executor.h"
+#include "nvim/macros_defs.h"
+#include "nvim/map_defs.h"
+#include "nvim/memory.h"
 #include "nvim/message.h"
 #include "nvim/move.h"
+#include "nvim/os/time.h"
 #include "nvim/pos_defs.h"
+#include "nvim/trace.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "decoration_provider.c.generated.h"
@@ -25,10 +32,17 @@
 
 static kvec_t(DecorProvider) decor_providers = KV_INITIAL_VALUE;
 
+/// Windows in which on_line calls were skipped during the current redraw,
+/// because a provider exceeded its budget, with the first skipped row.
+static Map(int, int) decor_retry_wins = MAP_INIT;
+/// The current redraw was done to retry skipped on_line calls.
+static bool decor_retrying = false;
+
 #define DECORATION_PROVIDER_INIT(ns_id) (DecorProvider) \
   { ns_id, kDecorProviderDisabled, LUA_NOREF, LUA_NOREF, \
     LUA_NOREF, LUA_NOREF, LUA_NOREF, \
-    LUA_NOREF, LUA_NOREF, -1, false, false, 0 }
+    LUA_NOREF, LUA_NOREF, -1, false, false, 0, \
+    0, 0, 0, 0, 0, 0, 0 }
 
 static void decor_provider_error(DecorProvider *provider, const char *name, const char *msg)
 {
@@ -44,13 +58,25 @@ static bool decor_provider_invoke(int provider_idx, const char *name, LuaRef ref
 {
   Error err = ERROR_INIT;
 
+  if (TRACE_ENABLED()) {
+    char detail[256];
+    snprintf(detail, sizeof(detail), "%s (ns=%s)", name,
+             describe_ns(kv_A(decor_providers, provider_idx).ns_id, "(UNKNOWN PLUGIN)"));
+    trace_begin("decor_provider", detail);
+  }
+  const uint64_t start = os_hrtime();
   textlock++;
   Object ret = nlua_call_ref(ref, name, args, kRetNilBool, NULL, &err);
   textlock--;
+  const uint64_t elapsed = os_hrtime() - start;
+  TRACE_END("decor_provider");
 
   // We get the provider here via an index in case the above call to nlua_call_ref causes
   // decor_providers to be reallocated.
   DecorProvider *provider = &kv_A(decor_providers, provider_idx);
+  provider->calls++;
+  provider->time_redraw += elapsed;
+  provider->time_total += elapsed;
   if (!ERROR_SET(&err)
       && api_object_to_bool(ret, "provider %s retval", default_true, &err)) {
     provider->error_count = 0;
@@ -113,6 +139,7 @@ void decor_providers_start(void)
 {
   for (size_t i = 0; i < kv_size(decor_providers); i++) {
     DecorProvider *p = &kv_A(decor_providers, i);
+    p->time_redraw = 0;
     if (p->state != kDecorProviderDisabled && p->redraw_start != LUA_NOREF) {
       MAXSIZE_TEMP_ARRAY(args, 2);
       ADD_C(args, INTEGER_OBJ((int)display_tick));
@@ -176,6 +203,20 @@ void decor_providers_invoke_line(win_T *wp, int row)
   for (size_t i = 0; i < kv_size(decor_providers); i++) {
     DecorProvider *p = &kv_A(decor_providers, i);
     if (p->state == kDecorProviderActive && p->redraw_line != LUA_NOREF) {
+      if (p->budget > 0 && p->time_redraw >= p->budget) {
+        // Out of time for this redraw: draw the line without the provider,
+        // and redraw the window once more when this redraw is done.
+        p->skipped_lines++;
+        if (!decor_retrying) {
+          bool new_item;
+          int *first_row = map_put_ref(int, int)(&decor_retry_wins, wp->handle, NULL, &new_item);
+          if (new_item || row < *first_row) {
+            *first_row = row;
+          }
+        }
+        continue;
+      }
+
       MAXSIZE_TEMP_ARRAY(args, 3);
       ADD_C(args, WINDOW_OBJ(wp->handle));
       ADD_C(args, BUFFER_OBJ(wp->w_buffer->handle));
@@ -223,8 +264,60 @@ void decor_providers_invoke_end(void)
       ADD_C(args, INTEGER_OBJ((int)display_tick));
       decor_provider_invoke((int)i, "end", p->redraw_end, args, true);
     }
+    p = &kv_A(decor_providers, i);
+    p->time_redraw_last = p->time_redraw;
+    p->time_redraw_max = MAX(p->time_redraw_max, p->time_redraw);
   }
   decor_check_to_be_deleted();
+
+  // Retry the on_line calls skipped during this redraw in the next one.  Only
+  // once, so that a provider which is always too slow doesn't redraw forever.
+  // Only the lines from the first skipped one are redrawn, so that the budget
+  // of the retry is spent on them rather than again on the lines above.
+  decor_retrying = map_size(&decor_retry_wins) > 0;
+  handle_T handle;
+  int first_row;
+  map_foreach(&decor_retry_wins, handle, first_row, {
+    win_T *wp = handle_get_window(handle);
+    if (wp != NULL) {
+      redraw_win_range_later(wp, first_row + 1, wp->w_buffer->b_ml.ml_line_count);
+    }
+  });
+  map_clear(int, &decor_retry_wins);
+}
+
+/// Reset the timing statistics of provider "p" and set its budget.
+///
+/// @param budget  Time in nanoseconds, 0 for no limit.
+void decor_provider_reset_stats(DecorProvider *p, uint64_t budget)
+{
+  p->budget = budget;
+  p->time_redraw = 0;
+  p->time_redraw_last = 0;
+  p->time_redraw_max = 0;
+  p->time_total = 0;
+  p->calls = 0;
+  p->skipped_lines = 0;
+}
+
+/// Timing statistics of the decoration providers, see
+/// nvim__decoration_provider_stats().
+Array decor_providers_stats(Arena *arena)
+{
+  Array rv = arena_array(arena, kv_size(decor_providers));
+  for (size_t i = 0; i < kv_size(decor_providers); i++) {
+    DecorProvider *p = &kv_A(decor_providers, i);
+    Dict d = arena_dict(arena, 8);
+    PUT_C(d, "ns_id", INTEGER_OBJ(p->ns_id));
+    PUT_C(d, "calls", INTEGER_OBJ(p->calls));
+    PUT_C(d, "time_total", INTEGER_OBJ((Integer)p->time_total));
+    PUT_C(d, "time_last", INTEGER_OBJ((Integer)p->time_redraw_last));
+    PUT_C(d, "time_max", INTEGER_OBJ((Integer)p->time_redraw_max));
+    PUT_C(d, "budget", INTEGER_OBJ((Integer)(p->budget / 1000000)));
+    PUT_C(d, "skipped_lines", INTEGER_OBJ(p->skipped_lines));
+    ADD_C(rv, DICT_OBJ(d));
+  }
+  return rv;
 }
 
 /// Mark all cached state of per-namespace highlights as invalid. Revalidate
@@ -286,4 +379,5 @@ void decor_free_all_mem(void)
     decor_provider_clear(&kv_A(decor_providers, i));
   }
   kv_destroy(decor_providers);
+  map_destroy(int, &decor_retry_wins);
 }
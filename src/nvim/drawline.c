@@ -55,6 +55,7 @@
 #include "nvim/strings.h"
 #include "nvim/syntax.h"
 #include "nvim/terminal.h"
+#include "nvim/trace.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/ui_defs.h"
@@ -1040,6 +1041,8 @@ static int get_rightmost_vcol(win_T *wp, const int *color_cols)
 int win_line(win_T *wp, linenr_T lnum, int startrow, int endrow, int col_rows, bool concealed,
              spellvars_T *spv, foldinfo_T foldinfo)
 {
+  TRACE_BEGIN("win_line", NULL);
+
   colnr_T vcol_prev = -1;             // "wlv.vcol" of previous character
   GridView *grid = &wp->w_grid;       // grid specific to the window
   const int view_width = wp->w_view_width;
@@ -3131,6 +3134,7 @@ end_check:
   clear_virttext(&fold_vt);
   kv_destroy(virt_lines);
   xfree(foldtext_free);
+  TRACE_END("win_line");
   return wlv.row;
 }
 
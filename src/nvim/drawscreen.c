@@ -112,6 +112,7 @@
 #include "nvim/strings.h"
 #include "nvim/syntax.h"
 #include "nvim/terminal.h"
+#include "nvim/trace.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/ui_compositor.h"
@@ -465,6 +466,8 @@ int update_screen(void)
     return FAIL;
   }
 
+  TRACE_BEGIN("update_screen", NULL);
+
   int type = must_redraw;
 
   // must_redraw is reset here, so that when we run into some weird
@@ -718,6 +721,8 @@ int update_screen(void)
   if (!ui_has(kUICmdline)) {
     cmdline_was_last_drawn = false;
   }
+
+  TRACE_END("update_screen");
   return OK;
 }
 
@@ -1518,6 +1523,8 @@ static void win_update(win_T *wp)
     return;
   }
 
+  TRACE_BEGIN("win_update", NULL);
+
   buf_T *buf = wp->w_buffer;
 
   // reset got_int, otherwise regexp won't work
@@ -2529,6 +2536,8 @@ redr_statuscol:
   if (!got_int) {
     got_int = save_got_int;
   }
+
+  TRACE_END("win_update");
 }
 
 /// Scroll `line_count` lines at 'row' in window 'wp'.
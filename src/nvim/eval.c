@@ -67,6 +67,7 @@
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
 #include "nvim/os/shell.h"
+#include "nvim/os/time.h"
 #include "nvim/path.h"
 #include "nvim/pos_defs.h"
 #include "nvim/profile.h"
@@ -4590,6 +4591,8 @@ void partial_unref(partial_T *pt)
 
   if (--pt->pt_refcount <= 0) {
     partial_free(pt);
+  } else {
+    gc_unref_count++;
   }
 }
 
@@ -4730,6 +4733,22 @@ int get_copyID(void)
 /// but it applies to all reference-counting mechanisms):
 ///      http://python.ca/nas/python/gc/
 
+/// Do garbage collection for lists and dicts when waiting for the user to
+/// type, unless nothing lost a reference since the last collection.
+///
+/// Marking visits every reachable list and dict, which takes long with big
+/// variables.  Reference cycles only become unreachable when one of their
+/// items loses a reference without being freed, which bumps gc_unref_count.
+void garbage_collect_idle(void)
+{
+  if (gc_unref_count == 0 && !want_garbage_collect) {
+    may_garbage_collect = false;
+    g_stats.gc_skip++;
+    return;
+  }
+  garbage_collect(false);
+}
+
 /// Do garbage collection for lists and dicts.
 ///
 /// @param testing  true if called from test_garbagecollect_now().
@@ -4739,6 +4758,7 @@ bool garbage_collect(bool testing)
 {
   bool abort = false;
 #define ABORTING(func) abort = abort || func
+  const uint64_t start = os_hrtime();
 
   if (!testing) {
     // Only do this once.
@@ -4887,10 +4907,17 @@ bool garbage_collect(bool testing)
     // 3. Check if any funccal can be freed now.
     //    This may call us back recursively.
     did_free = free_unref_funccal(copyID, testing) || did_free;
+    gc_unref_count = 0;
   } else if (p_verbose > 0) {
     verb_msg(_("Not enough memory to set references, garbage collection aborted!"));
   }
 #undef ABORTING
+
+  const uint64_t elapsed = os_hrtime() - start;
+  g_stats.gc++;
+  g_stats.gc_time_last = elapsed;
+  g_stats.gc_time_max = MAX(g_stats.gc_time_max, elapsed);
+  g_stats.gc_time_total += elapsed;
   return did_free;
 }
 
@@ -4945,6 +4972,7 @@ static int free_unref_items(int copyID)
     dd_next = dd->dv_used_next;
     if ((dd->dv_copyID & COPYID_MASK) != (copyID & COPYID_MASK)) {
       tv_dict_free_dict(dd);
+      g_stats.gc_freed++;
     }
   }
 
@@ -4957,6 +4985,7 @@ static int free_unref_items(int copyID)
       // into Lists and Dictionaries, they will be in the list of dicts
       // or list of lists.
       tv_list_free_list(ll);
+      g_stats.gc_freed++;
     }
   }
   tv_in_free_unref_items = false;
@@ -19,6 +19,7 @@
 #include "nvim/eval_defs.h"
 #include "nvim/garray.h"
 #include "nvim/gettext_defs.h"
+#include "nvim/json_scan.h"
 #include "nvim/macros_defs.h"
 #include "nvim/mbyte.h"
 #include "nvim/memory.h"
@@ -312,6 +313,12 @@ static inline int parse_json_string(const char *const buf, const size_t buf_len,
   const char *const s = ++p;
   int ret = OK;
   while (p < e && *p != '"') {
+    const size_t plain_len = json_plain_len(p, (size_t)(e - p));
+    if (plain_len > 0) {
+      len += plain_len;
+      p += plain_len;
+      continue;
+    }
     if (*p == '\\') {
       p++;
       if (p == e) {
@@ -451,7 +458,10 @@ static inline int parse_json_string(const char *const buf, const size_t buf_len,
         abort();
       }
     } else {
-      *str_end++ = *t;
+      const size_t plain_len = MAX(json_plain_len(t, (size_t)(p - t)), 1);
+      memcpy(str_end, t, plain_len);
+      str_end += plain_len;
+      t += plain_len - 1;
     }
   }
   PUT_FST_IN_PAIR(fst_in_pair, str_end);
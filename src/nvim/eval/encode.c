@@ -23,6 +23,7 @@
 #include "nvim/gettext_defs.h"
 #include "nvim/globals.h"
 #include "nvim/hashtab.h"
+#include "nvim/json_scan.h"
 #include "nvim/macros_defs.h"
 #include "nvim/math.h"
 #include "nvim/mbyte.h"
@@ -618,6 +619,12 @@ static inline int convert_to_json_string(garray_T *const gap, const char *const
 #define ENCODE_RAW(ch) \
   ((ch) >= 0x20 && utf_printable(ch))
     for (size_t i = 0; i < utf_len;) {
+      const size_t plain_len = json_plain_len(utf_buf + i, utf_len - i);
+      if (plain_len > 0) {
+        str_len += plain_len;
+        i += plain_len;
+        continue;
+      }
       const int ch = utf_ptr2char(utf_buf + i);
       const size_t shift = (ch == 0 ? 1 : ((size_t)utf_ptr2len(utf_buf + i)));
       assert(shift > 0);
@@ -658,6 +665,12 @@ static inline int convert_to_json_string(garray_T *const gap, const char *const
     ga_append(gap, '"');
     ga_grow(gap, (int)str_len);
     for (size_t i = 0; i < utf_len;) {
+      const size_t plain_len = json_plain_len(utf_buf + i, utf_len - i);
+      if (plain_len > 0) {
+        ga_concat_len(gap, utf_buf + i, plain_len);
+        i += plain_len;
+        continue;
+      }
       const int ch = utf_ptr2char(utf_buf + i);
       const size_t shift = (ch == 0 ? 1 : ((size_t)utf_char2len(ch)));
       assert(shift > 0);
@@ -10,3 +10,8 @@
 dict_T *gc_first_dict = NULL;
 /// Head of list of all lists
 list_T *gc_first_list = NULL;
+
+/// Number of times a list, dict, partial, function or funccal lost a reference
+/// without being freed since the last garbage collection.  Only then can a
+/// reference cycle have become unreachable.
+size_t gc_unref_count = 0;
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <stddef.h>
+
 #include "nvim/eval/typval_defs.h"
 
 extern dict_T *gc_first_dict;
 extern list_T *gc_first_list;
+extern size_t gc_unref_count;
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "eval/gc.h.generated.h"
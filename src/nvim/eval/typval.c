@@ -116,6 +116,11 @@ bool tv_in_free_unref_items = false;
 
 #define DICT_MAXNEST 100
 
+/// tv_list_find() indexes all items of lists with at least this many items,
+/// when the item is further than TV_LIST_ITEMS_MIN_WALK from a known one.
+#define TV_LIST_ITEMS_MIN_LEN 64
+#define TV_LIST_ITEMS_MIN_WALK 16
+
 const char *const tv_empty_string = "";
 
 //{{{1 Lists
@@ -283,6 +288,7 @@ void tv_list_free_contents(list_T *const l)
   l->lv_len = 0;
   l->lv_idx_item = NULL;
   l->lv_last = NULL;
+  tv_list_items_free(l);
   assert(l->lv_watch == NULL);
 }
 
@@ -305,6 +311,7 @@ void tv_list_free_list(list_T *const l)
   }
 
   NLUA_CLEAR_REF(l->lua_table_ref);
+  tv_list_items_free(l);
   xfree(l);
 }
 
@@ -332,8 +339,13 @@ void tv_list_free(list_T *const l)
 /// @param[in,out]  l  List to unreference.
 void tv_list_unref(list_T *const l)
 {
-  if (l != NULL && --l->lv_refcount <= 0) {
+  if (l == NULL) {
+    return;
+  }
+  if (--l->lv_refcount <= 0) {
     tv_list_free(l);
+  } else {
+    gc_unref_count++;
   }
 }
 
@@ -366,6 +378,7 @@ void tv_list_drop_items(list_T *const l, listitem_T *const item, listitem_T *con
     item->li_prev->li_next = item2->li_next;
   }
   l->lv_idx_item = NULL;
+  l->lv_items_len = 0;
 }
 
 /// Like tv_list_drop_items, but also frees all removed items
@@ -432,6 +445,7 @@ void tv_list_insert(list_T *const l, listitem_T *const ni, listitem_T *const ite
     }
     item->li_prev = ni;
     l->lv_len++;
+    l->lv_items_len = 0;
   }
 }
 
@@ -457,6 +471,14 @@ void tv_list_insert_tv(list_T *const l, typval_T *const tv, listitem_T *const it
 void tv_list_append(list_T *const l, listitem_T *const item)
   FUNC_ATTR_NONNULL_ALL
 {
+  if (l->lv_items != NULL && l->lv_items_len == l->lv_len) {
+    // Keep a complete index complete.
+    if (l->lv_items_len == l->lv_items_size) {
+      l->lv_items_size *= 2;
+      l->lv_items = xrealloc(l->lv_items, (size_t)l->lv_items_size * sizeof(*l->lv_items));
+    }
+    l->lv_items[l->lv_items_len++] = item;
+  }
   if (l->lv_last == NULL) {
     // empty list
     l->lv_first = item;
@@ -1349,6 +1371,7 @@ static void do_sort(list_T *l, sortinfo_T *info)
     l->lv_first = NULL;
     l->lv_last = NULL;
     l->lv_idx_item = NULL;
+    l->lv_items_len = 0;
     l->lv_len = 0;
     for (i = 0; i < len; i++) {
       tv_list_append(l, ptrs[i].item);
@@ -1570,13 +1593,61 @@ void tv_list_reverse(list_T *const l)
   for (listitem_T *li = l->lv_first; li != NULL; li = li->li_next) {
     SWAP(li->li_next, li->li_prev);
   }
-#undef SWAP
 
   l->lv_idx = l->lv_len - l->lv_idx - 1;
+
+  if (l->lv_items_len == l->lv_len) {
+    for (int i = 0, j = l->lv_len - 1; i < j; i++, j--) {
+      SWAP(l->lv_items[i], l->lv_items[j]);
+    }
+  } else {
+    l->lv_items_len = 0;
+  }
+#undef SWAP
 }
 
 //{{{2 Indexing/searching
 
+/// Index all items of a list, see list_T.lv_items
+///
+/// Only walks the items after the ones already indexed.
+///
+/// @param[in,out]  l  List to index.
+///
+/// @return Array of the "lv_len" items of "l".
+static listitem_T **tv_list_items_build(list_T *const l)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  if (l->lv_items_size < l->lv_len) {
+    // Leave room for appending.
+    l->lv_items_size = l->lv_len + l->lv_len / 2;
+    l->lv_items = xrealloc(l->lv_items, (size_t)l->lv_items_size * sizeof(*l->lv_items));
+  }
+  listitem_T *item = (l->lv_items_len > 0
+                      ? l->lv_items[l->lv_items_len - 1]->li_next
+                      : l->lv_first);
+  for (int i = l->lv_items_len; i < l->lv_len; i++) {
+    l->lv_items[i] = item;
+    item = item->li_next;
+  }
+  l->lv_items_len = l->lv_len;
+  return l->lv_items;
+}
+
+/// Free the index of the items of a list
+///
+/// @param[in,out]  l  List to change.
+static void tv_list_items_free(list_T *const l)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (l->lv_items == NULL) {
+    return;
+  }
+  XFREE_CLEAR(l->lv_items);
+  l->lv_items_len = 0;
+  l->lv_items_size = 0;
+}
+
 /// Locate item with a given index in a list and return it
 ///
 /// @param[in]  l  List to index.
@@ -1585,7 +1656,7 @@ void tv_list_reverse(list_T *const l)
 ///
 /// @return Item at the given index or NULL if `n` is out of range.
 listitem_T *tv_list_find(list_T *const l, int n)
-  FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT
+  FUNC_ATTR_WARN_UNUSED_RESULT
 {
   STATIC_ASSERT(sizeof(n) == sizeof(l->lv_idx),
                 "n and lv_idx sizes do not match");
@@ -1598,6 +1669,10 @@ listitem_T *tv_list_find(list_T *const l, int n)
     return NULL;
   }
 
+  if (l->lv_items_len > n) {
+    return l->lv_items[n];
+  }
+
   int idx;
   listitem_T *item;
 
@@ -1628,6 +1703,11 @@ listitem_T *tv_list_find(list_T *const l, int n)
     }
   }
 
+  if (l->lv_len >= TV_LIST_ITEMS_MIN_LEN && abs(n - idx) > TV_LIST_ITEMS_MIN_WALK) {
+    // Random access in a long list: index all items instead of walking.
+    return tv_list_items_build(l)[n];
+  }
+
   while (n > idx) {
     // Search forward.
     item = item->li_next;
@@ -2205,8 +2285,13 @@ void tv_dict_free(dict_T *const d)
 /// @param[in]  d  Dictionary to operate on.
 void tv_dict_unref(dict_T *const d)
 {
-  if (d != NULL && --d->dv_refcount <= 0) {
+  if (d == NULL) {
+    return;
+  }
+  if (--d->dv_refcount <= 0) {
     tv_dict_free(d);
+  } else {
+    gc_unref_count++;
   }
 }
 
@@ -3434,6 +3519,7 @@ static inline int _nothing_conv_func_start(typval_T *const tv, char *const fun)
     partial_T *const pt_ = tv->vval.v_partial;
     if (pt_ != NULL && pt_->pt_refcount > 1) {
       pt_->pt_refcount--;
+      gc_unref_count++;
       tv->vval.v_partial = NULL;
       return OK;
     }
@@ -3508,6 +3594,7 @@ static inline int _nothing_conv_real_list_after_start(typval_T *const tv,
   tv->v_lock = VAR_UNLOCKED;
   if (tv->vval.v_list->lv_refcount > 1) {
     tv->vval.v_list->lv_refcount--;
+    gc_unref_count++;
     tv->vval.v_list = NULL;
     mpsv->data.l.li = NULL;
     return OK;
@@ -3548,6 +3635,7 @@ static inline int _nothing_conv_real_dict_after_start(typval_T *const tv, dict_T
   }
   if ((const void *)dictp != nodictvar && (*dictp)->dv_refcount > 1) {
     (*dictp)->dv_refcount--;
+    gc_unref_count++;
     *dictp = NULL;
     mpsv->data.d.todo = 0;
     return OK;
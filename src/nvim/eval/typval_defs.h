@@ -191,6 +191,11 @@ struct listvar_S {
   int lv_refcount;  ///< Reference count.
   int lv_len;  ///< Number of items.
   int lv_idx;  ///< Index of a cached item, used for optimising repeated l[idx].
+  listitem_T **lv_items;  ///< Items by index, built by tv_list_find() for random access.
+                          ///< NULL if never built.
+  int lv_items_len;  ///< Number of valid entries in "lv_items": they are always
+                     ///< the first items of the list.
+  int lv_items_size;  ///< Allocated size of "lv_items".
   int lv_copyID;  ///< ID used by deepcopy().
   VarLockStatus lv_lock;  ///< Zero, VAR_LOCKED, VAR_FIXED.
 
@@ -329,6 +334,8 @@ struct ufunc {
   garray_T uf_args;          ///< arguments
   garray_T uf_def_args;      ///< default argument expressions
   garray_T uf_lines;         ///< function lines
+  bool *uf_noop_lines;       ///< per line: empty or only a comment, skipped
+                             ///< when executing, see get_func_line()
   int uf_profiling;     ///< true when func is being profiled
   int uf_prof_initialized;
   LuaRef uf_luaref;      ///< lua callback, used if (uf_flags & FC_LUAREF)
@@ -20,6 +20,7 @@
 #include "nvim/eval.h"
 #include "nvim/eval/encode.h"
 #include "nvim/eval/funcs.h"
+#include "nvim/eval/gc.h"
 #include "nvim/eval/typval.h"
 #include "nvim/eval/userfunc.h"
 #include "nvim/eval/vars.h"
@@ -843,6 +844,7 @@ static void cleanup_function_call(funccall_T *fc)
     // Link "fc" in the list for garbage collection later.
     fc->fc_caller = previous_funccal;
     previous_funccal = fc;
+    gc_unref_count++;
 
     if (want_garbage_collect) {
       // If garbage collector is ready, clear count.
@@ -869,6 +871,7 @@ static void funccal_unref(funccall_T *fc, ufunc_T *fp, bool force)
   }
 
   fc->fc_refcount--;
+  gc_unref_count++;
   if (force ? fc->fc_refcount <= 0 : !fc_referenced(fc)) {
     for (funccall_T **pfc = &previous_funccal; *pfc != NULL; pfc = &(*pfc)->fc_caller) {
       if (fc == *pfc) {
@@ -905,6 +908,7 @@ static void func_clear_items(ufunc_T *fp)
   ga_clear_strings(&(fp->uf_args));
   ga_clear_strings(&(fp->uf_def_args));
   ga_clear_strings(&(fp->uf_lines));
+  XFREE_CLEAR(fp->uf_noop_lines);
 
   if (fp->uf_flags & FC_LUAREF) {
     api_free_luaref(fp->uf_luaref);
@@ -2349,8 +2353,9 @@ static ufunc_T *list_one_function(exarg_T *eap, char *name, char *p)
 /// Read the body of a function, put every line in "newlines".
 /// This stops at "endfunction".
 /// "newlines" must already have been initialized.
-static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in,
-                             char **line_to_free, bool show_block)
+/// For every line "noop_lines" gets whether it does nothing when executed.
+static int get_function_body(exarg_T *eap, garray_T *newlines, garray_T *noop_lines,
+                             char *line_arg_in, char **line_to_free, bool show_block)
 {
   bool saved_wait_return = need_wait_return;
   char *line_arg = line_arg_in;
@@ -2373,6 +2378,7 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
     char *theline;
     char *p;
     char *arg;
+    bool noop = false;
 
     if (line_arg != NULL) {
       // Use eap->arg, split up in parts by line breaks.
@@ -2444,6 +2450,10 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
       // skip ':' and blanks
       for (p = theline; ascii_iswhite(*p) || *p == ':'; p++) {}
 
+      // An empty line or a comment. Not inside a nested function, its lines
+      // are read by executing this one.
+      noop = nesting == 0 && (*p == NUL || *p == '"');
+
       // Check for "endfunction".
       if (checkforcmd(&p, "endfunction", 4) && nesting-- == 0) {
         if (*p == '!') {
@@ -2594,6 +2604,8 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
 
     // Add the line to the function.
     ga_grow(newlines, 1 + (int)sourcing_lnum_off);
+    ga_grow(noop_lines, 1 + (int)sourcing_lnum_off);
+    ((bool *)(noop_lines->ga_data))[noop_lines->ga_len++] = noop;
 
     // Copy the line to newly allocated memory.  get_one_sourceline()
     // allocates 250 bytes per line, this saves 80% on average.  The cost
@@ -2605,6 +2617,7 @@ static int get_function_body(exarg_T *eap, garray_T *newlines, char *line_arg_in
     // equal to the index in the growarray.
     while (sourcing_lnum_off-- > 0) {
       ((char **)(newlines->ga_data))[newlines->ga_len++] = NULL;
+      ((bool *)(noop_lines->ga_data))[noop_lines->ga_len++] = false;
     }
 
     // Check for end of eap->arg.
@@ -2634,6 +2647,7 @@ void ex_function(exarg_T *eap)
   garray_T newargs;
   garray_T default_args;
   garray_T newlines;
+  garray_T noop_lines;
   int varargs = false;
   int flags = 0;
   ufunc_T *fp = NULL;
@@ -2718,6 +2732,7 @@ void ex_function(exarg_T *eap)
 
   ga_init(&newargs, (int)sizeof(char *), 3);
   ga_init(&newlines, (int)sizeof(char *), 3);
+  ga_init(&noop_lines, (int)sizeof(bool), 3);
 
   if (!eap->skip) {
     // Check the name of the function.  Unless it's a dictionary function
@@ -2823,7 +2838,8 @@ void ex_function(exarg_T *eap)
   linenr_T sourcing_lnum_top = SOURCING_LNUM;
 
   // Do not define the function when getting the body fails and when skipping.
-  if (get_function_body(eap, &newlines, line_arg, &line_to_free, show_block) == FAIL
+  if (get_function_body(eap, &newlines, &noop_lines, line_arg, &line_to_free,
+                        show_block) == FAIL
       || eap->skip) {
     goto erret;
   }
@@ -2953,6 +2969,7 @@ void ex_function(exarg_T *eap)
   fp->uf_args = newargs;
   fp->uf_def_args = default_args;
   fp->uf_lines = newlines;
+  fp->uf_noop_lines = noop_lines.ga_data;
   if ((flags & FC_CLOSURE) != 0) {
     register_closure(fp);
   } else {
@@ -2990,6 +3007,7 @@ errret_keep:
   ga_clear_strings(&newargs);
   ga_clear_strings(&default_args);
   ga_clear_strings(&newlines);
+  ga_clear(&noop_lines);
 ret_free:
   xfree(line_to_free);
   xfree(fudi.fd_newkey);
@@ -3169,6 +3187,7 @@ void ex_delfunction(exarg_T *eap)
         // do remove it from the hashtable.
         if (func_remove(fp)) {
           fp->uf_refcount--;
+          gc_unref_count++;
         }
         fp->uf_flags |= FC_DELETED;
       } else {
@@ -3210,12 +3229,17 @@ void func_unref(char *name)
 /// @param  fp  Function to unreference.
 void func_ptr_unref(ufunc_T *fp)
 {
-  if (fp != NULL && --fp->uf_refcount <= 0) {
+  if (fp == NULL) {
+    return;
+  }
+  if (--fp->uf_refcount <= 0) {
     // Only delete it when it's not being used. Otherwise it's done
     // when "uf_calls" becomes zero.
     if (fp->uf_calls == 0) {
       func_clear_free(fp, false);
     }
+  } else {
+    gc_unref_count++;
   }
 }
 
@@ -3739,8 +3763,14 @@ char *get_func_line(int c, void *cookie, int indent, bool do_concat)
     retval = NULL;
   } else {
     // Skip NULL lines (continuation lines).
+    // When executing, also skip lines which do nothing, unless they are
+    // profiled, traced or might have a breakpoint. Other callers (heredoc,
+    // ":append", nested function) need every line.
+    bool skip_noop = c == ':' && fp->uf_noop_lines != NULL && fcp->fc_breakpoint == 0
+                     && do_profiling != PROF_YES && p_verbose < 15;
     while (fcp->fc_linenr < gap->ga_len
-           && ((char **)(gap->ga_data))[fcp->fc_linenr] == NULL) {
+           && (((char **)(gap->ga_data))[fcp->fc_linenr] == NULL
+               || (skip_noop && fp->uf_noop_lines[fcp->fc_linenr]))) {
       fcp->fc_linenr++;
     }
     if (fcp->fc_linenr >= gap->ga_len) {
@@ -26,6 +26,7 @@
 // code for redrawing the line with the deleted decoration.
 
 #include <assert.h>
+#include <limits.h>
 #include <stddef.h>
 
 #include "nvim/api/private/defs.h"
@@ -33,6 +34,7 @@
 #include "nvim/buffer_updates.h"
 #include "nvim/decoration.h"
 #include "nvim/decoration_defs.h"
+#include "nvim/drawscreen.h"
 #include "nvim/extmark.h"
 #include "nvim/extmark_defs.h"
 #include "nvim/globals.h"
@@ -108,6 +110,51 @@ revised:
   }
 }
 
+/// Create many new extmarks in namespace "ns_id" at once
+///
+/// Ids are allocated in the order of "items" and stored in them. The marks are
+/// added with marktree_put_bulk(), and the buffer is invalidated and redrawn
+/// once for the whole range instead of once per mark.
+///
+/// Only inline decorations are supported.
+///
+/// must not be used during iteration!
+void extmark_set_bulk(buf_T *buf, uint32_t ns_id, ExtmarkBulkItem *items, size_t count,
+                      bool right_gravity, bool end_right_gravity, bool no_undo, bool invalidate)
+{
+  if (count == 0) {
+    return;
+  }
+
+  uint32_t *ns = map_put_ref(uint32_t, uint32_t)(buf->b_extmark_ns, ns_id, NULL, NULL);
+  MTPair *marks = xmalloc(count * sizeof(*marks));
+  int redraw_top = INT_MAX;
+  int redraw_bot = -1;
+  for (size_t i = 0; i < count; i++) {
+    ExtmarkBulkItem *item = &items[i];
+    assert(!item->decor.ext);
+    item->id = ++*ns;
+    uint16_t flags = mt_flags(right_gravity, no_undo, invalidate, false) | item->decor_flags;
+    marks[i] = (MTPair){
+      .start = { { item->row, item->col }, ns_id, item->id, flags, item->decor.data },
+      .end_pos = { item->end_row, item->end_col },
+      .end_right_gravity = end_right_gravity,
+    };
+
+    if (item->decor_flags) {
+      redraw_top = MIN(redraw_top, item->row);
+      redraw_bot = MAX(redraw_bot, item->end_row > -1 ? item->end_row : item->row);
+    }
+  }
+  marktree_put_bulk(buf->b_marktree, marks, count);
+  xfree(marks);
+
+  decor_state_invalidate(buf);
+  if (redraw_bot >= redraw_top) {
+    redraw_buf_range_later(buf, redraw_top + 1, redraw_bot + 1);
+  }
+}
+
 static void extmark_setraw(buf_T *buf, uint64_t mark, int row, colnr_T col, bool invalid)
 {
   MarkTreeIter itr[1] = { 0 };
@@ -215,9 +262,13 @@ bool extmark_clear(buf_T *buf, uint32_t ns_id, int l_row, colnr_T l_col, int u_r
     }
   }
 
-  bool marks_cleared_any = false;
   bool marks_cleared_all = l_row == 0 && l_col == 0;
 
+  // Collect the marks first, so that they can be deleted in bulk.
+  kvec_t(MTPair) marks = KV_INITIAL_VALUE;
+  // Sides of pairs whose other side was already deleted, deleted one by one.
+  kvec_t(MTKey) orphans = KV_INITIAL_VALUE;
+  bool any_signtext = false;
   MarkTreeIter itr[1] = { 0 };
   marktree_itr_get(buf->b_marktree, l_row, l_col, itr);
   while (true) {
@@ -231,12 +282,61 @@ bool extmark_clear(buf_T *buf, uint32_t ns_id, int l_row, colnr_T l_col, int u_r
       break;
     }
     if (mark.ns == ns_id || all_ns) {
-      marks_cleared_any = true;
-      extmark_del(buf, itr, mark, true);
-    } else {
-      marktree_itr_next(buf->b_marktree, itr);
+      MTKey alt = marktree_get_alt(buf->b_marktree, mark, NULL);
+      if (mt_paired(mark) && alt.pos.row < 0) {
+        kv_push(orphans, mark);
+      } else if (!mt_end(mark)) {
+        kv_push(marks, mtpair_from(mark, alt));
+      } else if (alt.pos.row < l_row || (alt.pos.row == l_row && alt.pos.col < l_col)) {
+        // start is before the range, otherwise it was already added
+        kv_push(marks, mtpair_from(alt, mark));
+      }
+      any_signtext |= (mark.flags & MT_FLAG_DECOR_SIGNTEXT) && !mt_invalid(mark);
+    }
+    marktree_itr_next(buf->b_marktree, itr);
+  }
+
+  bool marks_cleared_any = kv_size(marks) > 0 || kv_size(orphans) > 0;
+  for (size_t i = 0; i < kv_size(orphans); i++) {
+    MTKey orphan = kv_A(orphans, i);
+    MTKey mark = marktree_lookup_ns(buf->b_marktree, orphan.ns, orphan.id, mt_end(orphan), itr);
+    if (mark.pos.row >= 0) {
+      extmark_del(buf, itr, mark, false);
+    }
+  }
+  kv_destroy(orphans);
+
+  if (any_signtext) {
+    // "b_signcols" is updated incrementally as each sign is removed
+    for (size_t i = 0; i < kv_size(marks); i++) {
+      MTKey mark = marktree_lookup_ns(buf->b_marktree, kv_A(marks, i).start.ns,
+                                      kv_A(marks, i).start.id, false, itr);
+      if (mark.pos.row >= 0) {
+        extmark_del(buf, itr, mark, false);
+      }
+    }
+  } else if (marks_cleared_any) {
+    uint64_t *ids = xmalloc(kv_size(marks) * sizeof(*ids));
+    for (size_t i = 0; i < kv_size(marks); i++) {
+      ids[i] = mt_lookup_key_side(kv_A(marks, i).start, false);
+    }
+    marktree_del_bulk(buf->b_marktree, ids, kv_size(marks));
+    xfree(ids);
+
+    for (size_t i = 0; i < kv_size(marks); i++) {
+      MTPair pair = kv_A(marks, i);
+      if (!mt_decor_any(pair.start)) {
+        continue;
+      }
+      if (mt_invalid(pair.start)) {
+        decor_free(mt_decor(pair.start));
+      } else {
+        buf_decor_remove(buf, pair.start.pos.row, pair.end_pos.row, pair.start.pos.col,
+                         mt_decor(pair.start), true);
+      }
     }
   }
+  kv_destroy(marks);
 
   if (marks_cleared_all) {
     if (all_ns) {
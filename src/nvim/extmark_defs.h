@@ -1,6 +1,10 @@
 #pragma once
 
+#include <stdint.h>
+
 #include "klib/kvec.h"
+#include "nvim/decoration_defs.h"
+#include "nvim/pos_defs.h"
 
 // TODO(bfredl): good enough name for now.
 typedef ptrdiff_t bcount_t;
@@ -16,3 +20,14 @@ typedef enum {
   kExtmarkNoUndo,      // Operation should not be reversible
   kExtmarkUndoNoRedo,  // Operation should be undoable, but not redoable
 } ExtmarkOp;
+
+/// Mark to be added by extmark_set_bulk()
+typedef struct {
+  int row;
+  colnr_T col;
+  int end_row;          ///< -1 if the mark has no end position
+  colnr_T end_col;
+  DecorInline decor;    ///< Only inline decorations (ext=false)
+  uint16_t decor_flags;
+  uint32_t id;          ///< Allocated id, set by extmark_set_bulk()
+} ExtmarkBulkItem;
@@ -61,6 +61,7 @@
 #include "nvim/os/os_defs.h"
 #include "nvim/os/time.h"
 #include "nvim/path.h"
+#include "nvim/plines.h"
 #include "nvim/pos_defs.h"
 #include "nvim/regexp.h"
 #include "nvim/regexp_defs.h"
@@ -1674,6 +1675,7 @@ failed:
     }
     if (newfile || read_buffer) {
       redraw_curbuf_later(UPD_NOT_VALID);
+      plines_cache_invalidate_buf(curbuf);
       // After reading the text into the buffer the diff info needs to
       // be updated.
       diff_invalidate(curbuf);
@@ -2891,13 +2891,15 @@ static void foldlevelExpr(fline_T *flp)
     flp->lvl = 0;
   }
 
-  // KeyTyped may be reset to 0 when calling a function which invokes
-  // do_cmdline().  To make 'foldopen' work correctly restore KeyTyped.
-  const bool save_keytyped = KeyTyped;
-
   int c;
-  const int n = eval_foldexpr(flp->wp, &c);
-  KeyTyped = save_keytyped;
+  int n;
+  if (!fold_levels_get(flp->wp, lnum, &n, &c)) {
+    // KeyTyped may be reset to 0 when calling a function which invokes
+    // do_cmdline().  To make 'foldopen' work correctly restore KeyTyped.
+    const bool save_keytyped = KeyTyped;
+    n = eval_foldexpr(flp->wp, &c);
+    KeyTyped = save_keytyped;
+  }
 
   switch (c) {
   // "a1", "a2", .. : add to the fold level
@@ -3064,6 +3066,147 @@ static void foldlevelSyntax(fline_T *flp)
   }
 }
 
+// Fold levels computed for a whole buffer. {{{1
+// The treesitter fold module computes the fold level of every line of a buffer
+// at once and stores them in b_fold_levels.  A window whose 'foldexpr' reads
+// them is marked with fold_levels_attach(), after which the levels are used
+// directly instead of evaluating 'foldexpr' for every line.
+// A level is -1 when it is unknown, otherwise the level shifted left by one,
+// with the lowest bit set when a fold starts at the line.
+
+// fold_levels_reset() {{{2
+/// Forget the fold levels of "buf".
+///
+/// @param active  the levels are maintained, lines without a level get 0
+void fold_levels_reset(buf_T *buf, bool active)
+{
+  kv_destroy(buf->b_fold_levels);
+  buf->b_fold_levels_active = active;
+}
+
+// fold_levels_splice() {{{2
+/// Replace the levels of "old_count" lines from "row" (0-based) with
+/// "new_count" unknown levels, after lines were deleted or inserted.
+void fold_levels_splice(buf_T *buf, int row, int old_count, int new_count)
+{
+  size_t size = kv_size(buf->b_fold_levels);
+  if (row < 0 || (size_t)row > size || old_count < 0 || new_count < 0) {
+    return;
+  }
+  size_t start = (size_t)row;
+  size_t n_old = MIN((size_t)old_count, size - start);
+  size_t n_new = (size_t)new_count;
+  if (n_new > n_old) {
+    kv_ensure_space(buf->b_fold_levels, n_new - n_old);
+  }
+  int32_t *items = buf->b_fold_levels.items;
+  if (size > start + n_old) {
+    memmove(items + start + n_new, items + start + n_old,
+            (size - start - n_old) * sizeof(*items));
+  }
+  for (size_t i = 0; i < n_new; i++) {
+    items[start + i] = -1;
+  }
+  kv_size(buf->b_fold_levels) = size - n_old + n_new;
+}
+
+// fold_levels_set() {{{2
+/// Compute the levels of lines "srow" to "erow" (0-based, exclusive) of "buf"
+/// from the number of folds which start and end at each line.
+///
+/// "enter" and "leave" hold the counts of the lines "srow - 1" to "erow - 1",
+/// so that the folds ending at the line above the range are accounted for.
+void fold_levels_set(buf_T *buf, int srow, int erow, const int *enter, const int *leave)
+{
+  if (erow <= srow) {
+    return;
+  }
+  buf->b_fold_levels_active = true;
+  if (kv_size(buf->b_fold_levels) < (size_t)erow) {
+    size_t size = kv_size(buf->b_fold_levels);
+    kv_ensure_space(buf->b_fold_levels, (size_t)erow - size);
+    for (size_t i = size; i < (size_t)erow; i++) {
+      kv_A(buf->b_fold_levels, i) = -1;
+    }
+    kv_size(buf->b_fold_levels) = (size_t)erow;
+  }
+
+  int level_prev = 0;
+  if (srow > 0 && kv_A(buf->b_fold_levels, srow - 1) > 0) {
+    level_prev = kv_A(buf->b_fold_levels, srow - 1) >> 1;
+  }
+  int leave_prev = leave[0];
+
+  for (int row = srow; row < erow; row++) {
+    int enter_line = enter[row - srow + 1];
+    int leave_line = leave[row - srow + 1];
+    int level = level_prev - leave_prev + enter_line;
+
+    // The expression interface can't tell that two folds start at a line, so
+    // "( ( ) ) ( ( ) )" and "( ( ) ( ) )" get the same levels and are read as
+    // the latter.
+    if (enter_line > 0 && leave_line > 0) {
+      // This line ends a fold and starts another one: end the first fold on
+      // the previous line, so that the second one gets the right level here.
+      level -= leave_line;
+      leave_line = 0;
+    }
+
+    kv_A(buf->b_fold_levels, row) = (MAX(level, 0) << 1) | (enter_line > 0);
+    leave_prev = leave_line;
+    level_prev = level;
+  }
+}
+
+// fold_levels_attach() {{{2
+/// Read the fold levels of the buffer in "wp" as long as its 'foldexpr' is not
+/// changed, instead of evaluating the expression.
+void fold_levels_attach(win_T *wp)
+{
+  if (wp->w_fold_levels_fde == NULL || strcmp(wp->w_fold_levels_fde, wp->w_p_fde) != 0) {
+    xfree(wp->w_fold_levels_fde);
+    wp->w_fold_levels_fde = xstrdup(wp->w_p_fde);
+  }
+}
+
+// fold_levels_get() {{{2
+/// Get the fold level of line "lnum" in "wp" from the fold levels of its
+/// buffer, if "wp" is attached to them.
+///
+/// @return  false if 'foldexpr' must be evaluated.
+static bool fold_levels_get(win_T *wp, linenr_T lnum, int *np, int *cp)
+{
+  if (!wp->w_buffer->b_fold_levels_active || wp->w_fold_levels_fde == NULL
+      || strcmp(wp->w_fold_levels_fde, wp->w_p_fde) != 0) {
+    return false;
+  }
+  fold_levels_lookup(wp, lnum, np, cp);
+  return true;
+}
+
+// fold_levels_lookup() {{{2
+/// Get the fold level of line "lnum" in "wp" from the fold levels of its
+/// buffer, like eval_foldexpr() returns it.
+void fold_levels_lookup(win_T *wp, linenr_T lnum, int *np, int *cp)
+{
+  buf_T *buf = wp->w_buffer;
+  *np = 0;
+  *cp = NUL;
+  if (lnum < 1 || (size_t)lnum > kv_size(buf->b_fold_levels)) {
+    return;
+  }
+  int32_t level = kv_A(buf->b_fold_levels, lnum - 1);
+  if (level < 0) {
+    *np = -1;
+  } else if ((level >> 1) > wp->w_p_fdn) {
+    // Clamp at 'foldnestmax', without starting a fold.
+    *np = (int)wp->w_p_fdn;
+  } else {
+    *np = level >> 1;
+    *cp = (level & 1) ? '>' : NUL;
+  }
+}
+
 // functions for storing the fold state in a View {{{1
 // put_folds() {{{2
 /// Write commands to "fd" to restore the manual folds in window "wp".
@@ -1493,7 +1493,7 @@ void before_blocking(void)
 {
   updatescript(0);
   if (may_garbage_collect) {
-    garbage_collect(false);
+    garbage_collect_idle();
   }
 }
 
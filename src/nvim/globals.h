@@ -85,7 +85,13 @@ EXTERN struct nvim_stats_s {
   int64_t fsync;
   int64_t redraw;
   int16_t log_skip;  // How many logs were tried and skipped before log_init.
-} g_stats INIT( = { 0, 0, 0 });
+  int64_t gc;        // Number of Vimscript garbage collections.
+  int64_t gc_skip;   // Idle garbage collections skipped as nothing could be freed.
+  int64_t gc_freed;  // Lists and dicts freed by garbage collection.
+  uint64_t gc_time_last;   // Duration of the last garbage collection, in nanoseconds.
+  uint64_t gc_time_max;
+  uint64_t gc_time_total;
+} g_stats INIT( = { 0, 0, 0, 0, 0, 0, 0, 0, 0 });
 
 // Values for "starting".
 #define NO_SCREEN       2       // no screen updating yet
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nvim/func_attr.h"
+#include "nvim/math.h"
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "json_scan.h.inline.generated.h"
+#endif
+
+/// Return the number of bytes at the start of "s" which can be copied to or
+/// from a JSON string literal as they are.
+///
+/// These are printable ASCII characters other than '"' and '\\'.  Used by both
+/// json_encode()/json_decode() and vim.json to handle the (usually long) runs
+/// of plain text between escapes and non-ASCII characters in bulk.
+///
+/// @param[in]  s  String to scan.
+/// @param[in]  len  Length of "s".
+static inline size_t json_plain_len(const char *const s, const size_t len)
+  FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_ALWAYS_INLINE
+{
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i del = _mm_set1_epi8(0x7f);
+  for (; i + 16 <= len; i += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    // Signed comparison: bytes 0x80 and above are negative, so this also
+    // catches non-ASCII bytes besides control characters.
+    const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                      _mm_cmpeq_epi8(v, backslash)),
+                                         _mm_or_si128(_mm_cmplt_epi8(v, space),
+                                                      _mm_cmpeq_epi8(v, del)));
+    const unsigned mask = (unsigned)_mm_movemask_epi8(special);
+    if (mask != 0) {
+      return i + (size_t)xctz(mask);
+    }
+  }
+#else
+  // Check eight bytes at a time: set the high bit of every byte which is
+  // below 0x20, above 0x7e, '"' or '\\'.
+# define ONES UINT64_C(0x0101010101010101)
+# define HIGHS UINT64_C(0x8080808080808080)
+# define HAS_ZERO(x) (((x) - ONES) & ~(x) & HIGHS)
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    memcpy(&w, s + i, sizeof(w));
+    const uint64_t special = (w & HIGHS)
+                             | ((w - ONES * 0x20) & ~w & HIGHS)
+                             | HAS_ZERO(w ^ (ONES * '"'))
+                             | HAS_ZERO(w ^ (ONES * '\\'))
+                             | HAS_ZERO(w ^ (ONES * 0x7f));
+    if (special != 0) {
+      break;
+    }
+  }
+# undef ONES
+# undef HIGHS
+# undef HAS_ZERO
+#endif
+  for (; i < len; i++) {
+    const uint8_t c = (uint8_t)s[i];
+    if (c < 0x20 || c >= 0x7f || c == '"' || c == '\\') {
+      break;
+    }
+  }
+  return i;
+}
@@ -1060,6 +1060,41 @@ typedef struct {
   bool container;  ///< True if tv is a container.
 } ObjPopStackItem;
 
+/// Convert a nil, boolean, number or string value to object
+///
+/// Does not pop the value from the stack.
+///
+/// @return false if the value is of another type.
+static bool nlua_scalar_to_object(lua_State *const lstate, Arena *arena, Object *const obj)
+{
+  switch (lua_type(lstate, -1)) {
+  case LUA_TNIL:
+    *obj = NIL;
+    return true;
+  case LUA_TBOOLEAN:
+    *obj = BOOLEAN_OBJ(lua_toboolean(lstate, -1));
+    return true;
+  case LUA_TSTRING: {
+    size_t len;
+    const char *s = lua_tolstring(lstate, -1, &len);
+    *obj = STRING_OBJ(CBUF_TO_ARENA_STR(arena, s, len));
+    return true;
+  }
+  case LUA_TNUMBER: {
+    const lua_Number n = lua_tonumber(lstate, -1);
+    if (n > (lua_Number)API_INTEGER_MAX || n < (lua_Number)API_INTEGER_MIN
+        || ((lua_Number)((Integer)n)) != n) {
+      *obj = FLOAT_OBJ((Float)n);
+    } else {
+      *obj = INTEGER_OBJ((Integer)n);
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
 /// Convert Lua table to object
 ///
 /// Always pops one value from the stack.
@@ -1067,8 +1102,15 @@ Object nlua_pop_Object(lua_State *const lstate, bool ref, Arena *arena, Error *c
   FUNC_ATTR_NONNULL_ARG(1, 4) FUNC_ATTR_WARN_UNUSED_RESULT
 {
   Object ret = NIL;
+  // Most arguments are not containers: convert them without the traversal stack.
+  if (nlua_scalar_to_object(lstate, arena, &ret)) {
+    lua_pop(lstate, 1);
+    return ret;
+  }
+
   const int initial_size = lua_gettop(lstate);
-  kvec_withinit_t(ObjPopStackItem, 2) stack = KV_INITIAL_VALUE;
+  // Deep enough for the nesting of e.g. extmark virt_lines without allocating.
+  kvec_withinit_t(ObjPopStackItem, 8) stack = KV_INITIAL_VALUE;
   kvi_init(stack);
   kvi_push(stack, ((ObjPopStackItem){ .obj = &ret }));
   while (!ERROR_SET(err) && kv_size(stack)) {
@@ -1121,28 +1163,11 @@ Object nlua_pop_Object(lua_State *const lstate, bool ref, Arena *arena, Error *c
     }
     assert(!cur.container);
     *cur.obj = NIL;
-    switch (lua_type(lstate, -1)) {
-    case LUA_TNIL:
-      break;
-    case LUA_TBOOLEAN:
-      *cur.obj = BOOLEAN_OBJ(lua_toboolean(lstate, -1));
-      break;
-    case LUA_TSTRING: {
-      size_t len;
-      const char *s = lua_tolstring(lstate, -1, &len);
-      *cur.obj = STRING_OBJ(CBUF_TO_ARENA_STR(arena, s, len));
-      break;
-    }
-    case LUA_TNUMBER: {
-      const lua_Number n = lua_tonumber(lstate, -1);
-      if (n > (lua_Number)API_INTEGER_MAX || n < (lua_Number)API_INTEGER_MIN
-          || ((lua_Number)((Integer)n)) != n) {
-        *cur.obj = FLOAT_OBJ((Float)n);
-      } else {
-        *cur.obj = INTEGER_OBJ((Integer)n);
-      }
-      break;
+    if (nlua_scalar_to_object(lstate, arena, cur.obj)) {
+      lua_pop(lstate, 1);
+      continue;
     }
+    switch (lua_type(lstate, -1)) {
     case LUA_TTABLE: {
       const LuaTableProps table_props = nlua_traverse_table(lstate);
 
@@ -63,6 +63,7 @@
 #include "nvim/runtime.h"
 #include "nvim/runtime_defs.h"
 #include "nvim/strings.h"
+#include "nvim/trace.h"
 #include "nvim/ui.h"
 #include "nvim/ui_defs.h"
 #include "nvim/undo.h"
@@ -1577,6 +1578,7 @@ Object nlua_call_ref(LuaRef ref, const char *name, Array args, LuaRetMode mode,
 Object nlua_call_ref_ctx(bool fast, LuaRef ref, const char *name, Array args, LuaRetMode mode,
                          Arena *arena, Error *err)
 {
+  TRACE_BEGIN("lua_callback", name);
   lua_State *const lstate = global_lstate;
   nlua_pushref(lstate, ref);
   int nargs = (int)args.size;
@@ -1592,6 +1594,7 @@ Object nlua_call_ref_ctx(bool fast, LuaRef ref, const char *name, Array args, Lu
     if (nlua_fast_cfpcall(lstate, nargs, 1, -1) < 0) {
       // error is already scheduled, set anyways to convey failure.
       api_set_error(err, kErrorTypeException, "fast context failure");
+      TRACE_END("lua_callback");
       return NIL;
     }
   } else if (nlua_pcall(lstate, nargs, 1)) {
@@ -1603,10 +1606,13 @@ Object nlua_call_ref_ctx(bool fast, LuaRef ref, const char *name, Array args, Lu
     } else {
       nlua_error(lstate, _("Lua callback: %.*s"));
     }
+    TRACE_END("lua_callback");
     return NIL;
   }
 
-  return nlua_call_pop_retval(lstate, mode, arena, err);
+  Object retval = nlua_call_pop_retval(lstate, mode, arena, err);
+  TRACE_END("lua_callback");
+  return retval;
 }
 
 static Object nlua_call_pop_retval(lua_State *lstate, LuaRetMode mode, Arena *arena, Error *err)
@@ -0,0 +1,476 @@
+// Reader for JSON-RPC messages framed with a "Content-Length" header, as used
+// by LSP. Large messages are decoded on a worker thread, see vim._jsonrpc_reader().
+
+#include <assert.h>
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <uv.h>
+
+#include "cjson/lua_cjson.h"
+#include "klib/kvec.h"
+#include "nvim/ascii_defs.h"
+#include "nvim/event/defs.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
+#include "nvim/gettext_defs.h"
+#include "nvim/lua/executor.h"
+#include "nvim/lua/jsonrpc.h"
+#include "nvim/macros_defs.h"
+#include "nvim/main.h"
+#include "nvim/memory.h"
+#include "nvim/strings.h"
+#include "nvim/trace.h"
+#include "nvim/types_defs.h"
+
+#define JSONRPC_READER_META "nvim_jsonrpc_reader"
+
+/// Messages with a body at least this big are decoded on a worker thread. For
+/// smaller ones handing them over costs more than decoding them right away.
+#define JSONRPC_ASYNC_SIZE (64 * 1024)
+
+/// Messages with a bigger body are rejected, the header is assumed to be bogus.
+#define JSONRPC_MAX_CONTENT_LENGTH ((size_t)1024 * 1024 * 1024)
+
+/// At most this much space is reserved for a body before it is received, the
+/// buffer grows further as the bytes arrive.
+#define JSONRPC_RESERVE_SIZE ((size_t)1024 * 1024)
+
+typedef struct JsonRpcReader JsonRpcReader;
+typedef struct JsonRpcMessage JsonRpcMessage;
+
+/// A received message. Messages are delivered in the order they were received,
+/// so a message waits in the queue until the ones before it are decoded.
+struct JsonRpcMessage {
+  uv_work_t req;
+  JsonRpcReader *reader;
+  JsonRpcMessage *next;
+
+  char *data;  ///< allocation holding the body, freed once decoded
+  const char *body;  ///< NUL-terminated
+  size_t len;
+
+  json_tape_t *tape;
+  char *error;  ///< framing error, instead of a body
+  bool decoded;  ///< only accessed on the main thread
+};
+
+struct JsonRpcReader {
+  StringBuilder buf;  ///< received bytes which are not part of a message yet
+  size_t pos;  ///< start of the unread bytes in "buf"
+  size_t scanned;  ///< bytes after "pos" known not to end the header
+  size_t content_length;  ///< of the body being read, SIZE_MAX while reading a header
+
+  JsonRpcMessage *head;
+  JsonRpcMessage *tail;
+  int pending;  ///< messages being decoded on worker threads
+  bool delivering;
+
+  bool luanil_object;
+  bool luanil_array;
+  LuaRef on_message;
+  LuaRef on_done;  ///< set by finish(), called once all messages are delivered
+  LuaRef self_ref;  ///< keeps the reader alive while messages are pending
+};
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "lua/jsonrpc.c.generated.h"
+#endif
+
+static const char *find_header_end(const char *data, size_t len)
+{
+  const char *end = data + len;
+  const char *p = data;
+  while (end - p >= 4 && (p = memchr(p, '\r', (size_t)(end - p - 3))) != NULL) {
+    if (memcmp(p, "\r\n\r\n", 4) == 0) {
+      return p;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+/// Finds a "Content-Length: <digits>" line in the header, the key is case insensitive.
+static bool get_content_length(const char *header, size_t len, size_t *content_length)
+{
+  const char *end = header + len;
+  const char *line = header;
+  while (line < end) {
+    const char *eol = memchr(line, '\n', (size_t)(end - line));
+    eol = eol ? eol : end;
+
+    const char *p = line;
+    line = eol + 1;
+    while (p < eol && ascii_isspace(*p)) {
+      p++;
+    }
+    if (eol - p < 14 || STRNICMP(p, "content-length", 14) != 0) {
+      continue;
+    }
+    p += 14;
+    while (p < eol && ascii_iswhite(*p)) {
+      p++;
+    }
+    if (p == eol || *p++ != ':') {
+      continue;
+    }
+    while (p < eol && ascii_iswhite(*p)) {
+      p++;
+    }
+    if (p == eol || !ascii_isdigit(*p)) {
+      continue;
+    }
+    size_t n = 0;
+    while (p < eol && ascii_isdigit(*p)) {
+      if (n > (SIZE_MAX - 9) / 10) {
+        return false;
+      }
+      n = n * 10 + (size_t)(*p++ - '0');
+    }
+    while (p < eol && ascii_isspace(*p)) {
+      p++;
+    }
+    if (p == eol) {
+      *content_length = n;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void reader_compact(JsonRpcReader *r)
+{
+  if (r->pos == 0) {
+    return;
+  }
+  size_t rest = kv_size(r->buf) - r->pos;
+  memmove(r->buf.items, r->buf.items + r->pos, rest);
+  kv_size(r->buf) = rest;
+  r->pos = 0;
+}
+
+/// Splits the next message off the received bytes.
+///
+/// @return false if more bytes are needed
+static bool reader_next_message(lua_State *L, JsonRpcReader *r)
+{
+  char *data = r->buf.items + r->pos;
+  size_t avail = kv_size(r->buf) - r->pos;
+
+  if (r->content_length == SIZE_MAX) {
+    size_t from = r->scanned >= 3 ? r->scanned - 3 : 0;
+    const char *header_end = find_header_end(data + from, avail - from);
+    if (!header_end) {
+      r->scanned = avail;
+      return false;
+    }
+    size_t header_len = (size_t)(header_end - data) + 4;
+    r->pos += header_len;
+    r->scanned = 0;
+
+    const bool found = get_content_length(data, header_len, &r->content_length);
+    if (!found || r->content_length > JSONRPC_MAX_CONTENT_LENGTH) {
+      StringBuilder err = KV_INITIAL_VALUE;
+      if (found) {
+        kv_printf(err, "Content-Length too large: %zu", r->content_length);
+      } else {
+        kv_concat(err, "Content-Length not found in header: ");
+        kv_concat_len(err, data, header_len);
+      }
+      kv_push(err, NUL);
+      r->content_length = SIZE_MAX;
+      JsonRpcMessage *msg = xcalloc(1, sizeof(*msg));
+      msg->error = err.items;
+      reader_enqueue(L, r, msg);
+      return true;
+    }
+
+    data += header_len;
+    avail -= header_len;
+    if (avail < r->content_length) {
+      // Reserve space for the rest of the body, so that it is mostly received
+      // without reallocations and handed over without a copy.  Don't trust
+      // the header with more than a bounded allocation up front.
+      reader_compact(r);
+      kv_ensure_space(r->buf, MIN(r->content_length - avail, JSONRPC_RESERVE_SIZE) + 1);
+      return false;
+    }
+  } else if (avail < r->content_length) {
+    return false;
+  }
+
+  JsonRpcMessage *msg = xcalloc(1, sizeof(*msg));
+  msg->len = r->content_length;
+  if (avail == r->content_length) {
+    // the body is all that is left: take over the buffer
+    kv_ensure_space(r->buf, 1);
+    r->buf.items[kv_size(r->buf)] = NUL;
+    msg->data = r->buf.items;
+    msg->body = r->buf.items + r->pos;
+    kv_init(r->buf);
+    r->pos = 0;
+  } else {
+    msg->data = xmemdupz(data, msg->len);
+    msg->body = msg->data;
+    r->pos += msg->len;
+  }
+  r->content_length = SIZE_MAX;
+
+  reader_enqueue(L, r, msg);
+  return true;
+}
+
+static void reader_enqueue(lua_State *L, JsonRpcReader *r, JsonRpcMessage *msg)
+{
+  msg->reader = r;
+  if (r->tail) {
+    r->tail->next = msg;
+  } else {
+    r->head = msg;
+  }
+  r->tail = msg;
+
+  if (msg->error || msg->len < JSONRPC_ASYNC_SIZE) {
+    message_decode(msg);
+    msg->decoded = true;
+    return;
+  }
+
+  if (r->pending++ == 0) {
+    lua_pushvalue(L, 1);
+    r->self_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  }
+  msg->req.data = msg;
+  uv_queue_work(&main_loop.uv, &msg->req, message_work, message_after);
+}
+
+static void message_decode(JsonRpcMessage *msg)
+{
+  if (!msg->error) {
+    msg->tape = lua_cjson_tape_parse(msg->body, msg->len);
+  }
+  XFREE_CLEAR(msg->data);
+  msg->body = NULL;
+}
+
+static void message_work(uv_work_t *req)
+{
+  TRACE_BEGIN("jsonrpc_decode", NULL);
+  message_decode(req->data);
+  TRACE_END("jsonrpc_decode");
+}
+
+static void message_after(uv_work_t *req, int status)
+{
+  // Lua code should not run inside a libuv callback, so defer delivery to the
+  // main event queue like vim.schedule().
+  multiqueue_put(main_loop.events, message_event, req->data);
+}
+
+static void message_event(void **argv)
+{
+  JsonRpcMessage *msg = argv[0];
+  JsonRpcReader *r = msg->reader;
+  lua_State *L = get_global_lstate();
+
+  msg->decoded = true;
+  r->pending--;
+  reader_deliver(L, r, false);
+
+  if (r->pending == 0 && r->self_ref != LUA_NOREF) {
+    luaL_unref(L, LUA_REGISTRYINDEX, r->self_ref);
+    r->self_ref = LUA_NOREF;
+  }
+}
+
+static void message_free(JsonRpcMessage *msg)
+{
+  lua_cjson_tape_free(msg->tape);
+  xfree(msg->error);
+  xfree(msg->data);
+  xfree(msg);
+}
+
+/// Calls the callback for the decoded messages at the head of the queue.
+///
+/// @param rethrow  called from Lua: let errors from the callback propagate
+///                 instead of reporting them
+static void reader_deliver(lua_State *L, JsonRpcReader *r, bool rethrow)
+{
+  if (r->delivering) {
+    // a callback is running, the loop below will get to the new messages
+    return;
+  }
+  r->delivering = true;
+
+  while (r->head && r->head->decoded) {
+    JsonRpcMessage *msg = r->head;
+    r->head = msg->next;
+    if (!r->head) {
+      r->tail = NULL;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, r->on_message);  // [cb]
+    const char *err = msg->error ? msg->error : lua_cjson_tape_error(msg->tape);
+    if (err) {
+      lua_pushnil(L);
+      lua_pushstring(L, err);  // [cb, nil, err]
+    } else {
+      lua_cjson_tape_push(L, msg->tape, r->luanil_object, r->luanil_array);
+      lua_pushnil(L);  // [cb, value, nil]
+    }
+    message_free(msg);
+
+    if (nlua_pcall(L, 2, 0)) {
+      r->delivering = false;
+      if (rethrow) {
+        lua_error(L);
+      }
+      nlua_error(L, _("jsonrpc message callback: %.*s"));
+      r->delivering = true;
+    }
+  }
+
+  r->delivering = false;
+
+  if (!r->head && r->on_done != LUA_NOREF) {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, r->on_done);
+    luaL_unref(L, LUA_REGISTRYINDEX, r->on_done);
+    r->on_done = LUA_NOREF;
+    if (nlua_pcall(L, 0, 0)) {
+      if (rethrow) {
+        lua_error(L);
+      }
+      nlua_error(L, _("jsonrpc done callback: %.*s"));
+    }
+  }
+}
+
+static JsonRpcReader *reader_check(lua_State *L)
+{
+  return luaL_checkudata(L, 1, JSONRPC_READER_META);
+}
+
+/// reader:feed(chunk): splits the received bytes into messages. Decoded
+/// messages are passed to the callback, in order, before this returns or later
+/// from the event loop.
+static int reader_feed(lua_State *L)
+{
+  JsonRpcReader *r = reader_check(L);
+  size_t len;
+  const char *chunk = luaL_checklstring(L, 2, &len);
+
+  kv_concat_len(r->buf, chunk, len);
+  while (reader_next_message(L, r)) {}
+  if (r->pos == kv_size(r->buf)) {
+    kv_size(r->buf) = 0;
+    r->pos = 0;
+  } else if (r->content_length == SIZE_MAX) {
+    reader_compact(r);
+  }
+
+  reader_deliver(L, r, true);
+  return 0;
+}
+
+/// reader:finish(on_done): calls on_done() once the messages received so far
+/// have been delivered.
+static int reader_finish(lua_State *L)
+{
+  JsonRpcReader *r = reader_check(L);
+  luaL_checktype(L, 2, LUA_TFUNCTION);
+
+  if (r->on_done != LUA_NOREF) {
+    luaL_unref(L, LUA_REGISTRYINDEX, r->on_done);
+  }
+  lua_pushvalue(L, 2);
+  r->on_done = luaL_ref(L, LUA_REGISTRYINDEX);
+
+  reader_deliver(L, r, true);
+  return 0;
+}
+
+static int reader_gc(lua_State *L)
+{
+  JsonRpcReader *r = reader_check(L);
+  // self_ref keeps the reader alive while messages are pending
+  assert(r->pending == 0);
+
+  while (r->head) {
+    JsonRpcMessage *msg = r->head;
+    r->head = msg->next;
+    message_free(msg);
+  }
+  kv_destroy(r->buf);
+  luaL_unref(L, LUA_REGISTRYINDEX, r->on_message);
+  luaL_unref(L, LUA_REGISTRYINDEX, r->on_done);
+  return 0;
+}
+
+static int reader_tostring(lua_State *L)
+{
+  lua_pushstring(L, "<jsonrpc reader>");
+  return 1;
+}
+
+static struct luaL_Reg reader_meta[] = {
+  { "__gc", reader_gc },
+  { "__tostring", reader_tostring },
+  { "feed", reader_feed },
+  { "finish", reader_finish },
+  { NULL, NULL }
+};
+
+/// vim._jsonrpc_reader(on_message, opts): creates a reader which calls
+/// on_message(value, err) for every message fed to it. "opts" are the same as
+/// for vim.json.decode().
+static int nlua_jsonrpc_reader(lua_State *L)
+{
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+
+  bool luanil_object = false;
+  bool luanil_array = false;
+  if (!lua_isnoneornil(L, 2)) {
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_getfield(L, 2, "luanil");  // [luanil]
+    if (lua_istable(L, -1)) {
+      lua_getfield(L, -1, "object");
+      luanil_object = lua_toboolean(L, -1);
+      lua_getfield(L, -2, "array");
+      luanil_array = lua_toboolean(L, -1);
+      lua_pop(L, 2);
+    }
+    lua_pop(L, 1);
+  }
+
+  JsonRpcReader *r = lua_newuserdata(L, sizeof(*r));  // [reader]
+  *r = (JsonRpcReader) {
+    .buf = KV_INITIAL_VALUE,
+    .content_length = SIZE_MAX,
+    .luanil_object = luanil_object,
+    .luanil_array = luanil_array,
+    .on_done = LUA_NOREF,
+    .self_ref = LUA_NOREF,
+  };
+  lua_pushvalue(L, 1);
+  r->on_message = luaL_ref(L, LUA_REGISTRYINDEX);
+
+  luaL_getmetatable(L, JSONRPC_READER_META);
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+/// Pushes the vim._jsonrpc_reader() function.
+void nlua_push_jsonrpc_reader(lua_State *L)
+{
+  luaL_newmetatable(L, JSONRPC_READER_META);  // [meta]
+  luaL_register(L, NULL, reader_meta);
+  lua_pushvalue(L, -1);
+  lua_setfield(L, -2, "__index");
+  lua_pop(L, 1);
+
+  lua_pushcfunction(L, &nlua_jsonrpc_reader);
+}
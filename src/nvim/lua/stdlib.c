@@ -19,6 +19,7 @@
 #include "nvim/ascii_defs.h"
 #include "nvim/autocmd.h"
 #include "nvim/autocmd_defs.h"
+#include "nvim/buffer.h"
 #include "nvim/buffer_defs.h"
 #include "nvim/eval/typval.h"
 #include "nvim/eval/typval_defs.h"
@@ -47,6 +48,17 @@
 #include "nvim/types_defs.h"
 #include "nvim/window.h"
 
+#define NLUA_BUF_LINES_META "nvim_buf_lines"
+
+/// Lines of a buffer as returned by vim.buf_lines(). Lines are read from the
+/// memline when they are indexed, as long as the buffer doesn't change.
+typedef struct {
+  handle_T buf;
+  varnumber_T changedtick;
+  linenr_T start;  ///< first line of the view
+  linenr_T count;
+} BufLinesView;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "lua/stdlib.c.generated.h"
 #endif
@@ -322,6 +334,179 @@ int nlua_regex(lua_State *lstate)
   return 1;
 }
 
+/// Creates a view on the lines of a buffer from zero-based "start" to "end_"
+/// (exclusive), without copying them. Negative indices count from the end like
+/// in nvim_buf_get_lines(), and indices out of range are clamped.
+static int nlua_buf_lines(lua_State *lstate)
+{
+  buf_T *buf = nlua_check_buf(lstate, 1);
+  lua_Integer line_count = buf->b_ml.ml_mfp ? buf->b_ml.ml_line_count : 0;
+  lua_Integer start = luaL_optinteger(lstate, 2, 0);
+  lua_Integer end = luaL_optinteger(lstate, 3, -1);
+  start = start < 0 ? line_count + start + 1 : start;
+  end = end < 0 ? line_count + end + 1 : end;
+  start = MAX(MIN(start, line_count), 0);
+  end = MAX(MIN(end, line_count), start);
+
+  BufLinesView *view = lua_newuserdata(lstate, sizeof(BufLinesView));
+  *view = (BufLinesView){
+    .buf = buf->handle,
+    .changedtick = buf_get_changedtick(buf),
+    .start = (linenr_T)start + 1,
+    .count = (linenr_T)(end - start),
+  };
+  lua_getfield(lstate, LUA_REGISTRYINDEX, NLUA_BUF_LINES_META);  // [udata, meta]
+  lua_setmetatable(lstate, -2);  // [udata]
+  return 1;
+}
+
+/// Checks the view at "index" and returns its buffer, which must not have
+/// changed since the view was created.
+static buf_T *buf_lines_check(lua_State *lstate, int index, BufLinesView **viewp)
+{
+  BufLinesView *view = luaL_checkudata(lstate, index, NLUA_BUF_LINES_META);
+  buf_T *buf = handle_get_buffer(view->buf);
+  if (!buf) {
+    luaL_error(lstate, "invalid buffer");
+  } else if (buf_get_changedtick(buf) != view->changedtick
+             || (view->count > 0 && buf->b_ml.ml_mfp == NULL)) {
+    luaL_error(lstate, "buffer has changed since vim.buf_lines() was called");
+  }
+  *viewp = view;
+  return buf;
+}
+
+/// Pushes line "idx" (one-based) of the view, or nil if it is out of range.
+static void buf_lines_push(lua_State *lstate, buf_T *buf, BufLinesView *view, lua_Integer idx)
+{
+  if (idx < 1 || idx > view->count) {
+    lua_pushnil(lstate);
+    return;
+  }
+  linenr_T lnum = view->start + (linenr_T)idx - 1;
+  char *line = ml_get_buf(buf, lnum);
+  size_t len = (size_t)ml_get_buf_len(buf, lnum);
+  if (memchr(line, NL, len) == NULL) {
+    lua_pushlstring(lstate, line, len);
+    return;
+  }
+  // Vim represents NULs as NLs
+  char *tmp = xmemdupz(line, len);
+  memchrsub(tmp, NL, NUL, len);
+  lua_pushlstring(lstate, tmp, len);
+  xfree(tmp);
+}
+
+static int buf_lines_index(lua_State *lstate)
+{
+  if (lua_type(lstate, 2) != LUA_TNUMBER) {
+    lua_pushvalue(lstate, 2);
+    lua_rawget(lstate, lua_upvalueindex(1));  // methods
+    return 1;
+  }
+  BufLinesView *view;
+  buf_T *buf = buf_lines_check(lstate, 1, &view);
+  buf_lines_push(lstate, buf, view, lua_tointeger(lstate, 2));
+  return 1;
+}
+
+static int buf_lines_len(lua_State *lstate)
+{
+  BufLinesView *view;
+  buf_lines_check(lstate, 1, &view);
+  lua_pushinteger(lstate, view->count);
+  return 1;
+}
+
+static int buf_lines_tostring(lua_State *lstate)
+{
+  lua_pushstring(lstate, "<buf_lines>");
+  return 1;
+}
+
+static int buf_lines_next(lua_State *lstate)
+{
+  BufLinesView *view;
+  buf_T *buf = buf_lines_check(lstate, 1, &view);
+  lua_Integer idx = luaL_checkinteger(lstate, 2) + 1;
+  if (idx > view->count) {
+    return 0;
+  }
+  lua_pushinteger(lstate, idx);
+  buf_lines_push(lstate, buf, view, idx);
+  return 2;
+}
+
+/// Iterates over the lines like ipairs(), which can't be overridden for userdata.
+static int buf_lines_iter(lua_State *lstate)
+{
+  BufLinesView *view;
+  buf_lines_check(lstate, 1, &view);
+  lua_pushcfunction(lstate, buf_lines_next);
+  lua_pushvalue(lstate, 1);
+  lua_pushinteger(lstate, 0);
+  return 3;
+}
+
+/// Finds the first line from "init" (one-based) which contains the plain
+/// string "pat", reading the lines in place. Returns the index of the line and
+/// the byte range of the match like string.find(), or nil.
+static int buf_lines_find(lua_State *lstate)
+{
+  BufLinesView *view;
+  buf_T *buf = buf_lines_check(lstate, 1, &view);
+  size_t pat_len;
+  const char *pat_arg = luaL_checklstring(lstate, 2, &pat_len);
+  lua_Integer init = MAX(luaL_optinteger(lstate, 3, 1), 1);
+
+  // Vim represents NULs as NLs
+  char *pat = xmemdupz(pat_arg, pat_len);
+  memchrsub(pat, NUL, NL, pat_len);
+
+  for (lua_Integer idx = init; idx <= view->count; idx++) {
+    linenr_T lnum = view->start + (linenr_T)idx - 1;
+    char *line = ml_get_buf(buf, lnum);
+    size_t len = (size_t)ml_get_buf_len(buf, lnum);
+    const char *match = mem_find(line, len, pat, pat_len);
+    if (match) {
+      xfree(pat);
+      lua_pushinteger(lstate, idx);
+      lua_pushinteger(lstate, (lua_Integer)(match - line) + 1);
+      lua_pushinteger(lstate, (lua_Integer)(match - line) + (lua_Integer)pat_len);
+      return 3;
+    }
+  }
+  xfree(pat);
+  lua_pushnil(lstate);
+  return 1;
+}
+
+/// Finds "needle" in the first "len" bytes of "hay".
+static const char *mem_find(const char *hay, size_t len, const char *needle, size_t needle_len)
+{
+  if (needle_len == 0) {
+    return hay;
+  }
+  const char *end = hay + len;
+  const char *p = hay;
+  while ((size_t)(end - p) >= needle_len) {
+    p = memchr(p, (uint8_t)needle[0], (size_t)(end - p) - needle_len + 1);
+    if (p == NULL) {
+      return NULL;
+    } else if (memcmp(p, needle, needle_len) == 0) {
+      return p;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+static struct luaL_Reg buf_lines_methods[] = {
+  { "iter", buf_lines_iter },
+  { "find", buf_lines_find },
+  { NULL, NULL }
+};
+
 static dict_T *nlua_get_var_scope(lua_State *lstate)
 {
   const char *scope = luaL_checkstring(lstate, 1);
@@ -578,6 +763,55 @@ static int nlua_foldupdate(lua_State *lstate)
   return 0;
 }
 
+static buf_T *nlua_check_buf(lua_State *lstate, int index)
+{
+  handle_T bufnr = (handle_T)luaL_checkinteger(lstate, index);
+  buf_T *buf = bufnr ? handle_get_buffer(bufnr) : curbuf;
+  if (!buf) {
+    luaL_error(lstate, "invalid buffer");
+  }
+  return buf;
+}
+
+// Forget the fold levels of a buffer. With "active", lines without a level have level 0 until the
+// levels are computed again, otherwise 'foldexpr' is evaluated.
+static int nlua_fold_levels_reset(lua_State *lstate)
+{
+  buf_T *buf = nlua_check_buf(lstate, 1);
+  fold_levels_reset(buf, lua_toboolean(lstate, 2));
+  return 0;
+}
+
+// Replace the fold levels of old_count lines from the zero-based row with new_count unknown levels.
+static int nlua_fold_levels_splice(lua_State *lstate)
+{
+  buf_T *buf = nlua_check_buf(lstate, 1);
+  fold_levels_splice(buf, (int)luaL_checkinteger(lstate, 2), (int)luaL_checkinteger(lstate, 3),
+                     (int)luaL_checkinteger(lstate, 4));
+  return 0;
+}
+
+// Get the fold level of a line of the current window from the fold levels of its buffer, as a
+// 'foldexpr' result. With "attach", the levels are read directly as long as 'foldexpr' does not
+// change.
+static int nlua_fold_level(lua_State *lstate)
+{
+  linenr_T lnum = (linenr_T)luaL_checkinteger(lstate, 1);
+  if (lua_toboolean(lstate, 2)) {
+    fold_levels_attach(curwin);
+  }
+
+  int n;
+  int c;
+  fold_levels_lookup(curwin, lnum, &n, &c);
+  if (c == NUL) {
+    lua_pushfstring(lstate, "%d", n);
+  } else {
+    lua_pushfstring(lstate, "%c%d", c, n);
+  }
+  return 1;
+}
+
 static int nlua_with(lua_State *L)
 {
   int flags = 0;
@@ -681,8 +915,21 @@ static void nlua_state_add_internal(lua_State *const lstate)
   lua_pushcfunction(lstate, &nlua_foldupdate);
   lua_setfield(lstate, -2, "_foldupdate");
 
+  lua_pushcfunction(lstate, &nlua_fold_levels_reset);
+  lua_setfield(lstate, -2, "_fold_levels_reset");
+
+  lua_pushcfunction(lstate, &nlua_fold_levels_splice);
+  lua_setfield(lstate, -2, "_fold_levels_splice");
+
+  lua_pushcfunction(lstate, &nlua_fold_level);
+  lua_setfield(lstate, -2, "_fold_level");
+
   lua_pushcfunction(lstate, &nlua_with);
   lua_setfield(lstate, -2, "_with_c");
+
+  // _jsonrpc_reader
+  nlua_push_jsonrpc_reader(lstate);
+  lua_setfield(lstate, -2, "_jsonrpc_reader");
 }
 
 void nlua_state_add_stdlib(lua_State *const lstate, bool is_thread)
@@ -719,6 +966,20 @@ void nlua_state_add_stdlib(lua_State *const lstate, bool is_thread)
     lua_setfield(lstate, -2, "__index");  // [meta]
     lua_pop(lstate, 1);  // don't use metatable now
 
+    // buf_lines
+    lua_pushcfunction(lstate, &nlua_buf_lines);
+    lua_setfield(lstate, -2, "buf_lines");
+    luaL_newmetatable(lstate, NLUA_BUF_LINES_META);  // [meta]
+    lua_newtable(lstate);  // [meta, methods]
+    luaL_register(lstate, NULL, buf_lines_methods);
+    lua_pushcclosure(lstate, &buf_lines_index, 1);  // [meta, index]
+    lua_setfield(lstate, -2, "__index");
+    lua_pushcfunction(lstate, &buf_lines_len);
+    lua_setfield(lstate, -2, "__len");
+    lua_pushcfunction(lstate, &buf_lines_tostring);
+    lua_setfield(lstate, -2, "__tostring");
+    lua_pop(lstate, 1);
+
     // vim.spell
     luaopen_spell(lstate);
     lua_setfield(lstate, -2, "spell");
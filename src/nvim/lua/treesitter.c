@@ -4,6 +4,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <inttypes.h>
 #include <lauxlib.h>
 #include <limits.h>
 #include <lua.h>
@@ -23,16 +24,31 @@
 # include "nvim/os/fs.h"
 #endif
 
+#include "klib/kvec.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/ascii_defs.h"
+#include "nvim/buffer.h"
 #include "nvim/buffer_defs.h"
+#include "nvim/charset.h"
+#include "nvim/decoration.h"
+#include "nvim/decoration_defs.h"
+#include "nvim/event/defs.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/multiqueue.h"
+#include "nvim/fold.h"
+#include "nvim/gettext_defs.h"
 #include "nvim/globals.h"
+#include "nvim/lua/executor.h"
 #include "nvim/lua/treesitter.h"
 #include "nvim/macros_defs.h"
+#include "nvim/main.h"
 #include "nvim/map_defs.h"
+#include "nvim/mbyte.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
 #include "nvim/pos_defs.h"
+#include "nvim/regexp.h"
+#include "nvim/regexp_defs.h"
 #include "nvim/strings.h"
 #include "nvim/types_defs.h"
 
@@ -42,6 +58,8 @@
 #define TS_META_QUERY "treesitter_query"
 #define TS_META_QUERYCURSOR "treesitter_querycursor"
 #define TS_META_QUERYMATCH "treesitter_querymatch"
+#define TS_META_HIGHLIGHTER "treesitter_highlighter"
+#define TS_META_FOLDS "treesitter_folds"
 
 typedef struct {
   LuaRef cb;
@@ -60,12 +78,173 @@ typedef struct {
   uint64_t timeout_threshold_ns;
 } TSLuaParserCallbackPayload;
 
+/// A copy of the text of a buffer, shared by the parses on worker threads which
+/// were started while the buffer was unchanged. Worker threads only read it.
+typedef struct {
+  handle_T buf;
+  varnumber_T changedtick;
+  char *text;
+  size_t len;
+  int refcount;  ///< only changed on the main thread
+} TSLuaSnapshot;
+
+/// A parse running on a worker thread, see parser_parse_async().
+///
+/// While the job is running, the worker thread owns "parser". The main thread
+/// must call parser_wait() before it touches the parser again.
+typedef struct {
+  uv_work_t req;
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  bool done;
+
+  TSParser *parser;
+  TSTree *old_tree;  ///< copy of the old tree, owned by the job
+  TSLuaSnapshot *snapshot;
+
+  TSTree *new_tree;
+  TSRange *changed;
+  uint32_t n_changed;
+
+  lua_State *lstate;
+  LuaRef parser_ref;  ///< keeps the parser alive until the callback has run
+  LuaRef cb;
+  bool include_bytes;
+} TSLuaParseJob;
+
+// parsers which are busy on a worker thread: TSParser* => TSLuaParseJob*
+static PMap(ptr_t) parse_jobs = MAP_INIT;
+
+// the latest snapshot still used by a parse, shared with the parses which are
+// started before the buffer changes
+static TSLuaSnapshot *last_snapshot = NULL;
+
+typedef enum {
+  kTSPredEq,
+  kTSPredMatch,
+  kTSPredLuaMatch,
+  kTSPredContains,
+  kTSPredAnyOf,
+  kTSPredHasAncestor,
+  kTSPredHasParent,
+} TSLuaPredicateKind;
+
+typedef enum {
+  kTSPredCompiled,
+  kTSPredFailed,  ///< invalid arguments, Lua reports the error
+  kTSPredOther,  ///< not a builtin predicate
+} TSLuaPredicateCompile;
+
+/// A builtin predicate, compiled when the query is parsed.
+typedef struct {
+  TSLuaPredicateKind kind;
+  bool should_match;  ///< false for "not-" predicates
+  bool any;  ///< true for "any-" predicates
+  int index;  ///< 1-based index of the predicate in the pattern, as in query:inspect()
+  uint32_t capture;
+  uint32_t other;  ///< capture compared by "#eq? @a @b", or UINT32_MAX
+  String *args;  ///< string arguments, which point into the TSQuery
+  size_t n_args;
+  regprog_T *regprog;  ///< for "#match?"
+} TSLuaPredicate;
+
+typedef struct {
+  TSLuaPredicate *items;
+  uint32_t size;
+} TSLuaPredicates;
+
+typedef struct {
+  TSQuery *query;
+  /// Builtin predicates by pattern index. A pattern with a predicate which
+  /// could not be compiled has none, so that Lua evaluates all of them.
+  TSLuaPredicates *predicates;
+  uint32_t n_patterns;
+} TSLuaQuery;
+
+/// The text which predicates are evaluated against.
+typedef struct {
+  handle_T buf;  ///< 0 if the source is "str"
+  const char *str;
+  size_t len;
+} TSLuaSource;
+
+typedef struct {
+  TSQueryCursor *cursor;
+  TSLuaQuery *query;  ///< NULL if all predicates are left to Lua
+  TSLuaSource source;
+  /// Number of captures still to come of the matches which passed the
+  /// predicates, by match id.
+  Map(uint32_t, uint32_t) matched;
+} TSLuaQueryCursor;
+
+/// How the highlighter handles the captures of a query pattern.
+typedef struct {
+  bool lua;  ///< captures are passed to the Lua callback (predicates, custom directives)
+  DecorPriority priority;
+  bool conceal;
+  schar_T conceal_char;
+  char *url;
+} TSLuaHlPattern;
+
+/// A highlight which is added to the decor state line by line.
+typedef struct {
+  int start_row;
+  int start_col;
+  int end_row;
+  int end_col;
+  DecorHighlightInline hl;
+  char *url;
+} TSLuaHlMark;
+
+/// Highlights one tree with a query, see tslua_push_highlighter().
+typedef struct {
+  TSQueryCursor *cursor;
+  TSLuaQuery *query;
+  bool predicates;  ///< evaluate the builtin predicates of "query"
+  Map(uint32_t, uint32_t) matched;
+  TSNode root;
+  int root_end_row;
+  TSLuaSource source;
+  uint32_t ns_id;
+
+  TSRange *regions;
+  uint32_t n_regions;
+
+  int *hl_ids;  ///< capture index => highlight group id
+  int8_t *spell;  ///< capture index => 1 for @spell, -1 for @nospell
+  uint32_t n_captures;
+
+  TSLuaHlPattern *patterns;
+  uint32_t n_patterns;
+
+  /// Highlights which continue on the next line
+  kvec_t(TSLuaHlMark) marks;
+} TSLuaHighlighter;
+
+/// Counts the folds starting and ending at each line, see tslua_push_folds().
+typedef struct {
+  handle_T buf;
+  int srow;
+  int erow;
+  int minlines;
+  int prev_start;
+  int prev_stop;
+  int *enter;  ///< folds starting at each line from "srow - 1" to "erow - 1"
+  int *leave;  ///< folds ending at each line from "srow - 1" to "erow - 1"
+  /// Owned here, so that it is freed when a predicate raises an error
+  TSQueryCursor *cursor;
+} TSLuaFolds;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "lua/treesitter.c.generated.h"
 #endif
 
 static PMap(cstr_t) langs = MAP_INIT;
 
+// scratch space for the text of nodes which is not contiguous in the source
+static StringBuilder pred_text = KV_INITIAL_VALUE;
+static StringBuilder pred_other_text = KV_INITIAL_VALUE;
+
 #ifdef HAVE_WASMTIME
 static wasm_engine_t *wasmengine;
 static TSWasmStore *ts_wasmstore;
@@ -267,6 +446,25 @@ static TSLanguage *lang_check(lua_State *L, int index)
   return lang;
 }
 
+/// Returns a string which identifies the grammar of a language, for caches of
+/// state derived from it: the ABI version and the size of its tables, plus the
+/// grammar version if the parser was generated with one.
+static int tslua_language_fingerprint(lua_State *L)
+{
+  TSLanguage *lang = lang_check(L, 1);
+  char buf[128];
+  int len = snprintf(buf, sizeof(buf), "%" PRIu32 "-%" PRIu32 "-%" PRIu32 "-%" PRIu32,
+                     ts_language_abi_version(lang), ts_language_symbol_count(lang),
+                     ts_language_state_count(lang), ts_language_field_count(lang));
+  const TSLanguageMetadata *meta = ts_language_metadata(lang);
+  if (meta != NULL) {
+    len += snprintf(buf + len, sizeof(buf) - (size_t)len, "-%u.%u.%u", meta->major_version,
+                    meta->minor_version, meta->patch_version);
+  }
+  lua_pushlstring(L, buf, (size_t)len);
+  return 1;
+}
+
 static int tslua_inspect_lang(lua_State *L)
 {
   TSLanguage *lang = lang_check(L, 1);
@@ -369,6 +567,7 @@ static struct luaL_Reg parser_meta[] = {
   { "__gc", parser_gc },
   { "__tostring", parser_tostring },
   { "parse", parser_parse },
+  { "_parse_async", parser_parse_async },
   { "reset", parser_reset },
   { "set_included_ranges", parser_set_ranges },
   { "included_ranges", parser_get_ranges },
@@ -406,9 +605,26 @@ static TSParser *parser_check(lua_State *L, uint16_t index)
 {
   TSParser **ud = luaL_checkudata(L, index, TS_META_PARSER);
   luaL_argcheck(L, *ud, index, "TSParser expected");
+  parser_wait(*ud);
   return *ud;
 }
 
+/// Block until a parse of "p" on a worker thread is done, if there is one.
+/// Normally the caller makes sure this doesn't happen, so it should be rare.
+static void parser_wait(TSParser *p)
+{
+  TSLuaParseJob *job = pmap_get(ptr_t)(&parse_jobs, p);
+  if (!job) {
+    return;
+  }
+  uv_mutex_lock(&job->mutex);
+  while (!job->done) {
+    uv_cond_wait(&job->cond, &job->mutex);
+  }
+  uv_mutex_unlock(&job->mutex);
+  pmap_del(ptr_t)(&parse_jobs, p, NULL);
+}
+
 static void logger_gc(TSLogger logger)
 {
   if (!logger.log) {
@@ -582,6 +798,179 @@ static int parser_parse(lua_State *L)
   return 2;
 }
 
+/// Copy the text of "buf" the way input_cb() presents it: embedded NL as NUL
+/// and every line followed by NL.
+static char *buf_snapshot(buf_T *buf, size_t *len)
+{
+  StringBuilder text = KV_INITIAL_VALUE;
+  for (linenr_T lnum = 1; lnum <= buf->b_ml.ml_line_count; lnum++) {
+    char *line = ml_get_buf(buf, lnum);
+    size_t line_len = (size_t)ml_get_buf_len(buf, lnum);
+    size_t off = kv_size(text);
+    kv_concat_len(text, line, line_len);
+    memchrsub(text.items + off, '\n', NUL, line_len);
+    kv_push(text, '\n');
+  }
+  *len = kv_size(text);
+  return text.items;
+}
+
+/// Get a snapshot of the text of "buf", reusing the one of the running parses
+/// if the buffer didn't change since. Release it with snapshot_unref().
+static TSLuaSnapshot *snapshot_get(buf_T *buf)
+{
+  TSLuaSnapshot *snap = last_snapshot;
+  if (snap && snap->buf == buf->handle && snap->changedtick == buf_get_changedtick(buf)) {
+    snap->refcount++;
+    return snap;
+  }
+
+  snap = xmalloc(sizeof(*snap));
+  snap->buf = buf->handle;
+  snap->changedtick = buf_get_changedtick(buf);
+  snap->text = buf_snapshot(buf, &snap->len);
+  snap->refcount = 1;
+  last_snapshot = snap;
+  return snap;
+}
+
+static void snapshot_unref(TSLuaSnapshot *snap)
+{
+  if (--snap->refcount > 0) {
+    return;
+  }
+  if (last_snapshot == snap) {
+    last_snapshot = NULL;
+  }
+  xfree(snap->text);
+  xfree(snap);
+}
+
+/// Parse a buffer on a worker thread.
+///
+/// Like parse(), but the text of the buffer is copied and parsed on a libuv
+/// worker thread. {callback} is called on the main loop with the new tree and
+/// the changed ranges. The parser must not be used until then; doing so will
+/// block until the parse is done.
+///
+/// Parses with different parsers run in parallel on the libuv threadpool, and
+/// share the copy of the buffer text as long as the buffer doesn't change.
+///
+/// @return true if the parse was started, false if this parser can't be used
+///         from another thread (wasm language or a logger is set)
+static int parser_parse_async(lua_State *L)
+{
+  TSParser *p = parser_check(L, 1);
+  const TSTree *old_tree = NULL;
+  if (!lua_isnil(L, 2)) {
+    TSLuaTree *ud = luaL_checkudata(L, 2, TS_META_TREE);
+    old_tree = ud ? ud->tree : NULL;
+  }
+  handle_T bufnr = (handle_T)luaL_checkinteger(L, 3);
+  buf_T *buf = handle_get_buffer(bufnr);
+  if (!buf) {
+    return luaL_argerror(L, 3, "invalid buffer handle");
+  }
+  bool include_bytes = lua_toboolean(L, 4);
+  luaL_checktype(L, 5, LUA_TFUNCTION);
+
+  const TSLanguage *lang = ts_parser_language(p);
+  if (!lang) {
+    return luaL_error(L, "Language was unset, or has an incompatible ABI.");
+  }
+#ifdef HAVE_WASMTIME
+  // the wasm store is shared between all parsers
+  if (ts_language_is_wasm(lang)) {
+    lua_pushboolean(L, false);
+    return 1;
+  }
+#endif
+  if (ts_parser_logger(p).log) {
+    // the logger calls into lua
+    lua_pushboolean(L, false);
+    return 1;
+  }
+
+  TSLuaParseJob *job = xcalloc(1, sizeof(*job));
+  uv_mutex_init(&job->mutex);
+  uv_cond_init(&job->cond);
+  job->parser = p;
+  job->old_tree = old_tree ? ts_tree_copy(old_tree) : NULL;
+  job->snapshot = snapshot_get(buf);
+  job->lstate = L;
+  job->include_bytes = include_bytes;
+  lua_pushvalue(L, 5);
+  job->cb = luaL_ref(L, LUA_REGISTRYINDEX);
+  lua_pushvalue(L, 1);
+  job->parser_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+  job->req.data = job;
+
+  pmap_put(ptr_t)(&parse_jobs, p, job);
+  uv_queue_work(&main_loop.uv, &job->req, parse_job_work, parse_job_after);
+
+  lua_pushboolean(L, true);
+  return 1;
+}
+
+static void parse_job_work(uv_work_t *req)
+{
+  TSLuaParseJob *job = req->data;
+  job->new_tree = ts_parser_parse_string(job->parser, job->old_tree, job->snapshot->text,
+                                         (uint32_t)job->snapshot->len);
+  if (job->new_tree) {
+    job->changed = job->old_tree
+                   ? ts_tree_get_changed_ranges(job->old_tree, job->new_tree, &job->n_changed)
+                   : ts_tree_included_ranges(job->new_tree, &job->n_changed);
+  }
+
+  uv_mutex_lock(&job->mutex);
+  job->done = true;
+  uv_cond_signal(&job->cond);
+  uv_mutex_unlock(&job->mutex);
+}
+
+static void parse_job_after(uv_work_t *req, int status)
+{
+  TSLuaParseJob *job = req->data;
+  if (pmap_get(ptr_t)(&parse_jobs, job->parser) == job) {
+    pmap_del(ptr_t)(&parse_jobs, job->parser, NULL);
+  }
+  // Lua code should not run inside a libuv callback, so defer the callback
+  // to the main event queue like vim.schedule().
+  multiqueue_put(main_loop.events, parse_job_event, job);
+}
+
+static void parse_job_event(void **argv)
+{
+  TSLuaParseJob *job = argv[0];
+  lua_State *L = job->lstate;
+
+  lua_rawgeti(L, LUA_REGISTRYINDEX, job->cb);  // [cb]
+  luaL_unref(L, LUA_REGISTRYINDEX, job->cb);
+  luaL_unref(L, LUA_REGISTRYINDEX, job->parser_ref);
+
+  // ownership of the new tree is transferred to lua
+  push_tree(L, job->new_tree);  // [cb, tree]
+  if (job->new_tree) {
+    push_ranges(L, job->changed, job->n_changed, job->include_bytes);  // [cb, tree, ranges]
+  } else {
+    lua_pushnil(L);  // [cb, nil, nil]
+  }
+
+  if (job->old_tree) {
+    ts_tree_delete(job->old_tree);
+  }
+  xfree(job->changed);
+  snapshot_unref(job->snapshot);
+  uv_cond_destroy(&job->cond);
+  uv_mutex_destroy(&job->mutex);
+  xfree(job);
+
+  if (nlua_pcall(L, 2, 0)) {
+    nlua_error(L, _("treesitter parse callback: %.*s"));
+  }
+}
+
 static int parser_reset(lua_State *L)
 {
   TSParser *p = parser_check(L, 1);
@@ -912,6 +1301,7 @@ static struct luaL_Reg node_meta[] = {
   { "tree", node_tree },
   { "byte_length", node_byte_length },
   { "equal", node_equal },
+  { "text", node_get_text },
 
   { NULL, NULL }
 };
@@ -1347,6 +1737,74 @@ static int node_equal(lua_State *L)
   return 1;
 }
 
+/// Gets the text of the node from a buffer (0 for the current buffer) or a
+/// string. The text is pushed straight from the buffer line or the string when
+/// the node does not span several lines.
+static int node_get_text(lua_State *L)
+{
+  TSNode node = node_check(L, 1);
+  TSLuaSource source = { 0 };
+  if (lua_type(L, 2) == LUA_TNUMBER && lua_tointeger(L, 2) == 0) {
+    source.buf = curbuf->handle;
+  } else if (!source_from_lua(L, 2, &source)) {
+    return luaL_argerror(L, 2, "expected buffer or string");
+  }
+
+  buf_T *buf = NULL;
+  if (source.buf != 0) {
+    buf = handle_get_buffer(source.buf);
+    if (!buf) {
+      return luaL_error(L, "Invalid buffer id: %d", source.buf);
+    }
+  }
+
+  bool oob = false;
+  String text = node_text(node, buf, &source, &pred_text, false, false, &oob);
+  if (oob) {
+    return luaL_error(L, "Index out of bounds");
+  }
+  lua_pushlstring(L, text.data, text.size);
+  return 1;
+}
+
+/// Gets the ranges of a list of nodes as one flat list of integers, four per
+/// node (six with "include_bytes") in the order of TSNode:range().
+static int tslua_get_node_ranges(lua_State *L)
+{
+  luaL_checktype(L, 1, LUA_TTABLE);
+  bool include_bytes = lua_toboolean(L, 2);
+  int count = (int)lua_objlen(L, 1);
+  int width = include_bytes ? 6 : 4;
+
+  lua_createtable(L, count * width, 0);  // [ranges]
+  int k = 1;
+  for (int i = 1; i <= count; i++) {
+    lua_rawgeti(L, 1, i);  // [ranges, node]
+    TSNode node = node_check(L, -1);
+    lua_pop(L, 1);  // [ranges]
+
+    TSPoint start = ts_node_start_point(node);
+    TSPoint end = ts_node_end_point(node);
+    lua_Integer values[6];
+    int n = 0;
+    values[n++] = start.row;
+    values[n++] = start.column;
+    if (include_bytes) {
+      values[n++] = ts_node_start_byte(node);
+    }
+    values[n++] = end.row;
+    values[n++] = end.column;
+    if (include_bytes) {
+      values[n++] = ts_node_end_byte(node);
+    }
+    for (int j = 0; j < n; j++) {
+      lua_pushinteger(L, values[j]);
+      lua_rawseti(L, -2, k++);
+    }
+  }
+  return 1;
+}
+
 // TSQueryCursor
 
 static struct luaL_Reg querycursor_meta[] = {
@@ -1361,9 +1819,9 @@ static int tslua_push_querycursor(lua_State *L)
 {
   TSNode node = node_check(L, 1);
 
-  TSQuery *query = query_check(L, 2);
+  TSLuaQuery *lquery = query_check(L, 2);
   TSQueryCursor *cursor = ts_query_cursor_new();
-  ts_query_cursor_exec(cursor, query, node);
+  ts_query_cursor_exec(cursor, lquery->query, node);
 
   if (lua_gettop(L) >= 3) {
     uint32_t start = (uint32_t)luaL_checkinteger(L, 3);
@@ -1371,6 +1829,7 @@ static int tslua_push_querycursor(lua_State *L)
     ts_query_cursor_set_point_range(cursor, (TSPoint){ start, 0 }, (TSPoint){ end, 0 });
   }
 
+  bool has_source = false;
   if (lua_gettop(L) >= 5 && !lua_isnil(L, 5)) {
     luaL_argcheck(L, lua_istable(L, 5), 5, "table expected");
     lua_pushnil(L);  // [dict, ..., nil]
@@ -1384,6 +1843,8 @@ static int tslua_push_querycursor(lua_State *L)
         } else if (strequal("match_limit", k)) {
           uint32_t match_limit = (uint32_t)lua_tointeger(L, -1);
           ts_query_cursor_set_match_limit(cursor, match_limit);
+        } else if (strequal("source", k)) {
+          has_source = true;
         }
       }
       // pop the value; lua_next will pop the key.
@@ -1391,32 +1852,98 @@ static int tslua_push_querycursor(lua_State *L)
     }
   }
 
-  TSQueryCursor **ud = lua_newuserdata(L, sizeof(*ud));  // [node, query, ..., udata]
-  *ud = cursor;
+  TSLuaQueryCursor *ud = lua_newuserdata(L, sizeof(*ud));  // [node, query, ..., udata]
+  *ud = (TSLuaQueryCursor){ .cursor = cursor, .matched = MAP_INIT };
   lua_getfield(L, LUA_REGISTRYINDEX, TS_META_QUERYCURSOR);  // [node, query, ..., udata, meta]
   lua_setmetatable(L, -2);  // [node, query, ..., udata]
 
-  // Copy the fenv which contains the nodes tree.
-  lua_getfenv(L, 1);  // [udata, reftable]
-  lua_setfenv(L, -2);  // [udata]
+  // The fenv holds the tree of the node, like the fenv of nodes, and keeps the
+  // query and the source alive.
+  lua_createtable(L, 3, 0);  // [node, query, ..., udata, reftable]
+  lua_getfenv(L, 1);  // [node, query, ..., udata, reftable, node_reftable]
+  lua_rawgeti(L, -1, 1);  // [node, query, ..., udata, reftable, node_reftable, tree]
+  lua_rawseti(L, -3, 1);  // [node, query, ..., udata, reftable, node_reftable]
+  lua_pop(L, 1);  // [node, query, ..., udata, reftable]
+  lua_pushvalue(L, 2);  // [node, query, ..., udata, reftable, query]
+  lua_rawseti(L, -2, 2);  // [node, query, ..., udata, reftable]
+
+  if (has_source) {
+    lua_getfield(L, 5, "source");  // [node, query, ..., udata, reftable, source]
+    if (source_from_lua(L, -1, &ud->source)) {
+      ud->query = lquery;
+    }
+    lua_rawseti(L, -2, 3);  // [node, query, ..., udata, reftable]
+  }
+  lua_setfenv(L, -2);  // [node, query, ..., udata]
 
   return 1;
 }
 
+/// Reads the source of a query cursor, a buffer handle or a string.
+///
+/// The string must be kept alive as long as "source" is used.
+static bool source_from_lua(lua_State *L, int index, TSLuaSource *source)
+{
+  if (lua_type(L, index) == LUA_TNUMBER) {
+    source->buf = (handle_T)lua_tointeger(L, index);
+    return source->buf > 0;
+  } else if (lua_type(L, index) == LUA_TSTRING) {
+    source->buf = 0;
+    source->str = lua_tolstring(L, index, &source->len);
+    return true;
+  }
+  return false;
+}
+
 static int querycursor_remove_match(lua_State *L)
 {
-  TSQueryCursor *cursor = querycursor_check(L, 1);
+  TSLuaQueryCursor *ud = querycursor_check(L, 1);
   uint32_t match_id = (uint32_t)luaL_checkinteger(L, 2);
-  ts_query_cursor_remove_match(cursor, match_id);
+  ts_query_cursor_remove_match(ud->cursor, match_id);
+  map_del(uint32_t, uint32_t)(&ud->matched, match_id, NULL);
   return 0;
 }
 
+/// Like ts_query_cursor_next_capture(), but skips the matches which do not
+/// pass the builtin predicates of their pattern.
+///
+/// @param lquery  the query of "cursor", or NULL to leave all predicates to Lua
+/// @param matched number of captures still to come of the matches which
+///                passed the predicates before, by match id
+static bool cursor_next_capture(lua_State *L, TSQueryCursor *cursor, TSLuaQuery *lquery,
+                                const TSLuaSource *source, Map(uint32_t, uint32_t) *matched,
+                                TSQueryMatch *match, uint32_t *capture_index)
+{
+  while (ts_query_cursor_next_capture(cursor, match, capture_index)) {
+    if (!lquery || lquery->predicates[match->pattern_index].size == 0) {
+      return true;
+    }
+    uint32_t *left = map_ref(uint32_t, uint32_t)(matched, match->id, NULL);
+    if (left != NULL) {
+      // Every capture of a match is returned once, forget the match after the last one.
+      if (--*left == 0) {
+        map_del(uint32_t, uint32_t)(matched, match->id, NULL);
+      }
+      return true;
+    }
+    if (predicates_match(L, lquery, match, source)) {
+      if (match->capture_count > 1) {
+        map_put(uint32_t, uint32_t)(matched, match->id, match->capture_count - 1u);
+      }
+      return true;
+    }
+    ts_query_cursor_remove_match(cursor, match->id);
+  }
+  return false;
+}
+
 static int querycursor_next_capture(lua_State *L)
 {
-  TSQueryCursor *cursor = querycursor_check(L, 1);
+  TSLuaQueryCursor *ud = querycursor_check(L, 1);
   TSQueryMatch match;
   uint32_t capture_index;
-  if (!ts_query_cursor_next_capture(cursor, &match, &capture_index)) {
+  if (!cursor_next_capture(L, ud->cursor, ud->query, &ud->source, &ud->matched, &match,
+                           &capture_index)) {
     return 0;
   }
 
@@ -1432,29 +1959,32 @@ static int querycursor_next_capture(lua_State *L)
 
 static int querycursor_next_match(lua_State *L)
 {
-  TSQueryCursor *cursor = querycursor_check(L, 1);
+  TSLuaQueryCursor *ud = querycursor_check(L, 1);
 
   TSQueryMatch match;
-  if (!ts_query_cursor_next_match(cursor, &match)) {
-    return 0;
-  }
+  do {
+    if (!ts_query_cursor_next_match(ud->cursor, &match)) {
+      return 0;
+    }
+  } while (ud->query && !predicates_match(L, ud->query, &match, &ud->source));
 
   push_querymatch(L, &match, 1);
 
   return 1;
 }
 
-static TSQueryCursor *querycursor_check(lua_State *L, int index)
+static TSLuaQueryCursor *querycursor_check(lua_State *L, int index)
 {
-  TSQueryCursor **ud = luaL_checkudata(L, index, TS_META_QUERYCURSOR);
-  luaL_argcheck(L, *ud, index, "TSQueryCursor expected");
-  return *ud;
+  TSLuaQueryCursor *ud = luaL_checkudata(L, index, TS_META_QUERYCURSOR);
+  luaL_argcheck(L, ud->cursor, index, "TSQueryCursor expected");
+  return ud;
 }
 
 static int querycursor_gc(lua_State *L)
 {
-  TSQueryCursor *cursor = querycursor_check(L, 1);
-  ts_query_cursor_delete(cursor);
+  TSLuaQueryCursor *ud = querycursor_check(L, 1);
+  ts_query_cursor_delete(ud->cursor);
+  map_destroy(uint32_t, &ud->matched);
   return 0;
 }
 
@@ -1506,6 +2036,602 @@ static int querymatch_captures(lua_State *L)
   return 1;
 }
 
+// TSHighlighter
+
+static struct luaL_Reg highlighter_meta[] = {
+  { "exec", highlighter_exec },
+  { "on_line", highlighter_on_line },
+  { "add_mark", highlighter_add_mark },
+  { "__gc", highlighter_gc },
+  { NULL, NULL }
+};
+
+/// Creates a highlighter which adds the highlights of a query for the tree of
+/// "node" to the decor state, without calling into Lua for every capture.
+///
+/// Lua arguments: root node, query, buffer, namespace and a table with
+///   - hl: capture index => highlight group id
+///   - spell: capture index => true for @spell, false for @nospell
+///   - priority: default priority
+///   - patterns: pattern index => false if the captures of the pattern must be
+///     handled in Lua, or a table with the "priority", "conceal" and "url" set
+///     by the pattern. Patterns which are missing use the defaults.
+///   - predicates: whether the builtin predicates are evaluated in C
+static int tslua_push_highlighter(lua_State *L)
+{
+  TSNode root = node_check(L, 1);
+  TSLuaQuery *query = query_check(L, 2);
+  handle_T buf = (handle_T)luaL_checkinteger(L, 3);
+  uint32_t ns_id = (uint32_t)luaL_checkinteger(L, 4);
+  luaL_checktype(L, 5, LUA_TTABLE);
+
+  TSLuaHighlighter *hl = lua_newuserdata(L, sizeof(*hl));  // [..., udata]
+  *hl = (TSLuaHighlighter){
+    .query = query,
+    .matched = MAP_INIT,
+    .root = root,
+    .root_end_row = (int)ts_node_end_point(root).row,
+    .source = { .buf = buf },
+    .ns_id = ns_id,
+    .marks = KV_INITIAL_VALUE,
+  };
+  lua_getfield(L, LUA_REGISTRYINDEX, TS_META_HIGHLIGHTER);  // [..., udata, meta]
+  lua_setmetatable(L, -2);  // [..., udata]
+
+  hl->cursor = ts_query_cursor_new();
+  hl->regions = ts_tree_included_ranges(root.tree, &hl->n_regions);
+
+  lua_getfield(L, 5, "predicates");  // [..., udata, predicates]
+  hl->predicates = lua_toboolean(L, -1);
+  lua_pop(L, 1);  // [..., udata]
+
+  uint32_t n_captures = ts_query_capture_count(query->query);
+  hl->hl_ids = xcalloc(n_captures, sizeof(*hl->hl_ids));
+  hl->spell = xcalloc(n_captures, sizeof(*hl->spell));
+  hl->n_captures = n_captures;
+
+  lua_getfield(L, 5, "hl");  // [..., udata, hl]
+  lua_getfield(L, 5, "spell");  // [..., udata, hl, spell]
+  for (uint32_t i = 0; i < n_captures; i++) {
+    if (lua_istable(L, -2)) {
+      lua_rawgeti(L, -2, (int)i + 1);  // [..., udata, hl, spell, hl_id]
+      hl->hl_ids[i] = (int)lua_tointeger(L, -1);
+      lua_pop(L, 1);  // [..., udata, hl, spell]
+    }
+    if (lua_istable(L, -1)) {
+      lua_rawgeti(L, -1, (int)i + 1);  // [..., udata, hl, spell, spell_i]
+      if (!lua_isnil(L, -1)) {
+        hl->spell[i] = lua_toboolean(L, -1) ? 1 : -1;
+      }
+      lua_pop(L, 1);  // [..., udata, hl, spell]
+    }
+  }
+  lua_pop(L, 2);  // [..., udata]
+
+  lua_getfield(L, 5, "priority");  // [..., udata, priority]
+  DecorPriority priority = lua_isnumber(L, -1) ? (DecorPriority)lua_tointeger(L, -1)
+                                               : DECOR_PRIORITY_BASE;
+  lua_pop(L, 1);  // [..., udata]
+
+  uint32_t n_patterns = ts_query_pattern_count(query->query);
+  hl->patterns = xcalloc(n_patterns, sizeof(*hl->patterns));
+  hl->n_patterns = n_patterns;
+
+  lua_getfield(L, 5, "patterns");  // [..., udata, patterns]
+  for (uint32_t i = 0; i < n_patterns; i++) {
+    TSLuaHlPattern *pat = &hl->patterns[i];
+    pat->priority = priority;
+    if (!lua_istable(L, -1)) {
+      continue;
+    }
+    lua_rawgeti(L, -1, (int)i + 1);  // [..., udata, patterns, pattern]
+    if (lua_istable(L, -1)) {
+      highlighter_pattern_from_lua(L, pat);
+    } else if (!lua_isnil(L, -1)) {
+      pat->lua = true;
+    }
+    lua_pop(L, 1);  // [..., udata, patterns]
+  }
+  lua_pop(L, 1);  // [..., udata]
+
+  // Keep the tree and the query alive. The tree must be the first item, like
+  // in the fenv of a node, as nodes pushed by the highlighter copy its fenv.
+  lua_createtable(L, 2, 0);  // [..., udata, reftable]
+  lua_getfenv(L, 1);  // [..., udata, reftable, node_reftable]
+  lua_rawgeti(L, -1, 1);  // [..., udata, reftable, node_reftable, tree]
+  lua_rawseti(L, -3, 1);  // [..., udata, reftable, node_reftable]
+  lua_pop(L, 1);  // [..., udata, reftable]
+  lua_pushvalue(L, 2);  // [..., udata, reftable, query]
+  lua_rawseti(L, -2, 2);  // [..., udata, reftable]
+  lua_setfenv(L, -2);  // [..., udata]
+
+  return 1;
+}
+
+/// Reads the static metadata of a pattern from the table at the top of the stack.
+///
+/// Values the API would reject are left to Lua, so that they fail the same way.
+static void highlighter_pattern_from_lua(lua_State *L, TSLuaHlPattern *pat)
+{
+  lua_getfield(L, -1, "priority");  // [pattern, priority]
+  if (lua_isnumber(L, -1)) {
+    lua_Integer priority = lua_tointeger(L, -1);
+    if (priority >= 0 && priority <= UINT16_MAX) {
+      pat->priority = (DecorPriority)priority;
+    } else {
+      pat->lua = true;
+    }
+  }
+  lua_pop(L, 1);  // [pattern]
+
+  lua_getfield(L, -1, "conceal");  // [pattern, conceal]
+  if (lua_type(L, -1) == LUA_TSTRING) {
+    const char *conceal = lua_tostring(L, -1);
+    pat->conceal = true;
+    if (*conceal != NUL) {
+      int ch;
+      pat->conceal_char = utfc_ptr2schar(conceal, &ch);
+      if (!pat->conceal_char || !vim_isprintc(ch)) {
+        pat->lua = true;
+      }
+    }
+  }
+  lua_pop(L, 1);  // [pattern]
+
+  lua_getfield(L, -1, "url");  // [pattern, url]
+  if (lua_type(L, -1) == LUA_TSTRING) {
+    pat->url = xstrdup(lua_tostring(L, -1));
+  }
+  lua_pop(L, 1);  // [pattern]
+}
+
+static TSLuaHighlighter *highlighter_check(lua_State *L, int index)
+{
+  TSLuaHighlighter *hl = luaL_checkudata(L, index, TS_META_HIGHLIGHTER);
+  luaL_argcheck(L, hl->cursor, index, "TSHighlighter expected");
+  return hl;
+}
+
+/// Ephemeral highlights can only be added while the decoration providers draw
+/// the buffer of the highlighter.
+static void highlighter_check_decor(lua_State *L, TSLuaHighlighter *hl)
+{
+  buf_T *buf = handle_get_buffer(hl->source.buf);
+  if (!buf || !decor_state.win || decor_state.win->w_buffer != buf) {
+    luaL_error(L, "cannot set emphemeral mark outside of a decoration provider");
+  }
+}
+
+static int highlighter_gc(lua_State *L)
+{
+  TSLuaHighlighter *hl = luaL_checkudata(L, 1, TS_META_HIGHLIGHTER);
+  if (hl->cursor) {
+    ts_query_cursor_delete(hl->cursor);
+  }
+  xfree(hl->regions);
+  xfree(hl->hl_ids);
+  xfree(hl->spell);
+  for (uint32_t i = 0; i < hl->n_patterns; i++) {
+    xfree(hl->patterns[i].url);
+  }
+  xfree(hl->patterns);
+  for (size_t i = 0; i < kv_size(hl->marks); i++) {
+    xfree(kv_A(hl->marks, i).url);
+  }
+  kv_destroy(hl->marks);
+  map_destroy(uint32_t, &hl->matched);
+  return 0;
+}
+
+/// Starts matching the query from row "start" to the end of the tree.
+static int highlighter_exec(lua_State *L)
+{
+  TSLuaHighlighter *hl = highlighter_check(L, 1);
+  uint32_t start = (uint32_t)luaL_checkinteger(L, 2);
+
+  ts_query_cursor_exec(hl->cursor, hl->query->query, hl->root);
+  map_clear(uint32_t, &hl->matched);
+  ts_query_cursor_set_point_range(hl->cursor, (TSPoint){ start, 0 },
+                                  (TSPoint){ (uint32_t)hl->root_end_row + 1, 0 });
+  ts_query_cursor_set_match_limit(hl->cursor, 256);
+  return 0;
+}
+
+/// Adds the part of "m" on "line" to the decor state.
+///
+/// @return true if "m" continues below "line", in which case it must be added
+///         again for the next line.
+static bool highlighter_put_mark(TSLuaHighlighter *hl, const TSLuaHlMark *m, int line)
+{
+  int start_row = m->start_row;
+  int start_col = m->start_col;
+  if (start_row < line) {
+    start_row = line;
+    start_col = 0;
+  }
+
+  int end_row = m->end_row;
+  int end_col = m->end_col;
+  bool next = false;
+  if (end_row >= line + 1) {
+    end_row = line + 1;
+    end_col = 0;
+    next = true;
+  }
+
+  bool empty = end_row < start_row || (end_row == start_row && end_col <= start_col);
+  if (start_row <= line && !empty) {
+    DecorSignHighlight sh = decor_sh_from_inline(m->hl);
+    sh.url = m->url ? xstrdup(m->url) : NULL;
+    decor_range_add_sh(&decor_state, start_row, start_col, end_row, end_col, &sh, true,
+                       hl->ns_id, 0);
+  }
+  return next;
+}
+
+static void highlighter_push_mark(TSLuaHighlighter *hl, TSLuaHlMark m, int line)
+{
+  if (highlighter_put_mark(hl, &m, line)) {
+    kv_push(hl->marks, m);
+  } else {
+    xfree(m.url);
+  }
+}
+
+static inline bool point_le(TSPoint a, TSPoint b)
+{
+  return a.row < b.row || (a.row == b.row && a.column <= b.column);
+}
+
+/// Adds the highlight of a capture, clipped to each included range of the tree.
+static void highlighter_add_capture(TSLuaHighlighter *hl, TSQueryCapture capture,
+                                    const TSLuaHlPattern *pat, int line, bool on_spell)
+{
+  int8_t spell = hl->spell[capture.index];
+  if (on_spell && spell == 0) {
+    return;
+  }
+
+  DecorHighlightInline decor = DECOR_HIGHLIGHT_INLINE_INIT;
+  decor.hl_id = hl->hl_ids[capture.index];
+  // nospell has a higher priority so that it always overrides spell captures
+  decor.priority = (DecorPriority)(pat->priority + (spell < 0 ? 1 : 0));
+  if (spell != 0) {
+    decor.flags |= spell > 0 ? kSHSpellOn : kSHSpellOff;
+  }
+  if (pat->conceal) {
+    decor.flags |= kSHConceal;
+    decor.conceal_char = pat->conceal_char;
+  }
+
+  TSPoint start = ts_node_start_point(capture.node);
+  TSPoint end = ts_node_end_point(capture.node);
+  for (uint32_t i = 0; i < hl->n_regions; i++) {
+    TSRange r = hl->regions[i];
+    if (point_le(r.end_point, start) || point_le(end, r.start_point)) {
+      continue;
+    }
+    TSPoint s = point_le(r.start_point, start) ? start : r.start_point;
+    TSPoint e = point_le(end, r.end_point) ? end : r.end_point;
+    if ((int)e.row < line) {
+      continue;
+    }
+
+    highlighter_push_mark(hl, (TSLuaHlMark){
+      .start_row = (int)s.row,
+      .start_col = (int)s.column,
+      .end_row = (int)e.row,
+      .end_col = (int)e.column,
+      .hl = decor,
+      .url = pat->url ? xstrdup(pat->url) : NULL,
+    }, line);
+  }
+}
+
+/// Adds the highlights for a line.
+///
+/// Lua arguments: line, next row (see return value), on_spell, on_conceal and
+/// a callback which is called for the captures of patterns handled in Lua, with
+/// the capture index, node, match, line, on_spell and on_conceal. It returns
+/// the start row of the capture, or nil if the match was rejected.
+///
+/// Returns the first row after "line" which has captures which were not
+/// consumed yet.
+static int highlighter_on_line(lua_State *L)
+{
+  TSLuaHighlighter *hl = highlighter_check(L, 1);
+  int line = (int)luaL_checkinteger(L, 2);
+  int next_row = (int)luaL_checkinteger(L, 3);
+  bool on_spell = lua_toboolean(L, 4);
+  bool on_conceal = lua_toboolean(L, 5);
+  luaL_checktype(L, 6, LUA_TFUNCTION);
+  highlighter_check_decor(L, hl);
+
+  // Highlights from the previous line come first. The new highlights are
+  // appended after those which are kept.
+  size_t n_kept = 0;
+  for (size_t i = 0; i < kv_size(hl->marks); i++) {
+    TSLuaHlMark m = kv_A(hl->marks, i);
+    if (highlighter_put_mark(hl, &m, line)) {
+      kv_A(hl->marks, n_kept++) = m;
+    } else {
+      xfree(m.url);
+    }
+  }
+  kv_size(hl->marks) = n_kept;
+
+  while (line >= next_row) {
+    TSQueryMatch match;
+    uint32_t capture_index;
+    if (!cursor_next_capture(L, hl->cursor, hl->predicates ? hl->query : NULL, &hl->source,
+                             &hl->matched, &match, &capture_index)) {
+      next_row = hl->root_end_row + 1;
+      break;
+    }
+
+    TSQueryCapture capture = match.captures[capture_index];
+    int start_row = (int)ts_node_start_point(capture.node).row;
+
+    if (hl->patterns[match.pattern_index].lua) {
+      lua_pushvalue(L, 6);  // [..., cb]
+      lua_pushinteger(L, capture.index + 1);  // [..., cb, capture]
+      push_node(L, capture.node, 1);  // [..., cb, capture, node]
+      push_querymatch(L, &match, 1);  // [..., cb, capture, node, match]
+      lua_pushinteger(L, line);
+      lua_pushboolean(L, on_spell);
+      lua_pushboolean(L, on_conceal);  // [..., cb, capture, node, match, line, spell, conceal]
+      lua_call(L, 6, 1);  // [..., start_row]
+      bool rejected = lua_isnil(L, -1);
+      if (!rejected) {
+        start_row = (int)lua_tointeger(L, -1);
+      }
+      lua_pop(L, 1);  // [...]
+
+      if (rejected) {
+        ts_query_cursor_remove_match(hl->cursor, match.id);
+        if (start_row <= line) {
+          continue;
+        }
+      }
+    } else if (!on_conceal) {
+      highlighter_add_capture(hl, capture, &hl->patterns[match.pattern_index], line, on_spell);
+    }
+
+    if (start_row > line) {
+      next_row = start_row;
+    }
+  }
+
+  lua_pushinteger(L, next_row);
+  return 1;
+}
+
+/// Adds a highlight from a capture handled in Lua, so that it is ordered with
+/// the other highlights.
+///
+/// Lua arguments: line, start row, start col, end row, end col and a table
+/// with "hl_group", "priority", "conceal", "spell" and "url".
+static int highlighter_add_mark(lua_State *L)
+{
+  TSLuaHighlighter *hl = highlighter_check(L, 1);
+  int line = (int)luaL_checkinteger(L, 2);
+  TSLuaHlMark m = {
+    .start_row = (int)luaL_checkinteger(L, 3),
+    .start_col = (int)luaL_checkinteger(L, 4),
+    .end_row = (int)luaL_checkinteger(L, 5),
+    .end_col = (int)luaL_checkinteger(L, 6),
+    .hl = DECOR_HIGHLIGHT_INLINE_INIT,
+  };
+  luaL_checktype(L, 7, LUA_TTABLE);
+  highlighter_check_decor(L, hl);
+
+  lua_getfield(L, 7, "hl_group");  // [..., hl_group]
+  m.hl.hl_id = (int)lua_tointeger(L, -1);
+  lua_pop(L, 1);
+
+  lua_getfield(L, 7, "priority");  // [..., priority]
+  lua_Integer priority = luaL_optinteger(L, -1, DECOR_PRIORITY_BASE);
+  if (priority < 0 || priority > UINT16_MAX) {
+    return luaL_error(L, "Invalid 'priority': out of range");
+  }
+  m.hl.priority = (DecorPriority)priority;
+  lua_pop(L, 1);
+
+  lua_getfield(L, 7, "conceal");  // [..., conceal]
+  if (!lua_isnil(L, -1)) {
+    const char *conceal = luaL_checkstring(L, -1);
+    m.hl.flags |= kSHConceal;
+    if (*conceal != NUL) {
+      int ch;
+      m.hl.conceal_char = utfc_ptr2schar(conceal, &ch);
+      if (!m.hl.conceal_char || !vim_isprintc(ch)) {
+        return luaL_error(L, "conceal char has to be printable");
+      }
+    }
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 7, "spell");  // [..., spell]
+  if (!lua_isnil(L, -1)) {
+    m.hl.flags |= lua_toboolean(L, -1) ? kSHSpellOn : kSHSpellOff;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 7, "url");  // [..., url]
+  if (!lua_isnil(L, -1)) {
+    m.url = xstrdup(luaL_checkstring(L, -1));
+  }
+  lua_pop(L, 1);
+
+  highlighter_push_mark(hl, m, line);
+  return 0;
+}
+
+// TSFolds
+
+static struct luaL_Reg folds_meta[] = {
+  { "add", folds_add },
+  { "add_matches", folds_add_matches },
+  { "apply", folds_apply },
+  { "__gc", folds_gc },
+  { NULL, NULL }
+};
+
+/// Creates a counter of the folds of the lines "srow" to "erow" (0-based,
+/// exclusive) of a buffer, which sets the fold levels of the buffer from them.
+///
+/// Lua arguments: buffer, srow, erow and 'foldminlines'
+static int tslua_push_folds(lua_State *L)
+{
+  handle_T buf = (handle_T)luaL_checkinteger(L, 1);
+  int srow = (int)luaL_checkinteger(L, 2);
+  int erow = (int)luaL_checkinteger(L, 3);
+  int minlines = (int)luaL_checkinteger(L, 4);
+  luaL_argcheck(L, srow >= 0 && erow >= srow, 3, "invalid range");
+
+  TSLuaFolds *folds = lua_newuserdata(L, sizeof(*folds));  // [..., udata]
+  *folds = (TSLuaFolds){
+    .buf = buf,
+    .srow = srow,
+    .erow = erow,
+    .minlines = minlines,
+    .prev_start = -1,
+    .prev_stop = -1,
+    .enter = xcalloc((size_t)(erow - srow + 1), sizeof(int)),
+    .leave = xcalloc((size_t)(erow - srow + 1), sizeof(int)),
+  };
+  lua_getfield(L, LUA_REGISTRYINDEX, TS_META_FOLDS);  // [..., udata, meta]
+  lua_setmetatable(L, -2);  // [..., udata]
+  return 1;
+}
+
+static TSLuaFolds *folds_check(lua_State *L, int index)
+{
+  TSLuaFolds *folds = luaL_checkudata(L, index, TS_META_FOLDS);
+  luaL_argcheck(L, folds->enter, index, "TSFolds expected");
+  return folds;
+}
+
+static int folds_gc(lua_State *L)
+{
+  TSLuaFolds *folds = luaL_checkudata(L, 1, TS_META_FOLDS);
+  XFREE_CLEAR(folds->enter);
+  XFREE_CLEAR(folds->leave);
+  if (folds->cursor) {
+    ts_query_cursor_delete(folds->cursor);
+    folds->cursor = NULL;
+  }
+  return 0;
+}
+
+/// Counts a fold from row "start" to the position "stop_row", "stop_col"
+/// (exclusive), unless it is too small or the same as the previous fold.
+static void folds_count(TSLuaFolds *folds, int start, int stop_row, int stop_col)
+{
+  int stop = stop_col == 0 ? stop_row - 1 : stop_row;
+  // Checking against the previous fold is enough to skip nodes with the same
+  // range, as the matches are returned in preorder or postorder.
+  if (stop - start + 1 <= folds->minlines
+      || (start == folds->prev_start && stop == folds->prev_stop)) {
+    return;
+  }
+  // Counts are kept for the lines "srow - 1" to "erow - 1", 1-based "srow" to "erow".
+  int n = folds->erow - folds->srow + 1;
+  int enter = start + 1 - folds->srow;
+  int leave = stop + 1 - folds->srow;
+  if (enter >= 0 && enter < n) {
+    folds->enter[enter]++;
+  }
+  if (leave >= 0 && leave < n) {
+    folds->leave[leave]++;
+  }
+  folds->prev_start = start;
+  folds->prev_stop = stop;
+}
+
+/// Lua arguments: start row, end row and end column of a fold
+static int folds_add(lua_State *L)
+{
+  TSLuaFolds *folds = folds_check(L, 1);
+  folds_count(folds, (int)luaL_checkinteger(L, 2), (int)luaL_checkinteger(L, 3),
+              (int)luaL_checkinteger(L, 4));
+  return 0;
+}
+
+/// Counts the "@fold" captures of a query in the tree of a node. The query
+/// must not need Lua for its matches: its predicates are builtin and its
+/// directives do not change the range of the captures.
+///
+/// Lua arguments: node, query
+static int folds_add_matches(lua_State *L)
+{
+  TSLuaFolds *folds = folds_check(L, 1);
+  TSNode root = node_check(L, 2);
+  TSLuaQuery *lquery = query_check(L, 3);
+
+  uint32_t fold_id = UINT32_MAX;
+  uint32_t n_captures = ts_query_capture_count(lquery->query);
+  for (uint32_t i = 0; i < n_captures; i++) {
+    uint32_t len;
+    const char *name = ts_query_capture_name_for_id(lquery->query, i, &len);
+    if (len == 4 && strncmp(name, "fold", 4) == 0) {
+      fold_id = i;
+      break;
+    }
+  }
+  if (fold_id == UINT32_MAX) {
+    return 0;
+  }
+  if (!handle_get_buffer(folds->buf)) {
+    return luaL_error(L, "Invalid buffer id: %d", folds->buf);
+  }
+
+  if (!folds->cursor) {
+    folds->cursor = ts_query_cursor_new();
+  }
+  TSQueryCursor *cursor = folds->cursor;
+  // Start from the line above, to count the folds which end there.
+  ts_query_cursor_exec(cursor, lquery->query, root);
+  ts_query_cursor_set_point_range(cursor, (TSPoint){ (uint32_t)MAX(folds->srow - 1, 0), 0 },
+                                  (TSPoint){ (uint32_t)folds->erow, 0 });
+
+  TSLuaSource source = { .buf = folds->buf };
+  TSQueryMatch match;
+  while (ts_query_cursor_next_match(cursor, &match)) {
+    if (!predicates_match(L, lquery, &match, &source)) {
+      continue;
+    }
+    const TSQueryCapture *first = NULL;
+    const TSQueryCapture *last = NULL;
+    for (uint16_t i = 0; i < match.capture_count; i++) {
+      if (match.captures[i].index == fold_id) {
+        first = first ? first : &match.captures[i];
+        last = &match.captures[i];
+      }
+    }
+    if (first) {
+      // assumes the nodes of a quantified capture are ordered by range
+      TSPoint end = ts_node_end_point(last->node);
+      folds_count(folds, (int)ts_node_start_point(first->node).row, (int)end.row,
+                  (int)end.column);
+    }
+  }
+
+  return 0;
+}
+
+/// Sets the fold levels of the lines of the buffer from the folds counted.
+static int folds_apply(lua_State *L)
+{
+  TSLuaFolds *folds = folds_check(L, 1);
+  buf_T *buf = handle_get_buffer(folds->buf);
+  if (!buf) {
+    return luaL_error(L, "Invalid buffer id: %d", folds->buf);
+  }
+  fold_levels_set(buf, folds->srow, folds->erow, folds->enter, folds->leave);
+  return 0;
+}
+
 // TSQuery
 
 static struct luaL_Reg query_meta[] = {
@@ -1514,6 +2640,7 @@ static struct luaL_Reg query_meta[] = {
   { "inspect", query_inspect },
   { "disable_capture", query_disable_capture },
   { "disable_pattern", query_disable_pattern },
+  { "_compiled_predicates", query_compiled_predicates },
   { NULL, NULL }
 };
 
@@ -1539,10 +2666,12 @@ static int tslua_parse_query(lua_State *L)
     return luaL_error(L, "%s", err_msg);
   }
 
-  TSQuery **ud = lua_newuserdata(L, sizeof(TSQuery *));  // [udata]
-  *ud = query;
+  TSLuaQuery *ud = lua_newuserdata(L, sizeof(TSLuaQuery));  // [udata]
+  *ud = (TSLuaQuery){ .query = query };
   lua_getfield(L, LUA_REGISTRYINDEX, TS_META_QUERY);  // [udata, meta]
   lua_setmetatable(L, -2);  // [udata]
+
+  query_compile_predicates(ud);
   return 1;
 }
 
@@ -1634,17 +2763,22 @@ static void query_err_string(const char *src, int error_offset, TSQueryError err
   snprintf(err, errlen, "%.*s\n%*s^\n", error_line_len, error_line, column, "");
 }
 
-static TSQuery *query_check(lua_State *L, int index)
+static TSLuaQuery *query_check(lua_State *L, int index)
 {
-  TSQuery **ud = luaL_checkudata(L, index, TS_META_QUERY);
-  luaL_argcheck(L, *ud, index, "TSQuery expected");
-  return *ud;
+  TSLuaQuery *ud = luaL_checkudata(L, index, TS_META_QUERY);
+  luaL_argcheck(L, ud->query, index, "TSQuery expected");
+  return ud;
 }
 
 static int query_gc(lua_State *L)
 {
-  TSQuery *query = query_check(L, 1);
-  ts_query_delete(query);
+  TSLuaQuery *lq = query_check(L, 1);
+  for (uint32_t i = 0; i < lq->n_patterns; i++) {
+    predicates_free(lq->predicates[i].items, lq->predicates[i].size);
+    xfree(lq->predicates[i].items);
+  }
+  xfree(lq->predicates);
+  ts_query_delete(lq->query);
   return 0;
 }
 
@@ -1656,7 +2790,7 @@ static int query_tostring(lua_State *L)
 
 static int query_inspect(lua_State *L)
 {
-  TSQuery *query = query_check(L, 1);
+  TSQuery *query = query_check(L, 1)->query;
 
   // TSQueryInfo
   lua_createtable(L, 0, 2);  // [retval]
@@ -1714,7 +2848,7 @@ static int query_inspect(lua_State *L)
 
 static int query_disable_capture(lua_State *L)
 {
-  TSQuery *query = query_check(L, 1);
+  TSQuery *query = query_check(L, 1)->query;
   size_t name_len;
   const char *name = luaL_checklstring(L, 2, &name_len);
   ts_query_disable_capture(query, name, (uint32_t)name_len);
@@ -1723,12 +2857,494 @@ static int query_disable_capture(lua_State *L)
 
 static int query_disable_pattern(lua_State *L)
 {
-  TSQuery *query = query_check(L, 1);
+  TSQuery *query = query_check(L, 1)->query;
   const uint32_t pattern_index = (uint32_t)luaL_checkinteger(L, 2);
   ts_query_disable_pattern(query, pattern_index - 1);
   return 0;
 }
 
+/// Returns the predicates which are evaluated by query cursors with a source:
+/// pattern index => { [predicate index] = true }, both 1-based as in
+/// query:inspect().
+static int query_compiled_predicates(lua_State *L)
+{
+  TSLuaQuery *lq = query_check(L, 1);
+  lua_createtable(L, 0, 0);  // [retval]
+  for (uint32_t i = 0; i < lq->n_patterns; i++) {
+    TSLuaPredicates preds = lq->predicates[i];
+    if (preds.size == 0) {
+      continue;
+    }
+    lua_createtable(L, 0, (int)preds.size);  // [retval, pat]
+    for (uint32_t k = 0; k < preds.size; k++) {
+      lua_pushboolean(L, true);  // [retval, pat, true]
+      lua_rawseti(L, -2, preds.items[k].index);  // [retval, pat]
+    }
+    lua_rawseti(L, -2, (int)i + 1);  // [retval]
+  }
+  return 1;
+}
+
+// Query predicates
+
+static const struct {
+  const char *name;
+  TSLuaPredicateKind kind;
+  bool any;
+} builtin_predicates[] = {
+  { "eq?", kTSPredEq, false },
+  { "any-eq?", kTSPredEq, true },
+  { "match?", kTSPredMatch, false },
+  { "any-match?", kTSPredMatch, true },
+  { "vim-match?", kTSPredMatch, false },
+  { "any-vim-match?", kTSPredMatch, true },
+  { "lua-match?", kTSPredLuaMatch, false },
+  { "any-lua-match?", kTSPredLuaMatch, true },
+  { "contains?", kTSPredContains, false },
+  { "any-contains?", kTSPredContains, true },
+  { "any-of?", kTSPredAnyOf, true },
+  { "has-ancestor?", kTSPredHasAncestor, true },
+  { "has-parent?", kTSPredHasParent, true },
+};
+
+/// Compiles the builtin predicates of every pattern of a query, so that query
+/// cursors can evaluate them without calling into Lua.
+///
+/// If any builtin predicate of a pattern cannot be compiled, none are, and Lua
+/// evaluates the pattern as before (and reports the error).
+static void query_compile_predicates(TSLuaQuery *lq)
+{
+  lq->n_patterns = ts_query_pattern_count(lq->query);
+  lq->predicates = xcalloc(lq->n_patterns, sizeof(*lq->predicates));
+
+  kvec_t(TSLuaPredicate) preds = KV_INITIAL_VALUE;
+  for (uint32_t i = 0; i < lq->n_patterns; i++) {
+    uint32_t len;
+    const TSQueryPredicateStep *steps = ts_query_predicates_for_pattern(lq->query, i, &len);
+
+    bool failed = false;
+    int index = 0;
+    for (uint32_t start = 0; start < len && !failed;) {
+      uint32_t end = start;
+      while (end < len && steps[end].type != TSQueryPredicateStepTypeDone) {
+        end++;
+      }
+      index++;
+
+      TSLuaPredicate pred;
+      switch (predicate_compile(lq->query, steps + start, end - start, &pred)) {
+      case kTSPredCompiled:
+        pred.index = index;
+        kv_push(preds, pred);
+        break;
+      case kTSPredFailed:
+        failed = true;
+        break;
+      case kTSPredOther:
+        break;
+      }
+      start = end + 1;
+    }
+
+    if (failed) {
+      predicates_free(preds.items, kv_size(preds));
+    } else if (kv_size(preds) > 0) {
+      lq->predicates[i] = (TSLuaPredicates){
+        .items = xmemdup(preds.items, kv_size(preds) * sizeof(*preds.items)),
+        .size = (uint32_t)kv_size(preds),
+      };
+    }
+    kv_size(preds) = 0;
+  }
+  kv_destroy(preds);
+}
+
+static TSLuaPredicateCompile predicate_compile(const TSQuery *query,
+                                               const TSQueryPredicateStep *steps, uint32_t n,
+                                               TSLuaPredicate *pred)
+{
+  if (n == 0 || steps[0].type != TSQueryPredicateStepTypeString) {
+    return kTSPredOther;
+  }
+  uint32_t name_len;
+  const char *name = ts_query_string_value_for_id(query, steps[0].value_id, &name_len);
+
+  *pred = (TSLuaPredicate){ .should_match = true, .other = UINT32_MAX };
+  if (name_len > 4 && strncmp(name, "not-", 4) == 0) {
+    pred->should_match = false;
+    name += 4;
+    name_len -= 4;
+  }
+
+  size_t i;
+  for (i = 0; i < ARRAY_SIZE(builtin_predicates); i++) {
+    if (strlen(builtin_predicates[i].name) == name_len
+        && memcmp(builtin_predicates[i].name, name, name_len) == 0) {
+      break;
+    }
+  }
+  if (i == ARRAY_SIZE(builtin_predicates)) {
+    return kTSPredOther;
+  }
+  pred->kind = builtin_predicates[i].kind;
+  pred->any = builtin_predicates[i].any;
+
+  if (n < 2 || steps[1].type != TSQueryPredicateStepTypeCapture) {
+    return kTSPredFailed;
+  }
+  pred->capture = steps[1].value_id;
+
+  uint32_t n_args = n - 2;
+  switch (pred->kind) {
+  case kTSPredEq:
+    if (n < 3) {
+      return kTSPredFailed;
+    }
+    if (steps[2].type == TSQueryPredicateStepTypeCapture) {
+      pred->other = steps[2].value_id;
+      return kTSPredCompiled;
+    }
+    n_args = 1;
+    break;
+  case kTSPredMatch:
+  case kTSPredLuaMatch:
+    if (n < 3) {
+      return kTSPredFailed;
+    }
+    n_args = 1;
+    break;
+  default:
+    break;
+  }
+
+  for (uint32_t k = 0; k < n_args; k++) {
+    if (steps[2 + k].type != TSQueryPredicateStepTypeString) {
+      return kTSPredFailed;
+    }
+  }
+  pred->args = xcalloc(MAX(n_args, 1), sizeof(String));
+  pred->n_args = n_args;
+  for (uint32_t k = 0; k < n_args; k++) {
+    uint32_t len;
+    const char *str = ts_query_string_value_for_id(query, steps[2 + k].value_id, &len);
+    pred->args[k] = (String){ .data = (char *)str, .size = len };
+  }
+
+  if (pred->kind == kTSPredMatch) {
+    // same as check_magic() in query.lua
+    String pat = pred->args[0];
+    bool magic = pat.size < 2 || (pat.data[0] == '\\' && memchr("vmMV", pat.data[1], 4));
+    size_t prefix = magic ? 0 : 2;
+    char *re = xmallocz(prefix + pat.size);
+    memcpy(re, "\\v", prefix);
+    memcpy(re + prefix, pat.data, pat.size);
+    Error err = ERROR_INIT;
+    TRY_WRAP(&err, {
+      pred->regprog = vim_regcomp(re, RE_AUTO | RE_MAGIC | RE_STRICT);
+    });
+    xfree(re);
+    if (ERROR_SET(&err) || pred->regprog == NULL) {
+      api_clear_error(&err);
+      predicates_free(pred, 1);
+      return kTSPredFailed;
+    }
+  }
+
+  return kTSPredCompiled;
+}
+
+static void predicates_free(TSLuaPredicate *preds, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    xfree(preds[i].args);
+    vim_regfree(preds[i].regprog);
+  }
+}
+
+/// Evaluates the builtin predicates of the pattern of "match" against the text
+/// of "source".
+static bool predicates_match(lua_State *L, TSLuaQuery *lq, const TSQueryMatch *match,
+                             const TSLuaSource *source)
+{
+  TSLuaPredicates preds = lq->predicates[match->pattern_index];
+  if (preds.size == 0) {
+    return true;
+  }
+
+  buf_T *buf = NULL;
+  if (source->buf != 0) {
+    buf = handle_get_buffer(source->buf);
+    if (!buf) {
+      luaL_error(L, "Invalid buffer id: %d", source->buf);
+    }
+  }
+
+  for (uint32_t i = 0; i < preds.size; i++) {
+    TSLuaPredicate *pred = &preds.items[i];
+    if (predicate_eval(L, pred, match, buf, source) != pred->should_match) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Evaluates one predicate like the handlers in query.lua: it passes if the
+/// capture has no nodes, otherwise the text of all nodes (or any node for
+/// "any-" predicates) must match.
+///
+/// "#eq? @a @b" compares the nodes of "@a" with the only node of "@b".  It is
+/// false if "@b" has no nodes, and an error if it has several.
+static bool predicate_eval(lua_State *L, TSLuaPredicate *pred, const TSQueryMatch *match,
+                           buf_T *buf, const TSLuaSource *source)
+{
+  String other = STRING_INIT;
+  if (pred->other != UINT32_MAX && capture_has_node(match, pred->capture)) {
+    TSNode other_node;
+    uint16_t other_count = 0;
+    for (uint16_t i = 0; i < match->capture_count; i++) {
+      if (match->captures[i].index == pred->other) {
+        other_node = match->captures[i].node;
+        other_count++;
+      }
+    }
+    if (other_count == 0) {
+      return false;
+    } else if (other_count > 1) {
+      luaL_error(L, "#eq? does not support comparison with captures on multiple nodes");
+    }
+    // The next node_text() call may free the buffer line, keep a copy.
+    other = node_text(other_node, buf, source, &pred_other_text, true, false, NULL);
+  }
+
+  bool found = false;
+  for (uint16_t i = 0; i < match->capture_count; i++) {
+    if (match->captures[i].index != pred->capture) {
+      continue;
+    }
+    found = true;
+    TSNode node = match->captures[i].node;
+
+    if (pred->kind == kTSPredHasAncestor) {
+      if (node_has_ancestor_type(node, pred->args, pred->n_args)) {
+        return true;
+      }
+      continue;
+    } else if (pred->kind == kTSPredHasParent) {
+      TSNode parent = ts_node_parent(node);
+      if (!ts_node_is_null(parent) && node_type_in(parent, pred->args, pred->n_args)) {
+        return true;
+      }
+      continue;
+    }
+
+    String text = node_text(node, buf, source, &pred_text, false, pred->kind == kTSPredMatch,
+                            NULL);
+    bool res = false;
+    switch (pred->kind) {
+    case kTSPredEq:
+      res = string_eq(text, pred->other != UINT32_MAX ? other : pred->args[0]);
+      break;
+    case kTSPredMatch: {
+      regmatch_T rm = { .regprog = pred->regprog, .rm_ic = false };
+      res = vim_regexec(&rm, text.data, 0);
+      pred->regprog = rm.regprog;
+      if (!pred->regprog) {
+        luaL_error(L, "regex: internal error");
+      }
+      break;
+    }
+    case kTSPredLuaMatch:
+      lua_getglobal(L, "string");  // [string]
+      lua_getfield(L, -1, "find");  // [string, find]
+      lua_pushlstring(L, text.data, text.size);  // [string, find, text]
+      lua_pushlstring(L, pred->args[0].data, pred->args[0].size);  // [string, find, text, pat]
+      lua_call(L, 2, 1);  // [string, start]
+      res = !lua_isnil(L, -1);
+      lua_pop(L, 2);
+      break;
+    case kTSPredContains:
+      for (size_t k = 0; k < pred->n_args; k++) {
+        res = string_contains(text, pred->args[k]);
+        if (res == pred->any) {
+          return res;
+        }
+      }
+      continue;
+    case kTSPredAnyOf:
+      for (size_t k = 0; k < pred->n_args; k++) {
+        if (string_eq(text, pred->args[k])) {
+          return true;
+        }
+      }
+      continue;
+    default:
+      abort();
+    }
+
+    if (res == pred->any) {
+      return res;
+    }
+  }
+
+  if (!found) {
+    return true;
+  }
+  // "any-of?" and the node type predicates only pass if some node matched.
+  return pred->kind == kTSPredAnyOf || pred->kind == kTSPredHasAncestor
+         || pred->kind == kTSPredHasParent ? false : !pred->any;
+}
+
+/// Whether capture "capture" has any nodes in "match".
+static bool capture_has_node(const TSQueryMatch *match, uint32_t capture)
+{
+  for (uint16_t i = 0; i < match->capture_count; i++) {
+    if (match->captures[i].index == capture) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Gets the text of a node like vim.treesitter.get_node_text(). The text points
+/// into the source string or the buffer line if it is contiguous there,
+/// otherwise it is copied into "scratch".
+///
+/// @param buf    NULL if the source is a string
+/// @param copy   always copy the text
+/// @param nul    the text must be NUL-terminated
+/// @param[out] oob  if not NULL, set to true when the node reaches past the last buffer line
+static String node_text(TSNode node, buf_T *buf, const TSLuaSource *source,
+                        StringBuilder *scratch, bool copy, bool nul, bool *oob)
+{
+  const char *data = "";
+  size_t size = 0;
+  bool terminated = true;
+
+  if (buf == NULL) {
+    size_t start = MIN(ts_node_start_byte(node), source->len);
+    size_t end = MIN(MAX(ts_node_end_byte(node), start), source->len);
+    data = source->str + start;
+    size = end - start;
+    terminated = end == source->len;
+  } else {
+    TSPoint start = ts_node_start_point(node);
+    TSPoint end = ts_node_end_point(node);
+    int start_row = (int)start.row;
+    int end_row = (int)end.row;
+    colnr_T start_col = (colnr_T)start.column;
+    colnr_T end_col = (colnr_T)end.column;
+    // A node which ends at column 0 ends on the previous line.
+    if (end_col == 0) {
+      if (start_row == end_row) {
+        start_row--;
+        start_col = MAXCOL;
+      }
+      end_row--;
+      end_col = MAXCOL;
+    }
+
+    if (start_row == end_row) {
+      colnr_T len = 0;
+      data = buf_line_text(buf, start_row, &len, oob);
+      start_col = MIN(start_col, len);
+      end_col = MAX(MIN(end_col, len), start_col);
+      data += start_col;
+      size = (size_t)(end_col - start_col);
+      terminated = end_col == len;
+      // NUL is stored as NL in the buffer.
+      copy |= memchr(data, NL, size) != NULL;
+    } else {
+      kv_size(*scratch) = 0;
+      for (int row = start_row; row <= end_row; row++) {
+        colnr_T len = 0;
+        const char *line = buf_line_text(buf, row, &len, oob);
+        colnr_T col = row == start_row ? MIN(start_col, len) : 0;
+        colnr_T col_end = row == end_row ? MIN(end_col, len) : len;
+        if (row > start_row) {
+          kv_push(*scratch, NL);
+        }
+        size_t line_size = (size_t)MAX(col_end - col, 0);
+        kv_concat_len(*scratch, line + col, line_size);
+        memchrsub(scratch->items + kv_size(*scratch) - line_size, NL, NUL, line_size);
+      }
+      size = kv_size(*scratch);
+      kv_push(*scratch, NUL);
+      return (String){ .data = scratch->items, .size = size };
+    }
+  }
+
+  if (copy || (nul && !terminated)) {
+    kv_size(*scratch) = 0;
+    kv_concat_len(*scratch, data, size);
+    kv_push(*scratch, NUL);
+    if (buf != NULL) {
+      memchrsub(scratch->items, NL, NUL, size);
+    }
+    data = scratch->items;
+  }
+  return (String){ .data = (char *)data, .size = size };
+}
+
+/// Gets a buffer line by 0-based row, or an empty line if the row is invalid.
+///
+/// @param[out] oob  if not NULL, set to true when the row is past the last line
+static const char *buf_line_text(buf_T *buf, int row, colnr_T *len, bool *oob)
+{
+  if (row < 0 || buf->b_ml.ml_mfp == NULL || row >= buf->b_ml.ml_line_count) {
+    if (oob != NULL && buf->b_ml.ml_mfp != NULL && row >= buf->b_ml.ml_line_count) {
+      *oob = true;
+    }
+    *len = 0;
+    return "";
+  }
+  *len = ml_get_buf_len(buf, row + 1);
+  return ml_get_buf(buf, row + 1);
+}
+
+static bool string_eq(String a, String b)
+{
+  return a.size == b.size && (a.size == 0 || memcmp(a.data, b.data, a.size) == 0);
+}
+
+static bool string_contains(String haystack, String needle)
+{
+  if (needle.size == 0) {
+    return true;
+  }
+  for (size_t i = 0; i + needle.size <= haystack.size; i++) {
+    if (haystack.data[i] == needle.data[0]
+        && memcmp(haystack.data + i, needle.data, needle.size) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool node_type_in(TSNode node, const String *types, size_t n)
+{
+  const char *type = ts_node_type(node);
+  size_t type_len = strlen(type);
+  for (size_t i = 0; i < n; i++) {
+    if (string_eq((String){ .data = (char *)type, .size = type_len }, types[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Same as __has_ancestor(), with the node types of a compiled predicate.
+static bool node_has_ancestor_type(TSNode descendant, const String *types, size_t n)
+{
+  TSNode node = ts_tree_root_node(descendant.tree);
+  while (node.id != descendant.id && !ts_node_is_null(node)) {
+    if (node_type_in(node, types, n)) {
+      return true;
+    }
+    node = ts_node_child_with_descendant(node, descendant);
+  }
+  return false;
+}
+
 // Library init
 
 static void build_meta(lua_State *L, const char *tname, const luaL_Reg *meta)
@@ -1754,6 +3370,8 @@ static void tslua_init(lua_State *L)
   build_meta(L, TS_META_QUERY, query_meta);
   build_meta(L, TS_META_QUERYCURSOR, querycursor_meta);
   build_meta(L, TS_META_QUERYMATCH, querymatch_meta);
+  build_meta(L, TS_META_HIGHLIGHTER, highlighter_meta);
+  build_meta(L, TS_META_FOLDS, folds_meta);
 
   ts_set_allocator(xmalloc, xcalloc, xrealloc, xfree);
 }
@@ -1772,6 +3390,9 @@ static int tslua_get_minimum_language_version(lua_State *L)
 
 void nlua_treesitter_free(void)
 {
+  map_destroy(ptr_t, &parse_jobs);
+  kv_destroy(pred_text);
+  kv_destroy(pred_other_text);
 #ifdef HAVE_WASMTIME
   if (wasmengine != NULL) {
     wasm_engine_delete(wasmengine);
@@ -1792,6 +3413,12 @@ void nlua_treesitter_init(lua_State *const lstate) FUNC_ATTR_NONNULL_ALL
   lua_pushcfunction(lstate, tslua_push_querycursor);
   lua_setfield(lstate, -2, "_create_ts_querycursor");
 
+  lua_pushcfunction(lstate, tslua_push_highlighter);
+  lua_setfield(lstate, -2, "_create_ts_highlighter");
+
+  lua_pushcfunction(lstate, tslua_push_folds);
+  lua_setfield(lstate, -2, "_create_ts_folds");
+
   lua_pushcfunction(lstate, tslua_add_language_from_object);
   lua_setfield(lstate, -2, "_ts_add_language_from_object");
 
@@ -1809,6 +3436,9 @@ void nlua_treesitter_init(lua_State *const lstate) FUNC_ATTR_NONNULL_ALL
   lua_pushcfunction(lstate, tslua_inspect_lang);
   lua_setfield(lstate, -2, "_ts_inspect_language");
 
+  lua_pushcfunction(lstate, tslua_language_fingerprint);
+  lua_setfield(lstate, -2, "_ts_language_fingerprint");
+
   lua_pushcfunction(lstate, tslua_parse_query);
   lua_setfield(lstate, -2, "_ts_parse_query");
 
@@ -1817,4 +3447,7 @@ void nlua_treesitter_init(lua_State *const lstate) FUNC_ATTR_NONNULL_ALL
 
   lua_pushcfunction(lstate, tslua_get_minimum_language_version);
   lua_setfield(lstate, -2, "_ts_get_minimum_language_version");
+
+  lua_pushcfunction(lstate, tslua_get_node_ranges);
+  lua_setfield(lstate, -2, "_ts_get_node_ranges");
 }
@@ -99,6 +99,7 @@
 #include "nvim/strings.h"
 #include "nvim/syntax.h"
 #include "nvim/terminal.h"
+#include "nvim/trace.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/ui_client.h"
@@ -196,6 +197,7 @@ void early_init(mparm_T *paramp)
   init_path(argv0 ? argv0 : "nvim");
   init_normal_cmds();   // Init the table of Normal mode commands.
   runtime_init();
+  trace_init();
   highlight_init();
 
 #ifdef MSWIN
@@ -275,6 +277,7 @@ int main(int argc, char **argv)
   init_params(&params, argc, argv);
 
   init_startuptime(&params);
+  init_trace(&params);
 
   // Need to find "--clean" before actually parsing arguments.
   for (int i = 1; i < params.argc; i++) {
@@ -334,6 +337,8 @@ int main(int argc, char **argv)
 
   if (use_builtin_ui && !remote_ui) {
     ui_client_forward_stdin = !stdin_isatty;
+    // The server traces the session instead, to the same file.
+    trace_stop();
     uint64_t rv = ui_client_start_server(get_vim_var_str(VV_PROGPATH),
                                          (size_t)params.argc, params.argv);
     if (!rv) {
@@ -686,6 +691,7 @@ void os_exit(int r)
   }
 
   ILOG("Nvim exit: %d", r);
+  trace_stop();
 
 #ifdef EXITFREE
   free_all_mem();
@@ -1127,6 +1133,9 @@ static void command_line_scan(mparm_T *parmp)
         } else if (STRNICMP(argv[0] + argv_idx, "startuptime", 11) == 0) {
           want_argument = true;
           argv_idx += 11;
+        } else if (STRNICMP(argv[0] + argv_idx, "trace", 5) == 0) {
+          want_argument = true;
+          argv_idx += 5;
         } else if (STRNICMP(argv[0] + argv_idx, "clean", 5) == 0) {
           parmp->use_vimrc = "NONE";
           parmp->clean = true;
@@ -1354,7 +1363,7 @@ static void command_line_scan(mparm_T *parmp)
             // "--server {address}"
             parmp->server_addr = argv[0];
           }
-          // "--startuptime <file>" already handled
+          // "--startuptime <file>" and "--trace <file>" already handled
           break;
 
         case 'q':    // "-q {errorfile}" QuickFix mode
@@ -1524,6 +1533,19 @@ static void init_startuptime(mparm_T *paramp)
   }
 }
 
+/// Start tracing to a file if "--trace" passed as an argument.
+static void init_trace(mparm_T *paramp)
+{
+  for (int i = 1; i < paramp->argc - 1; i++) {
+    if (STRICMP(paramp->argv[i], "--trace") == 0) {
+      if (!trace_start(paramp->argv[i + 1])) {
+        fprintf(stderr, _(e_notopen), paramp->argv[i + 1]);
+      }
+      break;
+    }
+  }
+}
+
 static void check_and_set_isatty(mparm_T *paramp)
 {
   stdin_isatty = os_isatty(STDIN_FILENO);
@@ -2213,6 +2235,7 @@ static void usage(void)
   printf(_("  --remote[-subcommand] Execute commands remotely on a server\n"));
   printf(_("  --server <address>    Connect to this Nvim server\n"));
   printf(_("  --startuptime <file>  Write startup timing messages to <file>\n"));
+  printf(_("  --trace <file>        Write a trace of events to <file>\n"));
   printf(_("\nSee \":help startup-options\" for all options.\n"));
 }
 
@@ -11,6 +11,10 @@
 // Use marktree_itr_current and marktree_itr_next/prev to read marks in a loop.
 // marktree_del_itr deletes the current mark of the iterator and implicitly
 // moves the iterator to the next mark.
+//
+// When many marks are added or removed at once, marktree_put_bulk and
+// marktree_del_bulk instead rebuild the whole tree bottom-up from a sorted
+// array of keys, and recompute the intersections of all pairs in one pass.
 
 // Copyright notice for kbtree (included in heavily modified form):
 //
@@ -118,6 +122,13 @@ typedef struct {
 } Damage;
 typedef kvec_withinit_t(Damage, 8) DamageList;
 
+// Used by the bulk operations: keys in tree order with absolute positions.
+typedef kvec_t(MTKey) MTKeyVec;
+
+// Bulk operations only rebuild the tree when they touch at least
+// 1/MT_BULK_RATIO of its keys, otherwise keys are put/deleted one at a time.
+#define MT_BULK_RATIO 4
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "marktree.c.generated.h"
 #endif
@@ -1395,6 +1406,249 @@ void marktree_restore_pair(MarkTree *b, MTKey key)
   marktree_intersect_pair(b, mt_lookup_key_side(key, false), itr, end_itr, false);
 }
 
+// bulk operations
+
+/// Put many marks at once. Like marktree_put() for each item of "marks",
+/// where "end_pos.row" is negative for an unpaired mark.
+void marktree_put_bulk(MarkTree *b, const MTPair *marks, size_t n)
+{
+  if (n * MT_BULK_RATIO < b->n_keys) {
+    for (size_t i = 0; i < n; i++) {
+      marktree_put(b, marks[i].start, marks[i].end_pos.row, marks[i].end_pos.col,
+                   marks[i].end_right_gravity);
+    }
+    return;
+  }
+
+  MTKeyVec new_keys = KV_INITIAL_VALUE;
+  kv_resize(new_keys, 2 * n);
+  for (size_t i = 0; i < n; i++) {
+    MTKey key = marks[i].start;
+    assert(!(key.flags & ~(MT_FLAG_EXTERNAL_MASK | MT_FLAG_RIGHT_GRAVITY)));
+    key.flags |= MT_FLAG_REAL;
+    if (marks[i].end_pos.row >= 0) {
+      key.flags |= MT_FLAG_PAIRED;
+      bool end_right = marks[i].end_right_gravity;
+      MTKey end_key = key;
+      end_key.flags = (uint16_t)((uint16_t)(key.flags & ~MT_FLAG_RIGHT_GRAVITY)
+                                 |(uint16_t)MT_FLAG_END
+                                 |(uint16_t)(end_right ? MT_FLAG_RIGHT_GRAVITY : 0));
+      end_key.pos = marks[i].end_pos;
+      kv_push(new_keys, end_key);
+    }
+    kv_push(new_keys, key);
+  }
+  qsort(new_keys.items, kv_size(new_keys), sizeof(MTKey), key_cmp_bulk);
+
+  MTKeyVec old_keys = KV_INITIAL_VALUE;
+  kv_resize(old_keys, b->n_keys);
+  if (b->root) {
+    marktree_collect(b->root, MTPos(0, 0), &old_keys);
+  }
+
+  // merge, existing keys go first when equal like with marktree_put()
+  MTKeyVec keys = KV_INITIAL_VALUE;
+  kv_resize(keys, kv_size(old_keys) + kv_size(new_keys));
+  size_t oi = 0;
+  size_t ni = 0;
+  while (oi < kv_size(old_keys) || ni < kv_size(new_keys)) {
+    if (ni == kv_size(new_keys)
+        || (oi < kv_size(old_keys) && key_cmp(kv_A(old_keys, oi), kv_A(new_keys, ni)) <= 0)) {
+      kv_push(keys, kv_A(old_keys, oi++));
+    } else {
+      kv_push(keys, kv_A(new_keys, ni++));
+    }
+  }
+  kv_destroy(old_keys);
+  kv_destroy(new_keys);
+
+  marktree_rebuild(b, keys.items, kv_size(keys));
+  kv_destroy(keys);
+}
+
+/// Delete many marks at once.
+///
+/// @param ids  lookup ids of the start side of the marks (mt_lookup_key_side(key, false)).
+///             Both sides of paired marks are deleted.
+void marktree_del_bulk(MarkTree *b, const uint64_t *ids, size_t n)
+{
+  if (n == 0 || !b->root) {
+    return;
+  }
+
+  if (n * MT_BULK_RATIO < b->n_keys) {
+    MarkTreeIter itr[1];
+    for (size_t i = 0; i < n; i++) {
+      marktree_lookup(b, ids[i], itr);
+      if (!itr->x) {
+        continue;
+      }
+      uint64_t other = marktree_del_itr(b, itr, false);
+      if (other) {
+        marktree_lookup(b, other, itr);
+        if (itr->x) {
+          marktree_del_itr(b, itr, false);
+        }
+      }
+    }
+    return;
+  }
+
+  Set(uint64_t) del = SET_INIT;
+  for (size_t i = 0; i < n; i++) {
+    set_put(uint64_t, &del, ids[i]);
+  }
+
+  MTKeyVec keys = KV_INITIAL_VALUE;
+  kv_resize(keys, b->n_keys);
+  marktree_collect(b->root, MTPos(0, 0), &keys);
+  size_t kept = 0;
+  for (size_t i = 0; i < kv_size(keys); i++) {
+    if (!set_has(uint64_t, &del, mt_lookup_key_side(kv_A(keys, i), false))) {
+      kv_A(keys, kept++) = kv_A(keys, i);
+    }
+  }
+  kv_size(keys) = kept;
+  set_destroy(uint64_t, &del);
+
+  marktree_rebuild(b, keys.items, kv_size(keys));
+  kv_destroy(keys);
+}
+
+static int key_cmp_bulk(const void *a, const void *b)
+{
+  const MTKey *ka = a;
+  const MTKey *kb = b;
+  int cmp = key_cmp(*ka, *kb);
+  // make the order of equal keys deterministic
+  return cmp ? cmp : mt_generic_cmp(mt_lookup_key(*ka), mt_lookup_key(*kb));
+}
+
+/// Append the keys of subtree "x" to "keys" in order, with absolute positions.
+///
+/// @param base  absolute position which the keys of "x" are relative to
+static void marktree_collect(MTNode *x, MTPos base, MTKeyVec *keys)
+{
+  for (int i = 0; i < x->n + 1; i++) {
+    if (x->level) {
+      MTPos child_base = base;
+      if (i > 0) {
+        child_base = x->key[i - 1].pos;
+        unrelative(base, &child_base);
+      }
+      marktree_collect(x->ptr[i], child_base, keys);
+    }
+    if (i < x->n) {
+      MTKey k = x->key[i];
+      unrelative(base, &k.pos);
+      kv_push(*keys, k);
+    }
+  }
+}
+
+/// max number of keys in a subtree of height "level"
+static size_t marktree_subtree_cap(int level)
+{
+  size_t cap = 1;
+  for (int i = 0; i <= level; i++) {
+    cap *= 2 * T;
+  }
+  return cap - 1;
+}
+
+/// Replace the contents of "b" with "keys", which must be in tree order and
+/// have absolute positions.
+///
+/// The tree is built bottom-up with all nodes filled evenly, and then the
+/// intersections of all pairs are computed from scratch.
+static void marktree_rebuild(MarkTree *b, MTKey *keys, size_t n)
+{
+  if (b->root) {
+    marktree_free_subtree(b, b->root);
+    b->root = NULL;
+  }
+  map_clear(uint64_t, b->id2node);
+  memset(b->meta_root, 0, kMTMetaCount * sizeof(b->meta_root[0]));
+  b->n_keys = n;
+  if (n == 0) {
+    return;
+  }
+
+  int level = 0;
+  while (marktree_subtree_cap(level) < n) {
+    level++;
+  }
+  assert(level < MT_MAX_DEPTH);
+  b->root = marktree_build(b, keys, n, level, MTPos(0, 0), true);
+  meta_describe_node(b->meta_root, b->root);
+
+  for (size_t i = 0; i < n; i++) {
+    if (!mt_start(keys[i])) {
+      continue;
+    }
+    uint64_t id = mt_lookup_key(keys[i]);
+    MarkTreeIter itr[1];
+    MarkTreeIter end_itr[1];
+    marktree_lookup(b, mt_lookup_key_side(keys[i], true), end_itr);
+    if (end_itr->x) {
+      marktree_lookup(b, id, itr);
+      marktree_intersect_pair(b, id, itr, end_itr, false);
+    }
+  }
+}
+
+/// Build a subtree of height "level" holding the "n" keys of "keys".
+///
+/// "n" must be within the bounds of a valid subtree of this height, which
+/// then also holds for each child as the keys are divided evenly.
+///
+/// @param base  absolute position of the key before the subtree
+static MTNode *marktree_build(MarkTree *b, MTKey *keys, size_t n, int level, MTPos base,
+                              bool root)
+{
+  // like marktree_put_key(), always allocate the root as an inner node
+  MTNode *x = marktree_alloc_node(b, level > 0 || root);
+  x->level = (int16_t)level;
+
+  if (level == 0) {
+    assert(n <= 2 * T - 1);
+    x->n = (int32_t)n;
+    for (int i = 0; i < x->n; i++) {
+      x->key[i] = keys[i];
+      relative(base, &x->key[i].pos);
+      refkey(b, x, i);
+    }
+    return x;
+  }
+
+  size_t child_cap = marktree_subtree_cap(level - 1);
+  size_t n_child = (n + 1 + child_cap) / (child_cap + 1);
+  if (!root) {
+    n_child = MAX(n_child, T);
+  }
+  assert(n_child >= 2 && n_child <= 2 * T);
+  size_t child_keys = (n - (n_child - 1)) / n_child;
+  size_t extra = (n - (n_child - 1)) % n_child;
+
+  size_t k = 0;
+  for (size_t i = 0; i < n_child; i++) {
+    size_t len = child_keys + (i < extra ? 1 : 0);
+    MTNode *y = marktree_build(b, keys + k, len, level - 1, i > 0 ? keys[k - 1].pos : base, false);
+    y->parent = x;
+    y->p_idx = (int16_t)i;
+    x->ptr[i] = y;
+    meta_describe_node(x->meta[i], y);
+    k += len;
+    if (i < n_child - 1) {
+      x->key[i] = keys[k++];
+      relative(base, &x->key[i].pos);
+      refkey(b, x, (int)i);
+    }
+  }
+  x->n = (int32_t)(n_child - 1);
+  return x;
+}
+
 // itr functions
 
 bool marktree_itr_get(MarkTree *b, int32_t row, int col, MarkTreeIter *itr)
@@ -2320,6 +2574,31 @@ void marktree_del_pair_test(MarkTree *b, uint32_t ns, uint32_t id)
   marktree_del_itr(b, itr, false);
 }
 
+// for unit test
+void marktree_put_bulk_test(MarkTree *b, uint32_t ns, uint32_t id, const int *pos, size_t n)
+{
+  MTPair *marks = xmalloc(n * sizeof(*marks));
+  for (size_t i = 0; i < n; i++) {
+    MTKey key = { { pos[4 * i], pos[4 * i + 1] }, ns, id + (uint32_t)i, 0,
+                  { .hl = DECOR_HIGHLIGHT_INLINE_INIT } };
+    marks[i] = (MTPair){ .start = key, .end_pos = { pos[4 * i + 2], pos[4 * i + 3] },
+                         .end_right_gravity = false };
+  }
+  marktree_put_bulk(b, marks, n);
+  xfree(marks);
+}
+
+// for unit test
+void marktree_del_bulk_test(MarkTree *b, uint32_t ns, const uint32_t *ids, size_t n)
+{
+  uint64_t *lookup_ids = xmalloc(n * sizeof(*lookup_ids));
+  for (size_t i = 0; i < n; i++) {
+    lookup_ids[i] = mt_lookup_id(ns, ids[i], false);
+  }
+  marktree_del_bulk(b, lookup_ids, n);
+  xfree(lookup_ids);
+}
+
 void marktree_check(MarkTree *b)
 {
 #ifndef NDEBUG
@@ -889,6 +889,7 @@ void free_all_mem(void)
   do_cmdline_cmd("set keymap=");
 
   free_titles();
+  free_stl_programs();
   free_findfile();
 
   // Obviously named calls.
@@ -548,6 +548,7 @@ void changed_window_setting(win_T *wp)
 /// Call changed_window_setting() for every window.
 void changed_window_setting_all(void)
 {
+  plines_cache_invalidate_all();
   FOR_ALL_TAB_WINDOWS(tp, wp) {
     changed_window_setting(wp);
   }
@@ -1770,6 +1771,7 @@ void scroll_cursor_top(win_T *wp, int min_scroll, int always)
   int old_skipcol = wp->w_skipcol;
   linenr_T old_topfill = wp->w_topfill;
   int off = get_scrolloff_value(wp);
+  win_T *const save_plines_win = plines_cache_begin(wp);
 
   if (mouse_dragging > 0) {
     off = mouse_dragging - 1;
@@ -1868,6 +1870,7 @@ void scroll_cursor_top(win_T *wp, int min_scroll, int always)
     wp->w_valid |= VALID_TOPLINE;
     wp->w_viewport_invalid = true;
   }
+  plines_cache_end(save_plines_win);
 }
 
 // Set w_empty_rows and w_filler_rows for window "wp", having used up "used"
@@ -1906,6 +1909,7 @@ void scroll_cursor_bot(win_T *wp, int min_scroll, bool set_topbot)
   int old_empty_rows = wp->w_empty_rows;
   linenr_T cln = wp->w_cursor.lnum;  // Cursor Line Number
   bool do_sms = wp->w_p_wrap && wp->w_p_sms;
+  win_T *const save_plines_win = plines_cache_begin(wp);
 
   if (set_topbot) {
     int used = 0;
@@ -2117,6 +2121,7 @@ void scroll_cursor_bot(win_T *wp, int min_scroll, bool set_topbot)
   if (set_topbot) {
     cursor_correct_sms(wp);
   }
+  plines_cache_end(save_plines_win);
 }
 
 /// Recompute topline to put the cursor halfway across the window
@@ -2128,6 +2133,7 @@ void scroll_cursor_halfway(win_T *wp, bool atend, bool prefer_above)
   linenr_T old_topline = wp->w_topline;
   lineoff_T loff = { .lnum = wp->w_cursor.lnum };
   lineoff_T boff = { .lnum = wp->w_cursor.lnum };
+  win_T *const save_plines_win = plines_cache_begin(wp);
   hasFolding(wp, loff.lnum, &loff.lnum, &boff.lnum);
   int used = plines_win_nofill(wp, loff.lnum, true);
   loff.fill = 0;
@@ -2246,6 +2252,7 @@ void scroll_cursor_halfway(win_T *wp, bool atend, bool prefer_above)
   check_topfill(wp, false);
   wp->w_valid &= ~(VALID_WROW|VALID_CROW|VALID_BOTLINE|VALID_BOTLINE_AP);
   wp->w_valid |= VALID_TOPLINE;
+  plines_cache_end(save_plines_win);
 }
 
 // Correct the cursor position so that it is in a part of the screen at least
@@ -29,6 +29,7 @@
 #include "nvim/msgpack_rpc/packer_defs.h"
 #include "nvim/msgpack_rpc/unpacker.h"
 #include "nvim/os/input.h"
+#include "nvim/trace.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/ui_client.h"
@@ -363,7 +364,9 @@ static void request_event(void **argv)
     goto free_ret;
   }
 
+  TRACE_BEGIN("rpc_request", handler.name);
   Object result = handler.fn(channel->id, e->args, &e->used_mem, &error);
+  TRACE_END("rpc_request");
   if (e->type == kMessageTypeRequest || ERROR_SET(&error)) {
     // Send the response.
     serialize_response(channel, e->handler, e->type, e->request_id, &error, &result);
@@ -92,6 +92,7 @@
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
 #include "nvim/path.h"
+#include "nvim/plines.h"
 #include "nvim/popupmenu.h"
 #include "nvim/pos_defs.h"
 #include "nvim/regexp.h"
@@ -3008,6 +3009,8 @@ void check_redraw_for(buf_T *buf, win_T *win, uint32_t flags)
       redraw_later(win, UPD_NOT_VALID);
     } else {
       changed_window_setting(win);
+      // Text may also be displayed differently in other windows.
+      plines_cache_invalidate_all();
     }
   }
   if (flags & kOptFlagRedrBuf) {
@@ -22,6 +22,7 @@
 #include "nvim/mbyte.h"
 #include "nvim/mbyte_defs.h"
 #include "nvim/memline.h"
+#include "nvim/memory.h"
 #include "nvim/move.h"
 #include "nvim/option.h"
 #include "nvim/option_vars.h"
@@ -35,6 +36,9 @@
 # include "plines.c.generated.h"
 #endif
 
+/// Minimal number of lines in a range for using the line height cache.
+#define PLINES_CACHE_MIN_LINES 100
+
 /// Functions calculating horizontal size of text, when displayed in a window.
 
 /// Return the number of cells the first char in "p" will take on the screen,
@@ -784,6 +788,25 @@ int plines_win_nofill(win_T *wp, linenr_T lnum, bool limit_winheight)
 /// Get number of window lines physical line "lnum" will occupy in window "wp".
 /// Does not care about folding, 'wrap' or filler lines.
 int plines_win_nofold(win_T *wp, linenr_T lnum)
+{
+  LineHeightCache *const cache = &wp->w_plines_cache;
+  // The cache was checked to match the window by plines_cache_begin().
+  const bool use_cache = wp == plines_cache_win && cache->buf_handle != 0
+                         && cache->generation == plines_cache_generation
+                         && lnum >= 1 && lnum <= cache->size;
+  if (use_cache && cache->heights[lnum - 1] >= 0) {
+    return cache->heights[lnum - 1];
+  }
+
+  const int lines = plines_win_nofold_nocache(wp, lnum);
+  if (use_cache) {
+    plines_cache_set(cache, lnum, lines);
+  }
+  return lines;
+}
+
+/// Like plines_win_nofold(), but always compute the height.
+static int plines_win_nofold_nocache(win_T *wp, linenr_T lnum)
 {
   char *s = ml_get_buf(wp->w_buffer, lnum);
   CharsizeArg csarg;
@@ -919,8 +942,17 @@ int plines_win_full(win_T *wp, linenr_T lnum, linenr_T *const nextp, bool *const
 /// @see win_text_height
 int plines_m_win(win_T *wp, linenr_T first, linenr_T last, int max)
 {
+  win_T *const save_plines_win = plines_cache_begin(wp);
   int count = 0;
 
+  if (last - first >= PLINES_CACHE_MIN_LINES
+      && (first > wp->w_topline || last < wp->w_topline)
+      && plines_cache_range_usable(wp)) {
+    // The result is limited to "max" below, no need to stop early.
+    count = (int)MIN(plines_cache_range(wp, first, last, NULL), INT_MAX);
+    first = last + 1;
+  }
+
   while (first <= last && count < max) {
     linenr_T next = first;
     count += plines_win_full(wp, first, &next, NULL, false, false);
@@ -929,6 +961,7 @@ int plines_m_win(win_T *wp, linenr_T first, linenr_T last, int max)
   if (first == wp->w_buffer->b_ml.ml_line_count + 1) {
     count += win_get_fill(wp, first);
   }
+  plines_cache_end(save_plines_win);
   return MIN(max, count);
 }
 
@@ -980,6 +1013,7 @@ int64_t win_text_height(win_T *const wp, const linenr_T start_lnum, const int64_
   linenr_T lnum = start_lnum;
   linenr_T cur_lnum = lnum;
   bool cur_folded = false;
+  win_T *const save_plines_win = plines_cache_begin(wp);
 
   if (start_vcol >= 0) {
     linenr_T lnum_next = lnum;
@@ -993,7 +1027,26 @@ int64_t win_text_height(win_T *const wp, const linenr_T start_lnum, const int64_
     lnum = lnum_next + 1;
   }
 
+  bool try_cache = *end_lnum - lnum >= PLINES_CACHE_MIN_LINES && plines_cache_range_usable(wp);
   while (lnum <= *end_lnum && height_sum_nofill + height_sum_fill < max) {
+    if (try_cache) {
+      // Skip over the lines before "end_lnum" for which "max" is not reached.
+      try_cache = false;
+      int64_t fill_lines = 0;
+      int64_t text_lines = 0;
+      linenr_T last = plines_cache_find(wp, lnum, *end_lnum - 1,
+                                        max - height_sum_nofill - height_sum_fill,
+                                        &text_lines, &fill_lines);
+      if (last >= lnum) {
+        height_sum_fill += fill_lines;
+        height_sum_nofill += text_lines;
+        height_cur_nofill = plines_win_nofill(wp, last, false);
+        cur_lnum = last;
+        cur_folded = false;
+        lnum = last + 1;
+        continue;
+      }
+    }
     linenr_T lnum_next = lnum;
     cur_folded = hasFolding(wp, lnum, &lnum, &lnum_next);
     height_sum_fill += win_get_fill(wp, lnum);
@@ -1003,6 +1056,8 @@ int64_t win_text_height(win_T *const wp, const linenr_T start_lnum, const int64_
     lnum = lnum_next + 1;
   }
 
+  plines_cache_end(save_plines_win);
+
   int64_t vcol_end = *end_vcol;
   bool use_vcol = vcol_end >= 0 && lnum > *end_lnum;
   if (use_vcol) {
@@ -1034,3 +1089,333 @@ int64_t win_text_height(win_T *const wp, const linenr_T start_lnum, const int64_
   }
   return height_sum_fill + height_sum_nofill;
 }
+
+/// Functions maintaining the line height cache of a window.
+///
+/// "w_plines_cache.heights" holds the result of plines_win_nofold() for every
+/// buffer line, or -1 when it was not computed yet.  Heights are computed when
+/// first asked for.  When the height of a range of lines is asked for, a
+/// Fenwick tree over the heights is built, so that the height of a range and
+/// the line where a range reaches a certain height are found in O(log n).
+///
+/// plines_win_nofold() is called for every line that is drawn or scrolled
+/// over, so it does not check whether the cache matches the window.  That is
+/// done once by plines_cache_begin() in functions which compute the height of
+/// many lines, and only between that and plines_cache_end() the cache is used.
+///
+/// The cache follows the text changes reported to changed_lines(), like
+/// "w_lines[]" does: the heights of changed lines are invalidated and the
+/// heights of the lines below are moved.  Virtual lines and inline virtual
+/// text invalidate the lines they are in the same way (see
+/// changed_lines_invalidate_win()).  The cache is invalidated completely when
+/// the text width of the window changes, when an option that may change how
+/// text is displayed is set, or when the text of the buffer is replaced.
+
+/// Incremented to invalidate the line height cache of all windows.
+static int plines_cache_generation = 0;
+
+/// Window whose line height cache is used by plines_win_nofold(), NULL if none.
+static win_T *plines_cache_win = NULL;
+
+/// Invalidate the line height cache of all windows, e.g. when an option that
+/// may change how text is displayed was set.
+void plines_cache_invalidate_all(void)
+{
+  plines_cache_generation++;
+}
+
+/// Invalidate the line height cache of window "wp".
+void plines_cache_invalidate_win(win_T *wp)
+{
+  wp->w_plines_cache.buf_handle = 0;
+}
+
+/// Invalidate the line height cache of all windows displaying buffer "buf",
+/// e.g. when its text was replaced by reading a file.
+void plines_cache_invalidate_buf(buf_T *buf)
+{
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    if (wp->w_buffer == buf) {
+      plines_cache_invalidate_win(wp);
+    }
+  }
+}
+
+/// Free the line height cache of window "wp".
+void plines_cache_free(win_T *wp)
+{
+  LineHeightCache *const cache = &wp->w_plines_cache;
+  XFREE_CLEAR(cache->heights);
+  XFREE_CLEAR(cache->tree);
+  cache->size = 0;
+  cache->buf_handle = 0;
+  if (plines_cache_win == wp) {
+    plines_cache_win = NULL;
+  }
+}
+
+/// Start using the line height cache of window "wp" in plines_win_nofold(),
+/// after checking once that it matches the window.  The buffer text and the
+/// window size must not change until plines_cache_end() is called.
+///
+/// @return  the value to pass to plines_cache_end().
+win_T *plines_cache_begin(win_T *wp)
+{
+  win_T *const save = plines_cache_win;
+  plines_cache_win = plines_cache_prepare(wp) ? wp : NULL;
+  return save;
+}
+
+/// Stop using the line height cache of the window passed to
+/// plines_cache_begin().
+///
+/// @param save  value returned by plines_cache_begin().
+void plines_cache_end(win_T *save)
+{
+  plines_cache_win = save;
+}
+
+/// Make sure the line height cache of window "wp" can be used, (re)initializing
+/// it with all heights unknown when it does not match the window and its buffer.
+///
+/// @return  false when the cache cannot be used.
+static bool plines_cache_prepare(win_T *wp)
+{
+  LineHeightCache *const cache = &wp->w_plines_cache;
+  buf_T *const buf = wp->w_buffer;
+  if (buf == NULL || buf->b_ml.ml_mfp == NULL) {
+    return false;
+  }
+
+  const int width1 = wp->w_view_width - win_col_off(wp);
+  const int width2 = width1 + win_col_off2(wp);
+  const linenr_T size = buf->b_ml.ml_line_count;
+  if (cache->heights != NULL
+      && cache->buf_handle == buf->handle
+      && cache->generation == plines_cache_generation
+      && cache->size == size
+      && cache->width1 == width1
+      && cache->width2 == width2
+      && cache->wrap == wp->w_p_wrap
+      && cache->list == wp->w_p_list) {
+    return true;
+  }
+
+  cache->heights = xrealloc(cache->heights, ((size_t)size + 1) * sizeof(*cache->heights));
+  for (linenr_T i = 0; i < size; i++) {
+    cache->heights[i] = -1;
+  }
+  cache->size = size;
+  cache->dirty_top = 1;
+  cache->dirty_bot = size;
+  cache->tree_valid = false;
+  cache->buf_handle = buf->handle;
+  cache->generation = plines_cache_generation;
+  cache->width1 = width1;
+  cache->width2 = width2;
+  cache->wrap = wp->w_p_wrap;
+  cache->list = wp->w_p_list;
+  return true;
+}
+
+/// Invalidate the cached heights of lines "lnum" to "lnume" (exclusive) in
+/// window "wp", where "xtra" lines were inserted (negative when deleted) and
+/// lines from "lnume" onwards were moved.
+void plines_cache_invalidate(win_T *wp, linenr_T lnum, linenr_T lnume, linenr_T xtra)
+{
+  LineHeightCache *const cache = &wp->w_plines_cache;
+  buf_T *const buf = wp->w_buffer;
+  if (cache->heights == NULL || cache->buf_handle != buf->handle) {
+    return;  // will be reinitialized when used
+  }
+  if (cache->size + xtra != buf->b_ml.ml_line_count) {
+    // Lines were added or deleted without being reported.
+    plines_cache_invalidate_win(wp);
+    return;
+  }
+
+  lnum = MAX(lnum, 1);
+  lnume = MAX(MIN(lnume, cache->size + 1), lnum);
+  if (lnume + xtra < lnum) {
+    plines_cache_invalidate_win(wp);
+    return;
+  }
+  if (xtra == 0) {
+    for (linenr_T l = lnum; l < lnume; l++) {
+      plines_cache_set(cache, l, -1);
+    }
+  } else {
+    const linenr_T size = cache->size + xtra;
+    if (xtra > 0) {
+      cache->heights = xrealloc(cache->heights, ((size_t)size + 1) * sizeof(*cache->heights));
+    }
+    memmove(cache->heights + lnume - 1 + xtra, cache->heights + lnume - 1,
+            (size_t)(cache->size - lnume + 1) * sizeof(*cache->heights));
+    if (xtra < 0) {
+      cache->heights = xrealloc(cache->heights, ((size_t)size + 1) * sizeof(*cache->heights));
+    }
+    cache->size = size;
+    cache->tree_valid = false;
+    lnume = MIN(lnume + xtra, size + 1);
+    for (linenr_T l = lnum; l < lnume; l++) {
+      cache->heights[l - 1] = -1;
+    }
+    if (cache->dirty_top > 0) {
+      // Keep a range that includes the moved lines with an unknown height.
+      cache->dirty_top = MIN(cache->dirty_top, lnum);
+      cache->dirty_bot = MIN(cache->dirty_bot + MAX(xtra, 0), size);
+    }
+  }
+
+  if (lnum < lnume) {
+    if (cache->dirty_top == 0) {
+      cache->dirty_top = lnum;
+      cache->dirty_bot = lnume - 1;
+    } else {
+      cache->dirty_top = MIN(cache->dirty_top, lnum);
+      cache->dirty_bot = MAX(cache->dirty_bot, lnume - 1);
+    }
+  }
+}
+
+/// Set the cached height of line "lnum" to "height", -1 for unknown.
+static void plines_cache_set(LineHeightCache *cache, linenr_T lnum, int height)
+{
+  int *const cur = &cache->heights[lnum - 1];
+  if (cache->tree_valid) {
+    for (linenr_T i = lnum; i <= cache->size; i += i & -i) {
+      cache->tree[i] += MAX(height, 0) - MAX(*cur, 0);
+    }
+  }
+  *cur = height;
+}
+
+/// Sum of the cached heights of lines 1 to "lnum".
+static int64_t plines_cache_prefix(const LineHeightCache *cache, linenr_T lnum)
+{
+  int64_t sum = 0;
+  for (linenr_T i = lnum; i > 0; i -= i & -i) {
+    sum += cache->tree[i];
+  }
+  return sum;
+}
+
+/// Compute all unknown heights in the line height cache of window "wp" and
+/// build the Fenwick tree if needed.
+///
+/// @return  false when the cache cannot be used.
+static bool plines_cache_update(win_T *wp)
+{
+  LineHeightCache *const cache = &wp->w_plines_cache;
+  if (!plines_cache_prepare(wp)) {
+    return false;
+  }
+
+  if (cache->dirty_top > 0) {
+    for (linenr_T lnum = cache->dirty_top; lnum <= cache->dirty_bot; lnum++) {
+      if (cache->heights[lnum - 1] < 0) {
+        plines_cache_set(cache, lnum, plines_win_nofold_nocache(wp, lnum));
+      }
+    }
+    cache->dirty_top = 0;
+  }
+
+  if (!cache->tree_valid) {
+    // Build the tree in O(n): every node adds itself to its parent.
+    const linenr_T size = cache->size;
+    cache->tree = xrealloc(cache->tree, ((size_t)size + 1) * sizeof(*cache->tree));
+    cache->tree[0] = 0;
+    for (linenr_T i = 1; i <= size; i++) {
+      cache->tree[i] = cache->heights[i - 1];
+    }
+    for (linenr_T i = 1; i <= size; i++) {
+      linenr_T parent = i + (i & -i);
+      if (parent <= size) {
+        cache->tree[parent] += cache->tree[i];
+      }
+    }
+    cache->tree_valid = true;
+  }
+  return true;
+}
+
+/// Check whether the height of a range of lines in window "wp" can be computed
+/// from the line height cache: every line takes plines_win_nofold() screen
+/// lines plus the virtual lines above it.
+static bool plines_cache_range_usable(win_T *wp)
+{
+  return wp->w_p_wrap && wp->w_view_width > 0 && wp->w_p_cole < 2
+         && !(wp->w_p_diff && diffopt_filler()) && !hasAnyFolding(wp);
+}
+
+/// Get the number of window lines lines "first" to "last" occupy in window "wp",
+/// including filler lines.  Only valid when plines_cache_range_usable() is true.
+///
+/// @param[out] fill  If not NULL, set to the number of filler lines in the range.
+static int64_t plines_cache_range(win_T *wp, linenr_T first, linenr_T last, int64_t *fill)
+{
+  int64_t text = 0;
+  if (plines_cache_update(wp)) {
+    text = plines_cache_prefix(&wp->w_plines_cache, last)
+           - plines_cache_prefix(&wp->w_plines_cache, first - 1);
+  } else {
+    for (linenr_T lnum = first; lnum <= last; lnum++) {
+      text += plines_win_nofold(wp, lnum);
+    }
+  }
+  int64_t virt_lines = decor_virt_lines(wp, first - 1, last, NULL, NULL, true);
+  if (fill != NULL) {
+    *fill = virt_lines;
+  }
+  return text + virt_lines;
+}
+
+/// Find the last line in the range "first" to "last" of window "wp" for which
+/// the total height of the lines from "first" is less than "limit".
+/// Only valid when plines_cache_range_usable() is true.
+///
+/// @param[out] text_height  Set to the height of the found lines without filler lines.
+/// @param[out] fill         Set to the number of filler lines above the found lines.
+///
+/// @return  the line number, "first - 1" when the height was not found.
+static linenr_T plines_cache_find(win_T *wp, linenr_T first, linenr_T last, int64_t limit,
+                                  int64_t *text_height, int64_t *fill)
+{
+  *text_height = 0;
+  *fill = 0;
+  if (first > last || limit <= 0) {
+    return first - 1;
+  }
+
+  int64_t range_fill = 0;
+  int64_t range_height = plines_cache_range(wp, first, last, &range_fill);
+  if (range_height < limit) {
+    *text_height = range_height - range_fill;
+    *fill = range_fill;
+    return last;
+  }
+  // With virtual lines the tree alone cannot tell where "limit" is reached.
+  LineHeightCache *const cache = &wp->w_plines_cache;
+  if (range_fill > 0 || !cache->tree_valid) {
+    return first - 1;
+  }
+
+  // Descend the tree for the last line where the sum from line one is less
+  // than "target".
+  const int64_t base = plines_cache_prefix(cache, first - 1);
+  int64_t target = base + limit;
+  linenr_T lnum = 0;
+  linenr_T step = 1;
+  while (step <= cache->size / 2) {
+    step *= 2;
+  }
+  for (; step > 0; step /= 2) {
+    if (lnum + step <= cache->size && cache->tree[lnum + step] < target) {
+      lnum += step;
+      target -= cache->tree[lnum];
+    }
+  }
+  lnum = MIN(lnum, last);
+  *text_height = plines_cache_prefix(cache, lnum) - base;
+  return lnum;
+}
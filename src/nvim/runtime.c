@@ -26,6 +26,7 @@
 #include "nvim/eval.h"
 #include "nvim/eval/typval.h"
 #include "nvim/eval/userfunc.h"
+#include "nvim/event/loop.h"
 #include "nvim/ex_cmds_defs.h"
 #include "nvim/ex_docmd.h"
 #include "nvim/ex_eval.h"
@@ -38,6 +39,7 @@
 #include "nvim/hashtab_defs.h"
 #include "nvim/lua/executor.h"
 #include "nvim/macros_defs.h"
+#include "nvim/main.h"
 #include "nvim/map_defs.h"
 #include "nvim/mbyte.h"
 #include "nvim/mbyte_defs.h"
@@ -49,10 +51,12 @@
 #include "nvim/option_defs.h"
 #include "nvim/option_vars.h"
 #include "nvim/os/fs.h"
+#include "nvim/os/fs_defs.h"
 #include "nvim/os/input.h"
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
 #include "nvim/os/stdpaths_defs.h"
+#include "nvim/os/time.h"
 #include "nvim/path.h"
 #include "nvim/pos_defs.h"
 #include "nvim/profile.h"
@@ -60,6 +64,7 @@
 #include "nvim/regexp_defs.h"
 #include "nvim/runtime.h"
 #include "nvim/strings.h"
+#include "nvim/trace.h"
 #include "nvim/types_defs.h"
 #include "nvim/usercmd.h"
 #include "nvim/vim_defs.h"
@@ -90,14 +95,28 @@ typedef struct {
   vimconv_T conv;               ///< type of conversion
 } source_cookie_T;
 
+typedef kvec_t(char *) CharVec;
+
 typedef struct {
   char *path;
   bool after;
   TriState has_lua;
+  bool entries_cached;          ///< "entries" can be used while "path" has "entries_mtime"
+  uv_timespec_t entries_mtime;  ///< modification time of "path" when it was listed
+  CharVec entries;              ///< names of the files and directories in "path"
 } SearchPathItem;
 
 typedef kvec_t(SearchPathItem) RuntimeSearchPath;
-typedef kvec_t(char *) CharVec;
+
+/// Plugin files read on a worker thread before they are sourced.
+typedef struct {
+  uv_work_t req;
+  CharVec fnames;
+} PrefetchReq;
+
+/// Number of threadpool jobs reading plugin files, leaving the other threads
+/// of the pool free for other work.
+#define PREFETCH_JOBS 2
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "runtime.c.generated.h"
@@ -587,6 +606,8 @@ static int do_in_cached_path(char *name, int flags, DoInRuntimepathCB callback,
     if (name == NULL) {
       (*callback)(1, &item.path, do_all, cookie);
     } else if (buflen + strlen(name) + 2 < MAXPATHL) {
+      SearchPathItem *const itemp = &kv_A(path, j);
+      const bool listed = search_path_item_update_entries(itemp);
       STRCPY(buf, item.path);
       add_pathsep(buf);
       char *tail = buf + strlen(buf);
@@ -599,6 +620,10 @@ static int do_in_cached_path(char *name, int flags, DoInRuntimepathCB callback,
         assert(MAXPATHL >= (tail - buf));
         copy_option_part(&np, tail, (size_t)(MAXPATHL - (tail - buf)), "\t ");
 
+        if (listed && !search_path_item_may_contain(itemp, tail)) {
+          continue;
+        }
+
         if (p_verbose > 10) {
           verbose_enter();
           smsg(0, _("Searching for \"%s\""), buf);
@@ -890,10 +915,90 @@ static void runtime_search_path_free(RuntimeSearchPath path)
   for (size_t j = 0; j < kv_size(path); j++) {
     SearchPathItem item = kv_A(path, j);
     xfree(item.path);
+    search_path_item_clear_entries(&item);
   }
   kv_destroy(path);
 }
 
+static void search_path_item_clear_entries(SearchPathItem *item)
+{
+  for (size_t i = 0; i < kv_size(item->entries); i++) {
+    xfree(kv_A(item->entries, i));
+  }
+  kv_destroy(item->entries);
+  item->entries_cached = false;
+}
+
+/// Update the list of names in the directory of "item", unless it was not
+/// modified since it was last listed.
+///
+/// @return  false if the directory could not be listed.
+static bool search_path_item_update_entries(SearchPathItem *item)
+{
+  FileInfo info;
+  uv_timespec_t mtime = { 0, 0 };
+  const bool exists = os_fileinfo(item->path, &info);
+  if (exists) {
+    mtime = info.stat.st_mtim;
+  }
+  if (item->entries_cached && item->entries_mtime.tv_sec == mtime.tv_sec
+      && item->entries_mtime.tv_nsec == mtime.tv_nsec) {
+    return true;
+  }
+
+  search_path_item_clear_entries(item);
+  if (exists) {
+    Directory dir;
+    if (!os_scandir(&dir, item->path)) {
+      return false;
+    }
+    const char *name;
+    while ((name = os_scandir_next(&dir)) != NULL) {
+      kv_push(item->entries, xstrdup(name));
+    }
+    os_closedir(&dir);
+  }
+
+  // A directory modified in the same second it was listed may be modified
+  // again without its mtime changing on filesystems with coarse timestamps.
+  item->entries_cached = mtime.tv_sec < (int64_t)os_time() - 1;
+  item->entries_mtime = mtime;
+  return true;
+}
+
+/// Check whether the directory of "item" can contain a match for "pat", a
+/// pattern relative to it.  search_path_item_update_entries() must have been
+/// called for "item".
+///
+/// Only looks at the first component of "pat", which is checked against the
+/// names in the directory.  Most runtime files are searched for in all
+/// 'runtimepath' entries, while most plugins only have a few of "plugin/",
+/// "ftplugin/", "syntax/", etc.  This avoids expanding the pattern for those
+/// that can't match.
+static bool search_path_item_may_contain(SearchPathItem *item, const char *pat)
+{
+  size_t len = 0;
+  for (; pat[len] != NUL && !vim_ispathsep(pat[len]); len++) {
+    // Names with wildcards or non-ASCII characters are left for expansion.
+    if (vim_strchr("*?[{`$~\\", (uint8_t)pat[len]) != NULL || (uint8_t)pat[len] >= 0x80) {
+      return true;
+    }
+  }
+  // "." and ".." are not listed.
+  if (len == 0 || (pat[0] == '.' && (len == 1 || (len == 2 && pat[1] == '.')))) {
+    return true;
+  }
+
+  for (size_t i = 0; i < kv_size(item->entries); i++) {
+    const char *entry = kv_A(item->entries, i);
+    // Ignore case, file names may be case-insensitive.
+    if (STRNICMP(entry, pat, len) == 0 && entry[len] == NUL) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void runtime_search_path_validate(void)
 {
   if (!nlua_is_deferred_safe()) {
@@ -1305,7 +1410,7 @@ void load_plugins(void)
 
     // Don't use source_runtime_vim_lua() yet so we can check for :packloadall below.
     // NB: after calling this "rtp_copy" may have been freed if it wasn't copied.
-    source_in_path_vim_lua(rtp_copy, plugin_pattern, DIP_ALL | DIP_NOAFTER);
+    source_plugins(rtp_copy, plugin_pattern, DIP_ALL | DIP_NOAFTER);
     TIME_MSG("loading rtp plugins");
 
     // Only source "start" packages if not done already with a :packloadall
@@ -1316,11 +1421,108 @@ void load_plugins(void)
     }
     TIME_MSG("loading packages");
 
-    source_runtime_vim_lua(plugin_pattern, DIP_ALL | DIP_AFTER);
+    source_plugins(NULL, plugin_pattern, DIP_ALL | DIP_AFTER);
     TIME_MSG("loading after plugins");
   }
 }
 
+/// Like source_in_path_vim_lua(), or source_runtime_vim_lua() when "path" is
+/// NULL, but all files are found before any of them is sourced, so that they
+/// can be read on worker threads first.  Reading them from disk then overlaps
+/// with sourcing the files before them, instead of each read waiting until the
+/// previous file was executed.
+static void source_plugins(char *path, char *pattern, int flags)
+{
+  CharVec fnames = KV_INITIAL_VALUE;
+  if (path == NULL) {
+    do_in_runtimepath(pattern, flags, collect_vim_lua_callback, &fnames);
+  } else {
+    do_in_path_and_pp(path, pattern, flags, collect_vim_lua_callback, &fnames);
+  }
+
+  prefetch_files(&fnames);
+
+  for (size_t i = 0; i < kv_size(fnames); i++) {
+    do_source(kv_A(fnames, i), false, DOSO_NONE, NULL);
+    xfree(kv_A(fnames, i));
+  }
+  kv_destroy(fnames);
+}
+
+/// Add the .vim and .lua files in "fnames" to the CharVec "cookie", in the
+/// same order as source_callback_vim_lua() sources them.
+static bool collect_vim_lua_callback(int num_fnames, char **fnames, bool all, void *cookie)
+{
+  CharVec *files = cookie;
+  const size_t count = kv_size(*files);
+
+  for (int ext = 0; ext < 2; ext++) {
+    for (int i = 0; i < num_fnames; i++) {
+      if (path_with_extension(fnames[i], ext == 0 ? "vim" : "lua")) {
+        kv_push(*files, xstrdup(fnames[i]));
+      }
+    }
+  }
+
+  return kv_size(*files) > count;
+}
+
+/// Read the files in "fnames" on worker threads, which only fills the OS file
+/// cache: sourcing still reads each file itself.
+///
+/// The files are split between PREFETCH_JOBS jobs, each one reading every
+/// PREFETCH_JOBS-th file, so that the files sourced first are read first.
+static void prefetch_files(CharVec *fnames)
+{
+  const size_t njobs = MIN(kv_size(*fnames), (size_t)PREFETCH_JOBS);
+  for (size_t job = 0; job < njobs; job++) {
+    PrefetchReq *p = xmalloc(sizeof(*p));
+    kv_init(p->fnames);
+    for (size_t i = job; i < kv_size(*fnames); i += PREFETCH_JOBS) {
+      kv_push(p->fnames, xstrdup(kv_A(*fnames, i)));
+    }
+    p->req.data = p;
+    uv_queue_work(&main_loop.uv, &p->req, prefetch_work, prefetch_after);
+  }
+}
+
+static void prefetch_work(uv_work_t *req)
+{
+  PrefetchReq *p = req->data;
+  for (size_t i = 0; i < kv_size(p->fnames); i++) {
+    prefetch_file(kv_A(p->fnames, i));
+  }
+}
+
+static void prefetch_file(const char *fname)
+{
+  const int fd = os_open(fname, O_RDONLY, 0);
+  if (fd < 0) {
+    return;
+  }
+  TRACE_BEGIN("prefetch", fname);
+  char buf[16 * 1024];
+  bool eof = false;
+  // Plugin files are small, give up on anything unusually big.
+  for (size_t total = 0; !eof && total < 1024 * 1024; total += sizeof(buf)) {
+    if (os_read(fd, &eof, buf, sizeof(buf), false) < 0) {
+      break;
+    }
+  }
+  os_close(fd);
+  TRACE_END("prefetch");
+}
+
+static void prefetch_after(uv_work_t *req, int status)
+{
+  PrefetchReq *p = req->data;
+  for (size_t i = 0; i < kv_size(p->fnames); i++) {
+    xfree(kv_A(p->fnames, i));
+  }
+  kv_destroy(p->fnames);
+  xfree(p);
+}
+
 /// ":packadd[!] {name}"
 void ex_packadd(exarg_T *eap)
 {
@@ -2362,7 +2564,10 @@ theend:
 /// @param is_vimrc     DOSO_ value
 int do_source(char *fname, bool check_other, int is_vimrc, int *ret_sid)
 {
-  return do_source_ext(fname, check_other, is_vimrc, ret_sid, NULL, false, NULL);
+  TRACE_BEGIN("source", fname);
+  int retval = do_source_ext(fname, check_other, is_vimrc, ret_sid, NULL, false, NULL);
+  TRACE_END("source");
+  return retval;
 }
 
 /// Checks if the script with the given script ID is a Lua script.
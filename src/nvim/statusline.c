@@ -54,6 +54,19 @@
 // Determines how deeply nested %{} blocks will be evaluated in statusline.
 #define MAX_STL_EVAL_DEPTH 100
 
+// Number of compiled format strings kept around.
+#define STL_PROGRAM_CACHE_SIZE 16
+
+/// Program and instruction to continue with after a re-evaluated %{% %} block.
+typedef struct {
+  StlProgram *prog;
+  size_t pc;
+} StlFrame;
+
+/// Cache of compiled format strings, shared by all windows and options.
+static StlProgram *stl_programs[STL_PROGRAM_CACHE_SIZE];
+static uint64_t stl_program_tick = 0;
+
 /// Enumeration specifying the valid numeric bases that can
 /// be used when printing numbers in the status line.
 typedef enum {
@@ -818,6 +831,238 @@ int build_statuscol_str(win_T *wp, linenr_T lnum, linenr_T relnum, char *buf, st
   return width;
 }
 
+/// Add an instruction with text "len" bytes from "p" to "prog".
+static void stl_push_instr(StlProgram *prog, StlInstr instr, const char *p, size_t len)
+{
+  instr.text_off = kv_size(prog->texts);
+  instr.text_len = len;
+  kv_concat_len(prog->texts, p, len);
+  kv_push(prog->texts, NUL);
+  kv_push(prog->instrs, instr);
+}
+
+/// Compile the format string of "prog" into instructions.
+///
+/// Follows the same rules as the parsing that build_stl_str_hl() used to do
+/// for every redraw: literal text is collected with "%%" unescaped, item
+/// widths are parsed and the text of expressions, click functions and
+/// highlight names is stored NUL-terminated.
+static void stl_compile(StlProgram *prog)
+{
+  char *p = prog->fmt;
+  while (*p != NUL) {
+    if (*p != '%' || p[1] == '%') {
+      size_t off = kv_size(prog->texts);
+      while (*p != NUL && (*p != '%' || p[1] == '%')) {
+        if (*p == '%') {
+          p++;
+        }
+        kv_push(prog->texts, *p++);
+      }
+      kv_push(prog->texts, NUL);
+      kv_push(prog->instrs, ((StlInstr){ .kind = kStlInstrText, .text_off = off,
+                                         .text_len = kv_size(prog->texts) - off - 1 }));
+      continue;
+    }
+
+    // Skip over the `%` and ignore it at the end of the format string.
+    p++;
+    if (*p == NUL) {
+      break;
+    }
+
+    StlInstr instr = { .kind = kStlInstrItem, .maxwid = 9999 };
+
+    if (*p == STL_SEPARATE || *p == STL_TRUNCMARK || *p == ')') {
+      instr.kind = *p == STL_SEPARATE ? kStlInstrSeparate
+                   : *p == STL_TRUNCMARK ? kStlInstrTrunc : kStlInstrGroupEnd;
+      stl_push_instr(prog, instr, "", 0);
+      p++;
+      continue;
+    }
+
+    instr.zeropad = (*p == '0');
+    if (instr.zeropad) {
+      p++;
+    }
+    bool left_align = false;
+    if (*p == '-') {
+      p++;
+      left_align = true;
+    }
+    int minwid = 0;
+    if (ascii_isdigit(*p)) {
+      minwid = getdigits_int(&p, false, 0);
+    }
+
+    if (*p == STL_USER_HL) {
+      instr.kind = kStlInstrUserHl;
+      instr.minwid = minwid > 9 ? 1 : minwid;
+      stl_push_instr(prog, instr, "", 0);
+      p++;
+      continue;
+    }
+
+    if (*p == STL_TABPAGENR || *p == STL_TABCLOSENR) {
+      instr.kind = kStlInstrTabPage;
+      instr.opt = *p++;
+      instr.minwid = minwid;
+      stl_push_instr(prog, instr, "", 0);
+      continue;
+    }
+
+    if (*p == STL_CLICK_FUNC) {
+      char *t = ++p;
+      while (*p != STL_CLICK_FUNC && *p) {
+        p++;
+      }
+      if (*p != STL_CLICK_FUNC) {
+        break;
+      }
+      instr.kind = kStlInstrClickFunc;
+      instr.minwid = minwid;
+      stl_push_instr(prog, instr, t, (size_t)(p - t));
+      p++;
+      continue;
+    }
+
+    if (*p == '.') {
+      p++;
+      if (ascii_isdigit(*p)) {
+        instr.maxwid = getdigits_int(&p, false, 50);
+      }
+    }
+    instr.minwid = (minwid > 50 ? 50 : minwid) * (left_align ? -1 : 1);
+
+    if (*p == '(' || *p == '}') {
+      instr.kind = *p == '(' ? kStlInstrGroupStart : kStlInstrEvalEnd;
+      stl_push_instr(prog, instr, "", 0);
+      p++;
+      continue;
+    }
+
+    // An invalid item is skipped.
+    if (vim_strchr(STL_ALL, (uint8_t)(*p)) == NULL) {
+      if (*p == NUL) {  // can happen with "%0"
+        break;
+      }
+      p++;
+      continue;
+    }
+
+    instr.opt = *p++;
+
+    if (instr.opt == STL_HIGHLIGHT) {
+      // The name of the highlight is surrounded by `#`
+      char *t = p;
+      while (*p != '#' && *p != NUL) {
+        p++;
+      }
+      if (*p == '#') {
+        instr.kind = kStlInstrHighlight;
+        stl_push_instr(prog, instr, t, (size_t)(p - t));
+        p++;
+      }
+      continue;
+    }
+
+    if (instr.opt == STL_VIM_EXPR) {
+      instr.reevaluate = (*p == '%');
+      if (instr.reevaluate) {
+        p++;
+      }
+      char *t = p;
+      while ((*p != '}' || (instr.reevaluate && p[-1] != '%')) && *p != NUL) {
+        p++;
+      }
+      size_t len = (size_t)(p - t);
+      if (*p != '}') {
+        instr.opt = NUL;  // missing '}'
+      } else {
+        if (instr.reevaluate && len > 0) {
+          len--;  // remove the % at the end of %{% expr %}
+        }
+        p++;
+      }
+      stl_push_instr(prog, instr, t, len);
+      continue;
+    }
+
+    stl_push_instr(prog, instr, "", 0);
+  }
+}
+
+/// Get the compiled program for format string "fmt", compiling it when it is
+/// not in the cache. Must be released with stl_program_release().
+static StlProgram *stl_program_get(const char *fmt)
+{
+  size_t fmt_len = strlen(fmt);
+  int victim = 0;
+  stl_program_tick++;
+
+  for (int i = 0; i < STL_PROGRAM_CACHE_SIZE; i++) {
+    StlProgram *prog = stl_programs[i];
+    if (prog == NULL) {
+      victim = i;
+      continue;
+    }
+    if (prog->fmt_len == fmt_len && memcmp(prog->fmt, fmt, fmt_len) == 0) {
+      prog->refcount++;
+      prog->last_used = stl_program_tick;
+      return prog;
+    }
+    if (stl_programs[victim] != NULL && prog->last_used < stl_programs[victim]->last_used) {
+      victim = i;
+    }
+  }
+
+  StlProgram *old = stl_programs[victim];
+  if (old != NULL) {
+    old->cached = false;
+    if (old->refcount == 0) {
+      stl_program_free(old);
+    }
+  }
+
+  StlProgram *prog = xcalloc(1, sizeof(*prog));
+  prog->fmt = xmemdupz(fmt, fmt_len);
+  prog->fmt_len = fmt_len;
+  stl_compile(prog);
+  prog->refcount = 1;
+  prog->cached = true;
+  prog->last_used = stl_program_tick;
+  stl_programs[victim] = prog;
+  return prog;
+}
+
+static void stl_program_release(StlProgram *prog)
+{
+  prog->refcount--;
+  if (prog->refcount == 0 && !prog->cached) {
+    stl_program_free(prog);
+  }
+}
+
+static void stl_program_free(StlProgram *prog)
+{
+  xfree(prog->fmt);
+  kv_destroy(prog->instrs);
+  kv_destroy(prog->texts);
+  xfree(prog);
+}
+
+#if defined(EXITFREE)
+void free_stl_programs(void)
+{
+  for (int i = 0; i < STL_PROGRAM_CACHE_SIZE; i++) {
+    if (stl_programs[i] != NULL) {
+      stl_program_free(stl_programs[i]);
+      stl_programs[i] = NULL;
+    }
+  }
+}
+#endif
+
 /// Build a string from the status line items in "fmt".
 /// Return length of string in screen cells.
 ///
@@ -958,9 +1203,25 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
   //       so any user-visible characters must occur before here.
   char *out_end_p = (out + outlen) - 1;
 
-  // Proceed character by character through the statusline format string
-  // fmt_p is the current position in the input buffer
-  for (char *fmt_p = usefmt; *fmt_p != NUL;) {
+  // Run the compiled program of the format string. A re-evaluated %{% %}
+  // block runs as a separate program, "frames" holds the programs to return
+  // to when it is done.
+  StlProgram *prog = stl_program_get(usefmt);
+  size_t pc = 0;
+  kvec_t(StlFrame) frames = KV_INITIAL_VALUE;
+
+  while (true) {
+    if (pc == kv_size(prog->instrs)) {
+      if (kv_size(frames) == 0) {
+        break;
+      }
+      stl_program_release(prog);
+      StlFrame frame = kv_pop(frames);
+      prog = frame.prog;
+      pc = frame.pc;
+      continue;
+    }
+
     if (curitem == (int)stl_items_len) {
       size_t new_len = stl_items_len * 3 / 2;
 
@@ -974,44 +1235,25 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
       stl_items_len = new_len;
     }
 
-    if (*fmt_p != '%') {
-      prevchar_isflag = prevchar_isitem = false;
-    }
-
-    // Copy the formatting verbatim until we reach the end of the string
-    // or find a formatting item (denoted by `%`)
-    // or run out of room in our output buffer.
-    while (*fmt_p != NUL && *fmt_p != '%' && out_p < out_end_p) {
-      *out_p++ = *fmt_p++;
-    }
-
-    // If we have processed the entire format string or run out of
-    // room in our output buffer, exit the loop.
-    if (*fmt_p == NUL || out_p >= out_end_p) {
+    // If we have run out of room in our output buffer, exit the loop.
+    if (out_p >= out_end_p) {
       break;
     }
 
-    // The rest of this loop will handle a single `%` item.
-    // Note: We increment here to skip over the `%` character we are currently
-    //       on so we can process the item's contents.
-    fmt_p++;
+    StlInstr *instr = &kv_A(prog->instrs, pc++);
+    char *text = prog->texts.items + instr->text_off;
 
-    // Ignore `%` at the end of the format string
-    if (*fmt_p == NUL) {
-      break;
-    }
-
-    // Two `%` in a row is the escape sequence to print a
-    // single `%` in the output buffer.
-    if (*fmt_p == '%') {
-      *out_p++ = *fmt_p++;
+    switch (instr->kind) {
+    case kStlInstrText:
+      // Copy the pre-rendered text verbatim, as far as it fits.
       prevchar_isflag = prevchar_isitem = false;
+      for (size_t i = 0; i < instr->text_len && out_p < out_end_p; i++) {
+        *out_p++ = text[i];
+      }
       continue;
-    }
 
     // STL_SEPARATE: Separation between items, filled with white space.
-    if (*fmt_p == STL_SEPARATE) {
-      fmt_p++;
+    case kStlInstrSeparate:
       // Ignored when we are inside of a grouping
       if (groupdepth > 0) {
         continue;
@@ -1019,19 +1261,15 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
       stl_items[curitem].type = Separate;
       stl_items[curitem++].start = out_p;
       continue;
-    }
 
     // STL_TRUNCMARK: Where to begin truncating if the statusline is too long.
-    if (*fmt_p == STL_TRUNCMARK) {
-      fmt_p++;
+    case kStlInstrTrunc:
       stl_items[curitem].type = Trunc;
       stl_items[curitem++].start = out_p;
       continue;
-    }
 
     // The end of a grouping
-    if (*fmt_p == ')') {
-      fmt_p++;
+    case kStlInstrGroupEnd: {
       // Ignore if we are not actually inside a group currently
       if (groupdepth < 1) {
         continue;
@@ -1161,40 +1399,15 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
       }
       continue;
     }
-    int minwid = 0;
-    int maxwid = 9999;
-    int foldsignitem = -1;        // Start of fold or sign item
-    bool left_align_num = false;  // Number item for should be left-aligned
-    bool left_align = false;
-
-    // Denotes that numbers should be left-padded with zeros
-    bool zeropad = (*fmt_p == '0');
-    if (zeropad) {
-      fmt_p++;
-    }
-
-    // Denotes that the item should be left-aligned.
-    // This is tracked by using a negative length.
-    if (*fmt_p == '-') {
-      fmt_p++;
-      left_align = true;
-    }
-
-    // The first digit group is the item's min width
-    if (ascii_isdigit(*fmt_p)) {
-      minwid = getdigits_int(&fmt_p, false, 0);
-    }
 
     // User highlight groups override the min width field
     // to denote the styling to use.
-    if (*fmt_p == STL_USER_HL) {
+    case kStlInstrUserHl:
       stl_items[curitem].type = Highlight;
       stl_items[curitem].start = out_p;
-      stl_items[curitem].minwid = minwid > 9 ? 1 : minwid;
-      fmt_p++;
+      stl_items[curitem].minwid = instr->minwid;
       curitem++;
       continue;
-    }
 
     // TABPAGE pairs are used to denote a region that when clicked will
     // either switch to or close a tab.
@@ -1212,8 +1425,9 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
     //   Clicking on this region with mouse enabled will close tab 1.
     //
     // Note: These options are only valid when creating a tabline.
-    if (*fmt_p == STL_TABPAGENR || *fmt_p == STL_TABCLOSENR) {
-      if (*fmt_p == STL_TABCLOSENR) {
+    case kStlInstrTabPage: {
+      int minwid = instr->minwid;
+      if (instr->opt == STL_TABCLOSENR) {
         if (minwid == 0) {
           // %X ends the close label, go back to the previous tab label nr.
           for (int n = curitem - 1; n >= 0; n--) {
@@ -1230,73 +1444,59 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
       stl_items[curitem].type = TabPage;
       stl_items[curitem].start = out_p;
       stl_items[curitem].minwid = minwid;
-      fmt_p++;
       curitem++;
       continue;
     }
 
-    if (*fmt_p == STL_CLICK_FUNC) {
-      fmt_p++;
-      char *t = fmt_p;
-      while (*fmt_p != STL_CLICK_FUNC && *fmt_p) {
-        fmt_p++;
-      }
-      if (*fmt_p != STL_CLICK_FUNC) {
-        break;
-      }
+    case kStlInstrClickFunc:
       stl_items[curitem].type = ClickFunc;
       stl_items[curitem].start = out_p;
-      stl_items[curitem].cmd = tabtab ? xmemdupz(t, (size_t)(fmt_p - t)) : NULL;
-      stl_items[curitem].minwid = minwid;
-      fmt_p++;
+      stl_items[curitem].cmd = tabtab ? xmemdupz(text, instr->text_len) : NULL;
+      stl_items[curitem].minwid = instr->minwid;
       curitem++;
       continue;
-    }
-
-    // Denotes the end of the minwid
-    // the maxwid may follow immediately after
-    if (*fmt_p == '.') {
-      fmt_p++;
-      if (ascii_isdigit(*fmt_p)) {
-        maxwid = getdigits_int(&fmt_p, false, 50);
-      }
-    }
-
-    // Bound the minimum width at 50.
-    // Make the number negative to denote left alignment of the item
-    minwid = (minwid > 50 ? 50 : minwid) * (left_align ? -1 : 1);
 
     // Denotes the start of a new group
-    if (*fmt_p == '(') {
+    case kStlInstrGroupStart:
       stl_groupitems[groupdepth++] = curitem;
       stl_items[curitem].type = Group;
       stl_items[curitem].start = out_p;
-      stl_items[curitem].minwid = minwid;
-      stl_items[curitem].maxwid = maxwid;
-      fmt_p++;
+      stl_items[curitem].minwid = instr->minwid;
+      stl_items[curitem].maxwid = instr->maxwid;
       curitem++;
       continue;
-    }
 
     // Denotes end of expanded %{} block
-    if (*fmt_p == '}' && evaldepth > 0) {
-      fmt_p++;
-      evaldepth--;
+    case kStlInstrEvalEnd:
+      if (evaldepth > 0) {
+        evaldepth--;
+      }
       continue;
-    }
 
-    // An invalid item was specified.
-    // Continue processing on the next character of the format string.
-    if (vim_strchr(STL_ALL, (uint8_t)(*fmt_p)) == NULL) {
-      if (*fmt_p == NUL) {  // can happen with "%0"
-        break;
+    // Create a highlight item based on the name. Highlight groups are never
+    // removed, so the id is remembered once the group exists.
+    case kStlInstrHighlight:
+      if (instr->hl_id == 0) {
+        instr->hl_id = syn_name2id_len(text, instr->text_len);
       }
-      fmt_p++;
+      stl_items[curitem].type = Highlight;
+      stl_items[curitem].start = out_p;
+      stl_items[curitem].minwid = -instr->hl_id;
+      curitem++;
       continue;
+
+    case kStlInstrItem:
+      break;
     }
 
+    int minwid = instr->minwid;
+    int maxwid = instr->maxwid;
+    int foldsignitem = -1;        // Start of fold or sign item
+    bool left_align_num = false;  // Number item for should be left-aligned
+    bool zeropad = instr->zeropad;
+
     // The status line item type
-    char opt = *fmt_p++;
+    char opt = instr->opt;
 
     // OK - now for the real work
     NumberBase base = kNumBaseDecimal;
@@ -1325,36 +1525,17 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
         str = path_tail(NameBuff);
       }
       break;
-    case STL_VIM_EXPR:     // '{'
-    {
-      char *block_start = fmt_p - 1;
-      bool reevaluate = (*fmt_p == '%');
+    case NUL:
+      // An unterminated %{ item: its text is copied literally.
       itemisflag = true;
-
-      if (reevaluate) {
-        fmt_p++;
-      }
-
-      // Attempt to copy the expression to evaluate into
-      // the output buffer as a null-terminated string.
-      char *t = out_p;
-      while ((*fmt_p != '}' || (reevaluate && fmt_p[-1] != '%'))
-             && *fmt_p != NUL && out_p < out_end_p) {
-        *out_p++ = *fmt_p++;
-      }
-      if (*fmt_p != '}') {          // missing '}' or out of space
-        break;
-      }
-      fmt_p++;
-      if (reevaluate) {
-        out_p[-1] = 0;  // remove the % at the end of %{% expr %}
-      } else {
-        *out_p = 0;
+      for (size_t i = 0; i < instr->text_len && out_p < out_end_p; i++) {
+        *out_p++ = text[i];
       }
+      break;
 
-      // Move our position in the output buffer
-      // to the beginning of the expression
-      out_p = t;
+    case STL_VIM_EXPR:     // '{'
+    {
+      itemisflag = true;
 
       // { Evaluate the expression
 
@@ -1374,8 +1555,7 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
         VIsual_active = false;
       }
 
-      // Note: The result stored in `t` is unused.
-      str = eval_to_string_safe(out_p, use_sandbox, false);
+      str = eval_to_string_safe(text, use_sandbox, false);
 
       curwin = save_curwin;
       curbuf = save_curbuf;
@@ -1397,31 +1577,21 @@ int build_stl_str_hl(win_T *wp, char *out, size_t outlen, char *fmt, OptIndex op
         }
       }
 
-      // If the output of the expression needs to be evaluated
-      // replace the %{} block with the result of evaluation
-      if (reevaluate && str != NULL && *str != 0
+      // If the output of the expression needs to be evaluated, run the
+      // result as a format string in place of the %{} block.
+      if (instr->reevaluate && str != NULL && *str != 0
           && strchr(str, '%') != NULL
           && evaldepth < MAX_STL_EVAL_DEPTH) {
-        size_t parsed_usefmt = (size_t)(block_start - usefmt);
         size_t str_length = strlen(str);
-        size_t fmt_length = strlen(fmt_p);
-        size_t new_fmt_len = parsed_usefmt + str_length + fmt_length + 3;
-        char *new_fmt = xmalloc(new_fmt_len * sizeof(char));
-        char *new_fmt_p = new_fmt;
-
-        new_fmt_p = (char *)memcpy(new_fmt_p, usefmt, parsed_usefmt) + parsed_usefmt;
-        new_fmt_p = (char *)memcpy(new_fmt_p, str, str_length) + str_length;
-        new_fmt_p = (char *)memcpy(new_fmt_p, "%}", 2) + 2;
-        new_fmt_p = (char *)memcpy(new_fmt_p, fmt_p, fmt_length) + fmt_length;
-        *new_fmt_p = 0;
-        new_fmt_p = NULL;
-
-        if (usefmt != fmt) {
-          xfree(usefmt);
-        }
+        char *new_fmt = xmalloc(str_length + 3);
+        memcpy(new_fmt, str, str_length);
+        memcpy(new_fmt + str_length, "%}", 3);
         XFREE_CLEAR(str);
-        usefmt = new_fmt;
-        fmt_p = usefmt + parsed_usefmt;
+
+        kv_push(frames, ((StlFrame){ .prog = prog, .pc = pc }));
+        prog = stl_program_get(new_fmt);
+        pc = 0;
+        xfree(new_fmt);
         evaldepth++;
         continue;
       }
@@ -1664,25 +1834,6 @@ stcsign:
         str = ",+-"; break;
       }
       break;
-
-    case STL_HIGHLIGHT: {
-      // { The name of the highlight is surrounded by `#`
-      char *t = fmt_p;
-      while (*fmt_p != '#' && *fmt_p != NUL) {
-        fmt_p++;
-      }
-      // }
-
-      // Create a highlight item based on the name
-      if (*fmt_p == '#') {
-        stl_items[curitem].type = Highlight;
-        stl_items[curitem].start = out_p;
-        stl_items[curitem].minwid = -syn_name2id_len(t, (size_t)(fmt_p - t));
-        curitem++;
-        fmt_p++;
-      }
-      continue;
-    }
     }
 
     // If we made it this far, the item is normal and starts at
@@ -1886,6 +2037,12 @@ stcsign:
   int itemcnt = curitem - evalstart;
   curitem = evalstart;
 
+  stl_program_release(prog);
+  for (size_t i = 0; i < kv_size(frames); i++) {
+    stl_program_release(kv_A(frames, i).prog);
+  }
+  kv_destroy(frames);
+
   // Free the format buffer if we allocated it internally
   if (usefmt != fmt) {
     xfree(usefmt);
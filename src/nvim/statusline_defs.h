@@ -1,7 +1,10 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+#include "klib/kvec.h"
 #include "nvim/fold_defs.h"
 #include "nvim/sign_defs.h"
 
@@ -96,6 +99,46 @@ struct stl_item {
   } type;
 };
 
+/// Kind of instruction in a compiled 'statusline' format.
+typedef enum {
+  kStlInstrText,        ///< Literal text, with "%%" already unescaped.
+  kStlInstrSeparate,    ///< %= alignment separator.
+  kStlInstrTrunc,       ///< %< truncation mark.
+  kStlInstrGroupStart,  ///< %( start of a group.
+  kStlInstrGroupEnd,    ///< %) end of a group.
+  kStlInstrUserHl,      ///< %N* User highlight.
+  kStlInstrTabPage,     ///< %NT or %NX tab page label.
+  kStlInstrClickFunc,   ///< %@func@ click region.
+  kStlInstrHighlight,   ///< %#name# highlight.
+  kStlInstrEvalEnd,     ///< %} end of an expanded %{% %} block.
+  kStlInstrItem,        ///< Any other item, including %{expr}.
+} StlInstrKind;
+
+/// Single instruction of a compiled 'statusline' format.
+typedef struct {
+  StlInstrKind kind;
+  char opt;             ///< Item flag, NUL for an unterminated %{ item.
+  bool zeropad;         ///< Numbers are padded with zeros.
+  bool reevaluate;      ///< %{% expr %} item.
+  int minwid;           ///< Minimum width, negative when left-aligned.
+  int maxwid;           ///< Maximum width.
+  int hl_id;            ///< Resolved highlight id for %#name#, 0 if not resolved yet.
+  size_t text_off;      ///< Offset of the NUL-terminated text in "texts".
+  size_t text_len;      ///< Length of the text.
+} StlInstr;
+
+/// A 'statusline' format string compiled into a list of instructions, so
+/// that it does not need to be parsed again on every redraw.
+typedef struct {
+  char *fmt;                   ///< Format string the program was compiled from.
+  size_t fmt_len;              ///< Length of "fmt".
+  kvec_t(StlInstr) instrs;     ///< Instructions.
+  kvec_t(char) texts;          ///< Literal text, expressions and names.
+  int refcount;                ///< Number of running build_stl_str_hl() calls.
+  bool cached;                 ///< Program is still in the program cache.
+  uint64_t last_used;          ///< For evicting the least recently used program.
+} StlProgram;
+
 /// Struct to hold info for 'statuscolumn'
 typedef struct {
   int width;                           ///< width of the status column
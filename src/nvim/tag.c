@@ -20,6 +20,7 @@
 #include "nvim/drawscreen.h"
 #include "nvim/errors.h"
 #include "nvim/eval.h"
+#include "nvim/eval/gc.h"
 #include "nvim/eval/typval.h"
 #include "nvim/ex_cmds.h"
 #include "nvim/ex_cmds_defs.h"
@@ -1252,6 +1253,7 @@ static int find_tagfunc_tags(char *pat, garray_T *ga, int *match_count, int flag
   curwin->w_cursor = save_pos;  // restore the cursor position
   check_cursor(curwin);         // make sure cursor position is valid
   d->dv_refcount--;
+  gc_unref_count++;
 
   if (result == FAIL) {
     return FAIL;
@@ -0,0 +1,201 @@
+/// @file trace.c
+///
+/// Recording of nested spans of time (sourcing a script, running autocommands,
+/// redrawing, handling an RPC request, ...) in the Trace Event Format, which
+/// can be viewed with chrome://tracing or https://ui.perfetto.dev.
+/// See |--trace| and nvim__trace_start().
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <uv.h>
+
+#include "nvim/ascii_defs.h"
+#include "nvim/mbyte.h"
+#include "nvim/os/fs.h"
+#include "nvim/os/os.h"
+#include "nvim/os/time.h"
+#include "nvim/trace.h"
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "trace.c.generated.h"
+#endif
+
+/// Events of threads beyond this many are dropped.
+#define TRACE_MAX_THREADS 32
+
+/// Protects the state below, which is also used by worker threads.
+static uv_mutex_t trace_mutex;
+/// Id of the current thread in the trace, starting at 1 for the main thread.
+static uv_key_t trace_thread_key;
+static int trace_thread_count = 0;
+/// Number of open spans of each thread, indexed by the thread id minus one.
+static int trace_depth[TRACE_MAX_THREADS];
+
+static FILE *trace_fd = NULL;  ///< NULL when not tracing
+static uint64_t trace_start_time;
+static int64_t trace_pid;
+static bool trace_need_comma;
+
+void trace_init(void)
+{
+  uv_mutex_init(&trace_mutex);
+  uv_key_create(&trace_thread_key);
+  uv_mutex_lock(&trace_mutex);
+  trace_thread_id();  // the main thread gets id 1
+  uv_mutex_unlock(&trace_mutex);
+}
+
+/// Start writing events to "fname", stopping a trace that was running.
+///
+/// @return false if "fname" could not be opened.
+bool trace_start(const char *fname)
+{
+  FILE *fd = os_fopen(fname, "w");
+  if (fd == NULL) {
+    return false;
+  }
+  trace_stop();
+
+  uv_mutex_lock(&trace_mutex);
+  trace_fd = fd;
+  trace_start_time = os_hrtime();
+  trace_pid = os_get_pid();
+  trace_need_comma = false;
+  memset(trace_depth, 0, sizeof(trace_depth));
+  // The closing bracket is optional in this format, so whatever was written
+  // before a crash can still be loaded.
+  fputs("[\n", trace_fd);
+  for (int tid = 1; tid <= trace_thread_count; tid++) {
+    trace_write_thread_name(tid);
+  }
+  uv_mutex_unlock(&trace_mutex);
+
+  trace_set_enabled(true);
+  return true;
+}
+
+/// Stop tracing and close the trace file, if a trace is running.
+void trace_stop(void)
+{
+  trace_set_enabled(false);
+
+  uv_mutex_lock(&trace_mutex);
+  if (trace_fd != NULL) {
+    // End the spans which are still open, otherwise viewers drop them.
+    const uint64_t now = os_hrtime();
+    for (int tid = 1; tid <= trace_thread_count; tid++) {
+      for (; trace_depth[tid - 1] > 0; trace_depth[tid - 1]--) {
+        trace_write_event("", 'E', tid, now, NULL);
+      }
+    }
+    fputs("\n]\n", trace_fd);
+    fclose(trace_fd);
+    trace_fd = NULL;
+  }
+  uv_mutex_unlock(&trace_mutex);
+}
+
+/// Record the start of a span on the current thread.
+///
+/// @param name  Name of the span, a static string.
+/// @param detail  Shown with the span, or NULL.
+void trace_begin(const char *name, const char *detail)
+{
+  const uint64_t now = os_hrtime();
+  uv_mutex_lock(&trace_mutex);
+  const int tid = trace_thread_id();
+  if (trace_fd != NULL && tid > 0) {
+    trace_depth[tid - 1]++;
+    trace_write_event(name, 'B', tid, now, detail);
+  }
+  uv_mutex_unlock(&trace_mutex);
+}
+
+/// Record the end of the innermost open span on the current thread.
+///
+/// Ignored if the span started before the trace did.
+void trace_end(const char *name)
+{
+  const uint64_t now = os_hrtime();
+  uv_mutex_lock(&trace_mutex);
+  const int tid = trace_thread_id();
+  if (trace_fd != NULL && tid > 0 && trace_depth[tid - 1] > 0) {
+    trace_depth[tid - 1]--;
+    trace_write_event(name, 'E', tid, now, NULL);
+  }
+  uv_mutex_unlock(&trace_mutex);
+}
+
+static void trace_set_enabled(bool enabled)
+{
+#if defined(__clang__) || defined(__GNUC__)
+  __atomic_store_n(&trace_enabled, enabled, __ATOMIC_RELAXED);
+#else
+  *(volatile bool *)&trace_enabled = enabled;
+#endif
+}
+
+/// Get the id of the current thread, giving it the next free one on the first
+/// call on the thread.  Must be called with "trace_mutex" locked.
+///
+/// @return the thread id, or 0 if there are too many threads.
+static int trace_thread_id(void)
+{
+  intptr_t tid = (intptr_t)uv_key_get(&trace_thread_key);
+  if (tid == 0 && trace_thread_count < TRACE_MAX_THREADS) {
+    tid = ++trace_thread_count;
+    uv_key_set(&trace_thread_key, (void *)tid);
+    if (trace_fd != NULL) {
+      trace_write_thread_name((int)tid);
+    }
+  }
+  return (int)tid;
+}
+
+static void trace_write_thread_name(int tid)
+{
+  fprintf(trace_fd,
+          "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%" PRId64 ",\"tid\":%d,"
+          "\"args\":{\"name\":\"%s\"}}",
+          trace_need_comma ? ",\n" : "", trace_pid, tid, tid == 1 ? "main" : "worker");
+  trace_need_comma = true;
+}
+
+static void trace_write_event(const char *name, char ph, int tid, uint64_t time,
+                              const char *detail)
+{
+  // Timestamps are in microseconds.
+  const double ts = (double)(int64_t)(time - trace_start_time) / 1000.0;
+  fprintf(trace_fd, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%" PRId64 ",\"tid\":%d",
+          trace_need_comma ? ",\n" : "", name, ph, ts, trace_pid, tid);
+  trace_need_comma = true;
+  if (detail != NULL) {
+    fputs(",\"args\":{\"detail\":\"", trace_fd);
+    for (const char *p = detail; *p != NUL; p++) {
+      const uint8_t c = (uint8_t)(*p);
+      if (c == '"' || c == '\\') {
+        fprintf(trace_fd, "\\%c", c);
+      } else if (c < 0x20) {
+        fprintf(trace_fd, "\\u%04x", c);
+      } else if (c >= 0x80) {
+        // JSON must be valid UTF-8, a file name need not be.
+        const int len = utf_ptr2len(p);
+        const int ch = utf_ptr2char(p);
+        if (len > 1 && utf_char2len(ch) == len && ch <= 0x10FFFF
+            && (ch < 0xD800 || ch > 0xDFFF)) {
+          fwrite(p, 1, (size_t)len, trace_fd);
+          p += len - 1;
+        } else {
+          fputs("\\ufffd", trace_fd);
+        }
+      } else {
+        fputc(c, trace_fd);
+      }
+    }
+    fputs("\"}", trace_fd);
+  }
+  fputc('}', trace_fd);
+}
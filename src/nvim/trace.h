@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "nvim/macros_defs.h"
+
+/// Whether events are being recorded, see trace_start().
+///
+/// Worker threads read it too, use TRACE_ENABLED() to read it.
+EXTERN bool trace_enabled INIT( = false);
+
+#if defined(__clang__) || defined(__GNUC__)
+# define TRACE_ENABLED() __atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)
+#else
+# define TRACE_ENABLED() (*(volatile bool *)&trace_enabled)
+#endif
+
+/// Record the start of a span named "name" (a static string) on the current
+/// thread.  "detail" is an optional string (or NULL) shown with the span.
+#define TRACE_BEGIN(name, detail) do { \
+  if (TRACE_ENABLED()) trace_begin(name, detail); \
+} while (0)
+
+/// Record the end of the innermost span started with TRACE_BEGIN().
+#define TRACE_END(name) do { \
+  if (TRACE_ENABLED()) trace_end(name); \
+} while (0)
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "trace.h.generated.h"
+#endif
@@ -5236,6 +5236,8 @@ void win_free(win_T *wp, tabpage_T *tp)
   }
 
   xfree(wp->w_lines);
+  plines_cache_free(wp);
+  xfree(wp->w_fold_levels_fde);
 
   for (int i = 0; i < wp->w_tagstacklen; i++) {
     tagstack_clear_entry(&wp->w_tagstack[i]);
@@ -0,0 +1,53 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+describe('Lua API call performance', function()
+  before_each(function()
+    clear()
+    exec_lua(function()
+      local lines = {}
+      for i = 1, 100 do
+        lines[i] = ('line %d with some text'):format(i)
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    end)
+  end)
+
+  --- Prints the number of calls per second of {call}, Lua code run with `i` set to the
+  --- iteration number.
+  --- @param call string
+  local function bench(call)
+    local calls_per_sec = exec_lua(function(N)
+      local f = assert(loadstring('local i = ...; ' .. call))
+      f(1) -- warm up
+      local start = vim.uv.hrtime()
+      for i = 1, N do
+        f(i)
+      end
+      return N / ((vim.uv.hrtime() - start) / 1e9)
+    end, 100000)
+    print(('%-60s %12.0f calls/s'):format(call, calls_per_sec))
+  end
+
+  it('nvim_win_get_cursor', function()
+    bench('vim.api.nvim_win_get_cursor(0)')
+  end)
+
+  it('nvim_buf_get_lines', function()
+    bench('vim.api.nvim_buf_get_lines(0, i % 100, i % 100 + 1, true)')
+    bench('vim.api.nvim_buf_get_lines(0, 0, -1, true)')
+  end)
+
+  it('nvim_buf_set_extmark', function()
+    exec_lua(function()
+      _G.ns = vim.api.nvim_create_namespace('bench')
+    end)
+    bench('vim.api.nvim_buf_set_extmark(0, ns, i % 100, 0, { id = 1 })')
+    bench(
+      'vim.api.nvim_buf_set_extmark(0, ns, i % 100, 0, '
+        .. "{ id = 1, hl_group = 'Comment', virt_text = { { 'virtual', 'Comment' } } })"
+    )
+  end)
+end)
@@ -99,6 +99,62 @@ describe('decor perf', function()
     print('\nTotal ' .. fmt(total) .. '\nDecoration provider: ' .. fmt(provider))
   end)
 
+  it('can handle 10k highlights on one line', function()
+    Screen.new(100, 101)
+
+    local result = exec_lua(function()
+      local text = ('abcdefghijklmnopqrstuvwxyz0123'):rep(334)
+      local line_len = #text
+      vim.api.nvim_buf_set_lines(0, 0, 0, false, { text })
+      vim.api.nvim_win_set_cursor(0, { 1, 0 })
+
+      local ns = vim.api.nvim_create_namespace('decor_spec.lua')
+      local groups = { 'Comment', 'Keyword', 'String', 'Function', 'Label' }
+
+      -- 5000 nested ranges, like the nodes of a deeply nested syntax tree,
+      -- and 5000 short ranges, like semantic tokens.
+      for i = 0, 4999 do
+        vim.api.nvim_buf_set_extmark(0, ns, 0, i, {
+          end_col = line_len - i,
+          hl_group = groups[i % #groups + 1],
+          priority = 100,
+        })
+      end
+      for i = 0, 4999 do
+        local col = i * 2
+        vim.api.nvim_buf_set_extmark(0, ns, 0, col, {
+          end_col = col + 1,
+          hl_group = groups[(i + 2) % #groups + 1],
+          priority = 200 + i % 3,
+        })
+      end
+
+      local total = {}
+      for _ = 1, 20 do
+        local tic = vim.uv.hrtime()
+        vim.cmd 'redraw!'
+        local toc = vim.uv.hrtime()
+        table.insert(total, toc - tic)
+      end
+
+      return { total }
+    end)
+
+    local total = unpack(result)
+    table.sort(total)
+
+    local ms = 1 / 1000000
+    local res = string.format(
+      'min, 25%%, median, 75%%, max:\n\t%0.1fms,\t%0.1fms,\t%0.1fms,\t%0.1fms,\t%0.1fms',
+      total[1] * ms,
+      total[1 + math.floor(#total * 0.25)] * ms,
+      total[1 + math.floor(#total * 0.5)] * ms,
+      total[1 + math.floor(#total * 0.75)] * ms,
+      total[#total] * ms
+    )
+    print('\nTotal ' .. res)
+  end)
+
   it('can handle full screen of highlighting', function()
     Screen.new(100, 51)
 
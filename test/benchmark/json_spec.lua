@@ -0,0 +1,101 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+describe('JSON encode/decode performance', function()
+  before_each(function()
+    clear()
+    exec_lua(function()
+      -- A completion response: many small objects with short strings.
+      local items = {}
+      for i = 1, 2000 do
+        items[i] = {
+          label = ('completion_item_%d'):format(i),
+          kind = i % 25 + 1,
+          detail = ('fun(a: integer, b: string): table<string, item_%d>'):format(i),
+          documentation = {
+            kind = 'markdown',
+            value = ('```lua\nfunction item_%d(a, b)\n```\n\nReturns the "item" for `a` and `b`.'):format(
+              i
+            ),
+          },
+          sortText = ('%05d'):format(i),
+          textEdit = {
+            newText = ('completion_item_%d'):format(i),
+            range = {
+              start = { line = i, character = 4 },
+              ['end'] = { line = i, character = 10 },
+            },
+          },
+        }
+      end
+      _G.completion = {
+        jsonrpc = '2.0',
+        id = 1,
+        result = { isIncomplete = false, items = items },
+      }
+
+      -- A didOpen notification: one long string with a few escapes per line.
+      local lines = {}
+      for i = 1, 20000 do
+        lines[i] = ('    local value_%d = compute("argument", %d) -- comment about the value'):format(
+          i,
+          i
+        )
+      end
+      _G.did_open = {
+        jsonrpc = '2.0',
+        method = 'textDocument/didOpen',
+        params = {
+          textDocument = {
+            uri = 'file:///tmp/file.lua',
+            languageId = 'lua',
+            version = 0,
+            text = table.concat(lines, '\n'),
+          },
+        },
+      }
+    end)
+  end)
+
+  --- Prints the time {f} takes to encode {payload} or decode its JSON.
+  --- @param payload string
+  --- @param f string
+  local function bench(payload, f)
+    local ms = exec_lua(function(N)
+      local obj = _G[payload]
+      local fns = {
+        ['json_encode()'] = function()
+          return vim.fn.json_encode(obj)
+        end,
+        ['json_decode()'] = function(s)
+          return vim.fn.json_decode(s)
+        end,
+        ['vim.json.encode()'] = function()
+          return vim.json.encode(obj)
+        end,
+        ['vim.json.decode()'] = function(s)
+          return vim.json.decode(s)
+        end,
+      }
+      local fn = fns[f]
+      local str = vim.json.encode(obj)
+      fn(str) -- warm up
+      local start = vim.uv.hrtime()
+      for _ = 1, N do
+        fn(str)
+      end
+      return (vim.uv.hrtime() - start) / 1e6 / N
+    end, 10)
+    print(('%-20s %-12s %8.2f ms'):format(f, payload, ms))
+  end
+
+  for _, payload in ipairs({ 'completion', 'did_open' }) do
+    for _, f in ipairs({ 'json_encode()', 'json_decode()', 'vim.json.encode()', 'vim.json.decode()' }) do
+      it(('%s %s'):format(f, payload), function()
+        bench(payload, f)
+      end)
+    end
+  end
+end)
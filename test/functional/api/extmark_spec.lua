@@ -1884,6 +1884,73 @@ describe('API/extmarks', function()
       },
     }
   end)
+
+  it('nvim_buf_set_extmarks() creates many marks at once', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'abcdef', 'ghijkl' })
+    eq(1, set_extmark(ns, 0, 0, 1))
+    eq(
+      { 2, 3, 4 },
+      api.nvim_buf_set_extmarks(0, ns, { 1, 2, 1, 4, 0, 3, -1, -1, 0, 0, 1, -1 }, {
+        hl_group = { 'String', 'Comment', '' },
+        priority = { 10, 20, 30 },
+      })
+    )
+    eq({
+      {
+        4,
+        0,
+        0,
+        { ns_id = ns, end_row = 1, end_col = 0, right_gravity = true, end_right_gravity = false },
+      },
+      { 1, 0, 1, { ns_id = ns, right_gravity = true } },
+      {
+        3,
+        0,
+        3,
+        { ns_id = ns, hl_group = 'Comment', hl_eol = false, priority = 20, right_gravity = true },
+      },
+      {
+        2,
+        1,
+        2,
+        {
+          ns_id = ns,
+          end_row = 1,
+          end_col = 4,
+          hl_group = 'String',
+          hl_eol = false,
+          priority = 10,
+          right_gravity = true,
+          end_right_gravity = false,
+        },
+      },
+    }, get_extmarks(ns, 0, -1, { details = true }))
+
+    eq(
+      "Invalid 'pos': expected row, col, end_row, end_col for each mark",
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { 0, 0, 0 }, {})
+    )
+    eq(
+      "Invalid 'hl_group': expected one item per mark",
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { 0, 0, -1, -1 }, {
+        hl_group = { 'String', 'Comment' },
+      })
+    )
+    -- nothing is created when any of the marks is invalid
+    eq(
+      "Invalid 'col': out of range",
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { 0, 1, -1, -1, 0, 10, -1, -1 }, {})
+    )
+    eq(
+      'cannot set end_right_gravity without end_row or end_col',
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { 0, 1, 0, 2, 0, 3, -1, -1 }, {
+        end_right_gravity = true,
+      })
+    )
+    eq(4, #get_extmarks(ns, 0, -1))
+    eq({ 5 }, api.nvim_buf_set_extmarks(0, ns, { 0, 10, -1, -1 }, { strict = false }))
+    eq({ 0, 6 }, get_extmark_by_id(ns, 5))
+  end)
 end)
 
 describe('Extmarks buffer api with many marks', function()
@@ -4063,6 +4063,28 @@ describe('API', function()
       eq({ str = '<3456', width = 5 }, api.nvim_eval_statusline('%S', { maxwidth = 5 }))
     end)
 
+    it('re-evaluates items when the same format is used again', function()
+      local fmt = '[%{g:n}]%%%{% g:n > 1 ? "%-3{g:n}|" : "-" %}%(%{g:n}%)'
+      command('let g:n = 1')
+      eq({ str = '[1]%-1', width = 6 }, api.nvim_eval_statusline(fmt, {}))
+      command('let g:n = 20')
+      eq({ str = '[20]%20 |20', width = 11 }, api.nvim_eval_statusline(fmt, {}))
+      command('let g:n = 1')
+      eq({ str = '[1]%-1', width = 6 }, api.nvim_eval_statusline(fmt, {}))
+
+      local hl_fmt = '%#StlReusedGroup#x'
+      local res = api.nvim_eval_statusline(hl_fmt, { highlights = true })
+      eq('StatusLine', res.highlights[1].group)
+      command('highlight StlReusedGroup guifg=Red')
+      res = api.nvim_eval_statusline(hl_fmt, { highlights = true })
+      eq('StlReusedGroup', res.highlights[1].group)
+    end)
+
+    it('copies the text of an unterminated %{ item', function()
+      eq({ str = 'abcx', width = 4 }, api.nvim_eval_statusline('abc%{x', {}))
+      eq({ str = 'a,b', width = 3 }, api.nvim_eval_statusline('%{"a"}%{",b"}%{', {}))
+    end)
+
     describe('highlight parsing', function()
       it('works', function()
         eq(
@@ -1338,6 +1338,53 @@ describe('API/win', function()
       )
     end)
 
+    it('with many wrapped lines', function()
+      screen:try_resize(45, 10)
+      exec([[
+        call setline(1, repeat(['foo', repeat('foobar-', 20)], 200))
+      ]])
+      eq({ all = 1000, fill = 0, end_row = 399, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      eq(
+        { all = 505, fill = 0, end_row = 201, end_vcol = 45 },
+        api.nvim_win_text_height(0, { max_height = 502 })
+      )
+      eq(
+        { all = 500, fill = 0, end_row = 399, end_vcol = 140 },
+        api.nvim_win_text_height(0, { start_row = 200 })
+      )
+      -- Cached heights are updated when lines are inserted or changed.
+      exec([[call append(0, ['', '', ''])]])
+      eq({ all = 1003, fill = 0, end_row = 402, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      api.nvim_buf_set_lines(0, 8, 9, true, { 'x' })
+      eq({ all = 1000, fill = 0, end_row = 402, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      exec('1,3delete')
+      eq({ all = 997, fill = 0, end_row = 399, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      exec('undo')
+      eq({ all = 1000, fill = 0, end_row = 402, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      exec('redo')
+      eq({ all = 997, fill = 0, end_row = 399, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      -- Scrolling uses the same heights.
+      exec('normal! Gzb')
+      local top = fn.line('w0')
+      eq(true, api.nvim_win_text_height(0, { start_row = top - 1 }).all <= fn.winheight(0))
+      eq(true, api.nvim_win_text_height(0, { start_row = top - 2 }).all > fn.winheight(0))
+      api.nvim_buf_set_extmark(0, ns, 300, 0, { virt_lines = { { { 'VIRT1' } }, { { 'VIRT2' } } } })
+      eq({ all = 999, fill = 2, end_row = 399, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      api.nvim_buf_set_extmark(
+        0,
+        ns,
+        351,
+        5,
+        { virt_text = { { ('?'):rep(45) } }, virt_text_pos = 'inline' }
+      )
+      eq({ all = 1000, fill = 2, end_row = 399, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      -- And when options change.
+      command('set nowrap')
+      eq({ all = 402, fill = 2, end_row = 399, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+      command('set wrap number numberwidth=20')
+      eq({ all = 1399, fill = 2, end_row = 399, end_vcol = 140 }, api.nvim_win_text_height(0, {}))
+    end)
+
     it('with virtual lines around a fold', function()
       screen:try_resize(45, 10)
       exec([[
@@ -1384,6 +1384,42 @@ describe('runtime:', function()
     eq({ 'unos', 'dos' }, exec_lua 'return _G.lista')
   end)
 
+  it('sources plugin files in order', function()
+    local rtp_folder = table.concat({ xconfig, 'nvim' }, pathsep)
+    local plugin_folder_path = table.concat({ rtp_folder, 'plugin' }, pathsep)
+    local sub_folder_path = table.concat({ plugin_folder_path, 'sub' }, pathsep)
+    local after_folder_path = table.concat({ rtp_folder, 'after', 'plugin' }, pathsep)
+    mkdir_p(sub_folder_path)
+    mkdir_p(after_folder_path)
+    finally(function()
+      rmdir(plugin_folder_path)
+      rmdir(table.concat({ rtp_folder, 'after' }, pathsep))
+    end)
+    local files = {
+      { plugin_folder_path, 'a.lua' },
+      { plugin_folder_path, 'a.vim' },
+      { plugin_folder_path, 'b.vim' },
+      { plugin_folder_path, 'c.txt' },
+      { sub_folder_path, 'd.lua' },
+      { sub_folder_path, 'e.vim' },
+      { after_folder_path, 'f.lua' },
+      { after_folder_path, 'g.vim' },
+    }
+    for _, f in ipairs(files) do
+      local line = vim.endswith(f[2], '.vim') and 'lua table.insert(_G.order, %q)'
+        or 'table.insert(_G.order, %q)'
+      write_file(table.concat(f, pathsep), line:format(f[2]))
+    end
+
+    clear { args_rm = { '-u' }, args = { '--cmd', 'lua _G.order = {}' }, env = xenv }
+
+    -- In each directory of 'runtimepath' the .vim files come before the .lua files.
+    eq(
+      { 'a.vim', 'b.vim', 'e.vim', 'a.lua', 'd.lua', 'g.vim', 'f.lua' },
+      exec_lua('return _G.order')
+    )
+  end)
+
   it('no crash setting &rtp in plugins with :packloadall called before #18315', function()
     local plugin_folder_path = table.concat({ xconfig, 'nvim', 'plugin' }, pathsep)
     mkdir_p(plugin_folder_path)
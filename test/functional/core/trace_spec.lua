@@ -0,0 +1,111 @@
+local t = require('test.testutil')
+local n = require('test.functional.testnvim')()
+local Screen = require('test.functional.ui.screen')
+
+local api = n.api
+local clear = n.clear
+local command = n.command
+local eq = t.eq
+local exec_lua = n.exec_lua
+local expect_exit = n.expect_exit
+local matches = t.matches
+local pcall_err = t.pcall_err
+local read_file = t.read_file
+local retry = t.retry
+local write_file = t.write_file
+
+describe('trace', function()
+  local tracefile = 'Xtest_trace.json'
+  local script = 'Xtest_trace.vim'
+
+  before_each(function()
+    write_file(script, 'let g:sourced = 1\n')
+  end)
+
+  after_each(function()
+    os.remove(tracefile)
+    os.remove(script)
+  end)
+
+  --- Reads the trace, checks that the spans of every thread are balanced and
+  --- returns the details of the spans by name.
+  --- @return table<string,string[]>
+  local function read_trace()
+    local events = vim.json.decode(read_file(tracefile))
+    local spans = {} --- @type table<string,string[]>
+    local depth = {} --- @type table<integer,integer>
+    for _, e in ipairs(events) do
+      if e.ph == 'B' then
+        depth[e.tid] = (depth[e.tid] or 0) + 1
+        spans[e.name] = spans[e.name] or {}
+        table.insert(spans[e.name], e.args and e.args.detail or '')
+      elseif e.ph == 'E' then
+        depth[e.tid] = depth[e.tid] - 1
+        assert(depth[e.tid] >= 0, 'unbalanced span end')
+      end
+    end
+    for tid, d in pairs(depth) do
+      eq(0, d, ('open spans on thread %d'):format(tid))
+    end
+    return spans
+  end
+
+  it('records events with nvim__trace_start()', function()
+    clear()
+    Screen.new(40, 5)
+    api.nvim__trace_start(tracefile)
+    command('source ' .. script)
+    exec_lua(function()
+      local ns = vim.api.nvim_create_namespace('test_trace')
+      vim.api.nvim_set_decoration_provider(ns, { on_win = function() end })
+      vim.api.nvim_create_autocmd('User', { pattern = 'TestTrace', callback = function() end })
+    end)
+    command('doautocmd User TestTrace')
+    command('redraw!')
+    api.nvim__trace_stop()
+
+    local spans = read_trace()
+    eq({ script }, spans.source)
+    eq({ 'User' }, spans.autocmd)
+    matches('^on_win %(ns=test_trace%)$', spans.decor_provider[1])
+    assert(spans.lua_callback)
+    assert(spans.update_screen)
+    assert(spans.win_update)
+    assert(spans.win_line)
+    assert(vim.tbl_contains(spans.rpc_request, 'nvim_command'))
+
+    -- Events after stopping are not recorded.
+    command('source ' .. script)
+    eq({ script }, read_trace().source)
+  end)
+
+  it('--trace records startup', function()
+    clear({ args = { '--trace', tracefile, '--cmd', 'source ' .. script } })
+    expect_exit(command, 'qall!')
+    retry(nil, nil, function()
+      eq(true, vim.tbl_contains(read_trace().source, script))
+    end)
+  end)
+
+  it('escapes invalid UTF-8 in details', function()
+    t.skip(t.is_os('win'), 'file names must be valid UTF-16 on Windows')
+    local badscript = 'Xtest_trace_\255é.vim'
+    write_file(badscript, 'let g:sourced = 1\n')
+    finally(function()
+      os.remove(badscript)
+    end)
+    clear()
+    api.nvim__trace_start(tracefile)
+    command('source ' .. badscript)
+    api.nvim__trace_stop()
+    eq({ 'Xtest_trace_\u{fffd}é.vim' }, read_trace().source)
+  end)
+
+  it('nvim__trace_start() fails for a file which cannot be written', function()
+    clear()
+    matches(
+      'Failed to open trace file: Xtest_trace_nonexistent/trace.json',
+      pcall_err(api.nvim__trace_start, 'Xtest_trace_nonexistent/trace.json')
+    )
+  end)
+end)
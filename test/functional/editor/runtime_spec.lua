@@ -424,6 +424,20 @@ describe('runtime:', function()
     eq(sid, api.nvim_get_option_info2('mouse', {}).last_set_sid)
   end)
 
+  it('finds files in a directory created after searching the entry', function()
+    -- Searching lists the names in the entry, which is reused until its mtime
+    -- changes. Make it old, as recently modified directories are listed again.
+    assert(vim.uv.fs_utime(plug_dir, 1000000000, 1000000000))
+    exec('let g:seq = ""')
+    exec('runtime! plugin/new_plugin.vim')
+    eq('', eval('g:seq'))
+
+    mkdir_p(table.concat({ plug_dir, 'plugin' }, sep))
+    write_file(table.concat({ plug_dir, 'plugin', 'new_plugin.vim' }, sep), [[let g:seq ..= 'A']])
+    exec('runtime! plugin/new_plugin.vim')
+    eq('A', eval('g:seq'))
+  end)
+
   it('cpp ftplugin loads c ftplugin #29053', function()
     eq('', eval('&commentstring'))
     eq('', eval('&omnifunc'))
@@ -1,6 +1,7 @@
 local t = require('test.testutil')
 local n = require('test.functional.testnvim')()
 
+local assert_alive = n.assert_alive
 local clear = n.clear
 local exec_lua = n.exec_lua
 local eq = t.eq
@@ -202,6 +203,26 @@ describe('vim.json.encode()', function()
     eq('"þÿþ"', exec_lua([[return vim.json.encode('þÿþ')]]))
   end)
 
+  it('dumps and parses long strings with special characters anywhere', function()
+    local plain = ('abcdefghij'):rep(5)
+    local escaped = {
+      ['"'] = '\\"',
+      ['\\'] = '\\\\',
+      ['\n'] = '\\n',
+      ['\27'] = '\\u001b',
+      ['\127'] = '\\u007f',
+      ['ફ'] = 'ફ',
+    }
+    for special, json in pairs(escaped) do
+      for _, i in ipairs({ 0, 7, 8, 15, 16, 17, 31, 32, 33, 50 }) do
+        local str = plain:sub(1, i) .. special .. plain:sub(i + 1)
+        local encoded = '"' .. plain:sub(1, i) .. json .. plain:sub(i + 1) .. '"'
+        eq(encoded, exec_lua('return vim.json.encode(...)', str))
+        eq(str, exec_lua('return vim.json.decode(...)', encoded))
+      end
+    end
+  end)
+
   it('dumps numbers', function()
     eq('0', exec_lua([[return vim.json.encode(0)]]))
     eq('10', exec_lua([[return vim.json.encode(10)]]))
@@ -232,3 +253,94 @@ describe('vim.json.encode()', function()
     eq('null', exec_lua([[return vim.json.encode(vim.NIL)]]))
   end)
 end)
+
+describe('vim._jsonrpc_reader()', function()
+  before_each(function()
+    clear()
+  end)
+
+  it('splits and decodes messages in order', function()
+    local result = exec_lua(function()
+      local msgs = {
+        { id = 1, result = { 'a', 'b' } },
+        -- big enough to be decoded on a worker thread
+        { id = 2, result = { data = ('x'):rep(200000), list = vim.fn.range(10000) } },
+        { id = 3, method = 'foo', params = { text = 'é\n"' } },
+        { id = 4, result = {} },
+      }
+      local stream = {} --- @type string[]
+      for _, msg in ipairs(msgs) do
+        local body = vim.json.encode(msg)
+        stream[#stream + 1] = ('Content-Length: %d\r\n\r\n%s'):format(#body, body)
+      end
+      local data = table.concat(stream)
+
+      local received = {} --- @type any[]
+      local done = false
+      local reader = vim._jsonrpc_reader(function(decoded, err)
+        assert(not err, err)
+        received[#received + 1] = decoded
+      end, { luanil = { object = true } })
+      -- feed in uneven chunks, cutting headers and bodies
+      local pos = 1
+      local size = 1
+      while pos <= #data do
+        reader:feed(data:sub(pos, pos + size - 1))
+        pos = pos + size
+        size = size * 3
+      end
+      reader:finish(function()
+        done = true
+      end)
+      vim.wait(10000, function()
+        return done
+      end)
+
+      local ok = #received == #msgs
+      for i, msg in ipairs(msgs) do
+        local expected = vim.json.decode(vim.json.encode(msg), { luanil = { object = true } })
+        ok = ok and vim.deep_equal(expected, received[i])
+      end
+      return { done, ok, #received }
+    end)
+    eq({ true, true, 4 }, result)
+  end)
+
+  it('reports invalid messages and continues', function()
+    eq(
+      {
+        { false, 'Expected object key string but found invalid token at character 2' },
+        { false, 'Content-Length not found in header: Foo: 1\r\n\r\n' },
+        { { 1 }, false },
+      },
+      exec_lua(function()
+        local received = {} --- @type any[]
+        local reader = vim._jsonrpc_reader(function(decoded, err)
+          received[#received + 1] = { decoded or false, err or false }
+        end)
+        reader:feed('Content-Length: 3\r\n\r\n{x}Foo: 1\r\n\r\ncontent-length : 3 \r\n\r\n[1]')
+        return received
+      end)
+    )
+  end)
+
+  it('rejects a Content-Length which is too large', function()
+    eq(
+      {
+        { false, 'Content-Length too large: 99999999999' },
+        { { 1 }, false },
+      },
+      exec_lua(function()
+        local received = {} --- @type any[]
+        local reader = vim._jsonrpc_reader(function(decoded, err)
+          received[#received + 1] = { decoded or false, err or false }
+        end)
+        reader:feed('Content-Length: 99999999999\r\n\r\nContent-Length: 3\r\n\r\n[1]')
+        -- a big body which has not arrived yet is not allocated up front
+        reader:feed('Content-Length: 1000000000\r\n\r\n[')
+        return received
+      end)
+    )
+    assert_alive()
+  end)
+end)
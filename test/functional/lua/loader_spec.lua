@@ -73,6 +73,112 @@ describe('vim.loader', function()
     )
   end)
 
+  it('stores the bytecode of all files in one pack file', function()
+    local tmp1 = t.tmpname()
+    local tmp2 = t.tmpname()
+    t.write_file(tmp1, 'return 1', true)
+    t.write_file(tmp2, 'return 2', true)
+
+    exec_lua(function()
+      vim.loader.enable()
+      assert(loadfile(tmp1))
+      assert(loadfile(tmp2))
+    end)
+
+    -- A new session finds both in the pack written by the previous one.
+    clear()
+    eq(
+      { true, true, 1, 2 },
+      exec_lua(function()
+        vim.loader.enable()
+        local f = assert(io.open(vim.loader.path .. '/pack', 'rb'))
+        local pack = f:read('*a')
+        f:close()
+        return {
+          pack:find(tmp1 .. '\0', 1, true) ~= nil,
+          pack:find(tmp2 .. '\0', 1, true) ~= nil,
+          loadfile(tmp1)(),
+          loadfile(tmp2)(),
+        }
+      end)
+    )
+  end)
+
+  it('removes old cache files and ignores records after a second pack header', function()
+    local tmp1 = t.tmpname()
+    local tmp2 = t.tmpname()
+    t.write_file(tmp1, 'return 1', true)
+    t.write_file(tmp2, 'return 2', true)
+
+    eq(
+      false,
+      exec_lua(function()
+        local path = vim.loader.path
+        vim.fn.mkdir(path, 'p')
+        vim.fn.delete(path .. '/pack')
+        -- A cache file of a version before the pack file.
+        vim.fn.writefile({}, path .. '/%2ftmp%2fold.luac')
+        vim.loader.enable()
+        assert(loadfile(tmp1))
+        return vim.uv.fs_stat(path .. '/%2ftmp%2fold.luac') ~= nil
+      end)
+    )
+
+    -- Another instance appended a pack header of its own after the first record.
+    exec_lua(function()
+      local f = assert(io.open(vim.loader.path .. '/pack', 'rb'))
+      local pack = f:read('*a')
+      f:close()
+      local header = pack:match('^[^\n]*\n')
+      f = assert(io.open(vim.loader.path .. '/pack', 'ab'))
+      f:write(header .. tmp2 .. '\0garbage')
+      f:close()
+    end)
+
+    clear()
+    eq(
+      { 1, 2, false },
+      exec_lua(function()
+        vim.loader.enable()
+        local ret = { loadfile(tmp1)(), loadfile(tmp2)() }
+        -- The pack was rewritten without the second header.
+        local f = assert(io.open(vim.loader.path .. '/pack', 'rb'))
+        local pack = f:read('*a')
+        f:close()
+        local header = pack:match('^[^\n]*\n')
+        ret[3] = pack:find(header, 2, true) ~= nil
+        return ret
+      end)
+    )
+  end)
+
+  it('loads files when the pack cannot be rewritten', function()
+    local tmp1 = t.tmpname()
+    local tmp2 = t.tmpname()
+    t.write_file(tmp1, 'return 1', true)
+    t.write_file(tmp2, 'return 2', true)
+
+    eq(
+      { 1, 2, 1, 'garbage' },
+      exec_lua(function()
+        local path = vim.loader.path
+        vim.fn.mkdir(path, 'p')
+        vim.fn.writefile({ 'garbage' }, path .. '/pack', 'b')
+        -- The temporary file of the compaction cannot be created.
+        local tmpname = ('%s/pack.%d'):format(path, vim.uv.os_getpid())
+        vim.fn.mkdir(tmpname, 'p')
+        vim.loader.enable()
+        local ret = { loadfile(tmp1)(), loadfile(tmp2)(), loadfile(tmp1)() }
+        local f = assert(io.open(path .. '/pack', 'rb'))
+        ret[4] = f:read('*a')
+        f:close()
+        vim.fn.delete(tmpname, 'd')
+        vim.fn.delete(path .. '/pack')
+        return ret
+      end)
+    )
+  end)
+
   it('handles % signs in modpath #24491', function()
     exec_lua [[
       vim.loader.enable()
@@ -577,6 +577,45 @@ describe('lua stdlib', function()
     )
   end)
 
+  it('vim.buf_lines', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'foo', 'bar\0baz', '', 'foobar' })
+
+    eq(4, exec_lua('return #vim.buf_lines(0)'))
+    eq('bar\0baz', exec_lua('return vim.buf_lines(0)[2]'))
+    eq(nil, exec_lua('return vim.buf_lines(0)[5]'))
+    eq(
+      { 'foo', 'bar\0baz', '', 'foobar' },
+      exec_lua(function()
+        local lines = {}
+        for i, line in vim.buf_lines(0):iter() do
+          lines[i] = line
+        end
+        return lines
+      end)
+    )
+    eq(
+      { 2, 'bar\0baz', '' },
+      exec_lua(function()
+        local view = vim.buf_lines(0, 1, -2)
+        return { #view, view[1], view[2] }
+      end)
+    )
+    eq(0, exec_lua('return #vim.buf_lines(0, 10)'))
+
+    eq({ 4, 1, 3 }, exec_lua('return { vim.buf_lines(0):find("foo", 2) }'))
+    eq({ 2, 3, 5 }, exec_lua('return { vim.buf_lines(0):find("r\\0b") }'))
+    eq({}, exec_lua('return { vim.buf_lines(0):find("qux") }'))
+
+    matches(
+      'buffer has changed since vim.buf_lines%(%) was called',
+      pcall_err(exec_lua, function()
+        local view = vim.buf_lines(0)
+        vim.api.nvim_buf_set_lines(0, 0, 1, true, { 'x' })
+        return view[1]
+      end)
+    )
+  end)
+
   it('vim.str_utf_pos', function()
     exec_lua([[_G.test_text = "xy åäö ɧ 汉语 ↥ 🤦x🦄 å بِيَّ"]])
     local expected_positions = {
@@ -86,6 +86,42 @@ void ui_refresh(void)
     }, get_fold_levels())
   end)
 
+  it('reads fold levels without evaluating foldexpr for every line', function()
+    insert(test_text)
+
+    parse('c')
+
+    exec_lua(function()
+      _G.calls = 0
+      local foldexpr = vim.treesitter.foldexpr
+      vim.treesitter.foldexpr = function(...)
+        _G.calls = _G.calls + 1
+        return foldexpr(...)
+      end
+    end)
+    command('setlocal foldmethod=expr foldexpr=v:lua.vim.treesitter.foldexpr()')
+    poke_eventloop()
+
+    local function foldlevels()
+      return exec_lua(function()
+        local levels = {}
+        for i = 1, vim.api.nvim_buf_line_count(0) do
+          levels[i] = vim.fn.foldlevel(i)
+        end
+        return levels
+      end)
+    end
+
+    local levels = { 1, 1, 1, 1, 2, 2, 2, 1, 1, 2, 2, 2, 2, 2, 3, 3, 3, 2, 1 }
+    eq(levels, foldlevels())
+    eq(1, exec_lua('return _G.calls'))
+
+    -- Any other expression is evaluated, even if it returns the same levels.
+    command([[setlocal foldexpr=v:lua.vim.treesitter.foldexpr()..'']])
+    eq(levels, foldlevels())
+    eq(true, exec_lua('return _G.calls > 19'))
+  end)
+
   it('recomputes fold levels after lines are added/removed', function()
     insert(test_text)
 
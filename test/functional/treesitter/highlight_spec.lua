@@ -932,6 +932,46 @@ describe('treesitter highlighting (C)', function()
     })
   end)
 
+  it('highlights captures of patterns with custom predicates in order', function()
+    insert([[
+      int x = 1;
+      /* a
+         b */
+      int yy = 2;
+    ]])
+
+    exec_lua(function()
+      vim.treesitter.query.add_predicate('is-short?', function(match, _, source, pred)
+        for _, node in ipairs(match[pred[2]]) do
+          if #vim.treesitter.get_node_text(node, source) > 1 then
+            return false
+          end
+        end
+        return true
+      end, { force = true })
+
+      local query = [[
+        (primitive_type) @type
+        (comment) @comment
+        ((identifier) @string (#is-short? @string))
+      ]]
+      vim.treesitter.query.set('c', 'highlights', query)
+      vim.treesitter.highlighter.new(vim.treesitter.get_parser(0, 'c'))
+    end)
+
+    screen:expect({
+      grid = [[
+        {6:int} {26:x} = 1;                                                       |
+        {18:/* a}                                                             |
+        {18:   b */}                                                          |
+        {6:int} yy = 2;                                                      |
+        ^                                                                 |
+        {1:~                                                                }|*12
+                                                                         |
+      ]],
+    })
+  end)
+
   it('highlights applied to first line of closed fold', function()
     insert(hl_text_c)
     exec_lua(function()
@@ -6,6 +6,8 @@ local eq = t.eq
 local exec_lua = n.exec_lua
 local insert = n.insert
 local assert_alive = n.assert_alive
+local matches = t.matches
+local pcall_err = t.pcall_err
 
 before_each(clear)
 
@@ -163,6 +165,48 @@ describe('treesitter node API', function()
     eq(3, lua_eval('child:byte_length()'))
   end)
 
+  it('gets the text and ranges of nodes', function()
+    insert([[
+      int main() {
+        int x = 3;
+      }]])
+
+    exec_lua(function()
+      local root = vim.treesitter.get_parser(0, 'c'):parse()[1]:root()
+      _G.root = root
+      _G.type_node = root:child(0):child(0)
+      _G.body = root:child(0):field('body')[1]
+      _G.source = table.concat(vim.api.nvim_buf_get_lines(0, 0, -1, true), '\n') .. '\n'
+    end)
+
+    eq('int', lua_eval('type_node:text(0)'))
+    eq('{\n  int x = 3;\n}', lua_eval('body:text(vim.api.nvim_get_current_buf())'))
+    eq('{\n  int x = 3;\n}', lua_eval('body:text(source)'))
+    -- the root ends at column 0 of the line after the buffer
+    eq('int main() {\n  int x = 3;\n}', lua_eval('root:text(0)'))
+    eq(lua_eval('vim.treesitter.get_node_text(root, 0)'), lua_eval('root:text(0)'))
+
+    eq({ 0, 0, 0, 3, 0, 11, 2, 1 }, lua_eval('vim.treesitter.get_node_ranges({ type_node, body })'))
+    eq(
+      { 0, 0, 0, 0, 3, 3, 0, 11, 11, 2, 1, 27 },
+      lua_eval('vim.treesitter.get_node_ranges({ type_node, body }, true)')
+    )
+    eq({}, lua_eval('vim.treesitter.get_node_ranges({})'))
+
+    -- NUL characters in the buffer are returned as NUL, like by nvim_buf_get_text().
+    exec_lua(function()
+      vim.api.nvim_buf_set_lines(0, 0, 2, true, { 'i\0t main() {', '  i\0t x = 3;' })
+    end)
+    eq('i\0t', lua_eval('type_node:text(0)'))
+    eq('{\n  i\0t x = 3;\n}', lua_eval('body:text(0)'))
+
+    -- Rows past the end of the buffer are an error.
+    exec_lua(function()
+      vim.api.nvim_buf_set_lines(0, 1, -1, true, {})
+    end)
+    matches('Index out of bounds', pcall_err(lua_eval, 'body:text(0)'))
+  end)
+
   it('child_with_descendant() works', function()
     insert([[
       int main() {
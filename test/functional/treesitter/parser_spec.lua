@@ -168,6 +168,92 @@ describe('treesitter parser API', function()
     eq(true, exec_lua('return parser:parse()[1] == tree2'))
   end)
 
+  it('parses buffer on a worker thread', function()
+    insert([[
+      int main() {
+        int x = 3;
+      }]])
+
+    local function parse_background(end_col)
+      return exec_lua(function()
+        vim.g._ts_background_parsing = true
+        _G.parser = _G.parser or vim.treesitter.get_parser(0, 'c')
+        _G.tree = nil
+        local trees = _G.parser:parse(nil, function(_, trees)
+          _G.tree = trees[1]
+        end)
+        local waited = trees == nil
+        vim.wait(1000, function()
+          return _G.tree ~= nil
+        end)
+        local node = _G.tree:root():descendant_for_range(1, 2, 1, end_col)
+        return { waited, node:type(), { node:range() } }
+      end)
+    end
+
+    eq({ true, 'declaration', { 1, 2, 1, 12 } }, parse_background(12))
+
+    feed('2G7|ay')
+    eq({ true, 'declaration', { 1, 2, 1, 13 } }, parse_background(13))
+
+    -- a synchronous parse while the worker is busy
+    eq(
+      { 1, 2, 1, 13 },
+      exec_lua(function()
+        _G.parser:invalidate()
+        _G.parser:parse(nil, function() end)
+        return { _G.parser:parse()[1]:root():descendant_for_range(1, 2, 1, 13):range() }
+      end)
+    )
+    assert_alive()
+  end)
+
+  it('parses injected languages in parallel on worker threads', function()
+    local lines = {} ---@type string[]
+    for i = 1, 8 do
+      vim.list_extend(lines, { '>lua', ('  local x%d = %d'):format(i, i), '<', '' })
+      vim.list_extend(lines, { '>vim', ('  let g:y%d = %d'):format(i, i), '<', '' })
+    end
+    n.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+
+    local injections = {
+      vimdoc = '((codeblock (language) @injection.language (code) @injection.content) (#set! injection.include-children))',
+    }
+
+    local function parse(background)
+      return exec_lua(function()
+        vim.g._ts_background_parsing = background
+        local parser =
+          require('vim.treesitter.languagetree').new(0, 'vimdoc', { injections = injections })
+        local done = false
+        local trees = parser:parse(true, function()
+          done = true
+        end)
+        local waited = trees == nil
+        vim.wait(1000, function()
+          return done
+        end)
+
+        local result = { waited = waited } ---@type table<string, any>
+        for lang, child in pairs(parser:children()) do
+          local roots = {} ---@type string[]
+          for i = 1, #child:included_regions() do
+            local root = child:trees()[i]:root()
+            roots[i] = table.concat({ root:range() }, ',') .. ' ' .. root:sexpr()
+          end
+          result[lang] = roots
+        end
+        return result
+      end)
+    end
+
+    local expected = parse(false)
+    eq(8, #expected.lua)
+    eq(8, #expected.vim)
+    expected.waited = true
+    eq(expected, parse(true))
+  end)
+
   it('does not crash when editing large files', function()
     insert([[printf("%s", "some text");]])
     feed('yy49999p')
@@ -1341,6 +1427,117 @@ print()
     )
   end)
 
+  it('keeps injected trees when an injection is removed', function()
+    insert(dedent [[
+      >lua
+        local a = {}
+      <
+
+      >lua
+        local b = {}
+      <
+
+      >lua
+        local c = {}
+      <
+
+      >lua
+        local d = {}
+      <
+    ]])
+
+    local injections = {
+      vimdoc = '((codeblock (language) @injection.language (code) @injection.content) (#set! injection.include-children))',
+    }
+
+    exec_lua(function()
+      _G.parser = require('vim.treesitter.languagetree').new(0, 'vimdoc', { injections = injections })
+      _G.parser:parse(true)
+      _G.changed = 0
+      _G.parser:children().lua:register_cbs({
+        on_changedtree = function()
+          _G.changed = _G.changed + 1
+        end,
+      })
+    end)
+
+    -- Delete the second code block: only its tree is dropped, the others are not reparsed.
+    feed('5G4dd')
+    eq(
+      { 3, 1 },
+      exec_lua(function()
+        _G.parser:parse(true)
+        return { #_G.parser:children().lua:trees(), _G.changed }
+      end)
+    )
+
+    eq(
+      exec_lua(function()
+        local parser = require('vim.treesitter.languagetree').new(0, 'vimdoc', { injections = injections })
+        parser:parse(true)
+        return parser:children().lua:included_regions()
+      end),
+      exec_lua(function()
+        return _G.parser:children().lua:included_regions()
+      end)
+    )
+  end)
+
+  it('ignores injection matches without nodes', function()
+    insert(dedent [[
+      >lua
+        local a = {}
+      <
+    ]])
+
+    eq(
+      1,
+      exec_lua(function()
+        local parser = require('vim.treesitter.languagetree').new(0, 'vimdoc', {
+          injections = {
+            vimdoc = '((codeblock) (#set! injection.language "lua"))'
+              .. '((codeblock (code) @injection.content) (#set! injection.language "lua"))',
+          },
+        })
+        parser:parse(true)
+        return #parser:children().lua:included_regions()
+      end)
+    )
+  end)
+
+  it('rescans an injection whose offset range reaches the edited rows', function()
+    insert(dedent [[
+      >lua
+        local a = {}
+      <
+
+      local b = {}
+    ]])
+
+    local injections = {
+      vimdoc = '((codeblock (code) @injection.content) (#set! injection.language "lua")'
+        .. ' (#offset! @injection.content 0 0 2 0))',
+    }
+
+    exec_lua(function()
+      _G.parser = require('vim.treesitter.languagetree').new(0, 'vimdoc', { injections = injections })
+      _G.parser:parse(true)
+    end)
+
+    feed('5GAx<Esc>')
+    eq(
+      exec_lua(function()
+        local parser = require('vim.treesitter.languagetree').new(0, 'vimdoc', { injections = injections })
+        parser:parse(true)
+        return parser:children().lua:included_regions()
+      end),
+      exec_lua(function()
+        _G.parser:parse(true)
+        return _G.parser:children().lua:included_regions()
+      end)
+    )
+  end)
+
   describe('languagetree is_valid()', function()
     before_each(function()
       insert(dedent [[
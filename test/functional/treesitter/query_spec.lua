@@ -130,6 +130,45 @@ void ui_refresh(void)
     eq(3, q(100))
   end)
 
+  it('caches runtime queries on disk with vim.g._ts_query_cache', function()
+    local cache_home = 'Xtest_ts_query_cache'
+    finally(function()
+      n.rmdir(cache_home)
+    end)
+
+    local function get_query()
+      clear({ env = { XDG_CACHE_HOME = cache_home } })
+      return exec_lua(function()
+        vim.g._ts_query_cache = true
+        local before = vim.api.nvim__stats().ts_query_parse_count
+        local query = vim.treesitter.query.get('c', 'highlights')
+        local loaded = vim.api.nvim__stats().ts_query_parse_count - before
+
+        local root = vim.treesitter.get_string_parser('int x;', 'c'):parse()[1]:root()
+        local captures = {}
+        for id, node in query:iter_captures(root, 'int x;') do
+          table.insert(captures, query.captures[id] .. ' ' .. node:type())
+        end
+        return {
+          loaded = loaded,
+          executed = vim.api.nvim__stats().ts_query_parse_count - before,
+          captures = captures,
+          info = vim.inspect(query.info),
+        }
+      end)
+    end
+
+    local first = get_query()
+    eq(1, first.loaded)
+    -- The second session reads the patterns from the cache and only compiles the
+    -- query when it is executed.
+    local second = get_query()
+    eq(0, second.loaded)
+    eq(1, second.executed)
+    eq(first.captures, second.captures)
+    eq(first.info, second.info)
+  end)
+
   it('supports query and iter by capture (iter_captures)', function()
     insert(test_text)
 
@@ -569,6 +608,121 @@ void ui_refresh(void)
     end
   end)
 
+  it('evaluates builtin predicates in the query cursor', function()
+    insert([[
+    int main(void) {
+      int foo_bar = 1;
+      int x = foo_bar + MAX;
+      return x;
+    }
+    ]])
+
+    local query_text = [[
+      ((identifier) @a (#eq? @a "x"))
+      ((identifier) @b (#match? @b "^foo_") (#not-lua-match? @b "^%u+$"))
+      ((identifier) @c (#any-of? @c "MAX" "main") (#is-short? @c))
+      ((identifier) @d (#contains? @d "_b") (#has-parent? @d init_declarator))
+      ((string_literal) @e (#match? @e "[") (#eq? @e "x"))
+    ]]
+
+    local res = exec_lua(function()
+      local query = vim.treesitter.query
+      query.add_predicate('is-short?', function(match, _, source, pred)
+        return #vim.treesitter.get_node_text(match[pred[2]][1], source) <= 4
+      end)
+
+      local q = query.parse('c', query_text)
+      local root = vim.treesitter.get_parser(0, 'c'):parse()[1]:root()
+      local buf_text = table.concat(vim.api.nvim_buf_get_lines(0, 0, -1, true), '\n')
+      local str_root = vim.treesitter.get_string_parser(buf_text, 'c'):parse()[1]:root()
+
+      local function captures(node, source)
+        local r = {}
+        for id, capture in q:iter_captures(node, source) do
+          table.insert(r, q.captures[id] .. ' ' .. vim.treesitter.get_node_text(capture, source))
+        end
+        return r
+      end
+
+      return {
+        -- the regex of the last pattern is invalid, so Lua evaluates it (and reports the error)
+        compiled = q.query:_compiled_predicates(),
+        buf = captures(root, 0),
+        str = captures(str_root, buf_text),
+      }
+    end)
+
+    eq({
+      [1] = { [1] = true },
+      [2] = { [1] = true, [2] = true },
+      [3] = { [1] = true },
+      [4] = { [1] = true, [2] = true },
+    }, res.compiled)
+    local expected = {
+      'c main',
+      'b foo_bar',
+      'd foo_bar',
+      'a x',
+      'b foo_bar',
+      'c MAX',
+      'a x',
+    }
+    eq(expected, res.buf)
+    eq(expected, res.str)
+
+    -- Overriding a builtin predicate disables the native version.
+    eq(
+      { 'a main', 'a foo_bar', 'a x', 'a foo_bar', 'a MAX', 'a x' },
+      exec_lua(function()
+        local query = vim.treesitter.query
+        query.add_predicate('eq?', function()
+          return true
+        end, { force = true })
+        local q = query.parse('c', '((identifier) @a (#eq? @a "x"))')
+        local root = vim.treesitter.get_parser(0, 'c'):parse()[1]:root()
+        local r = {}
+        for id, capture in q:iter_captures(root, 0) do
+          table.insert(r, q.captures[id] .. ' ' .. vim.treesitter.get_node_text(capture, 0))
+        end
+        return r
+      end)
+    )
+  end)
+
+  it('#eq? with a capture fails if it has no nodes, and errors if it has several', function()
+    insert([[
+    int a;
+    int x = 1;
+    int y;
+    ]])
+
+    local function captures(query_text)
+      return exec_lua(function()
+        local q = vim.treesitter.query.parse('c', query_text)
+        local root = vim.treesitter.get_parser(0, 'c'):parse()[1]:root()
+        local r = {}
+        for id, capture in q:iter_captures(root, 0) do
+          table.insert(r, q.captures[id] .. ' ' .. capture:start())
+        end
+        return r
+      end)
+    end
+
+    local pattern = '(declaration type: (_) @t declarator: [(init_declarator) (identifier) @i])'
+    eq({}, captures('(' .. pattern .. ' (#eq? @t @i))'))
+    -- Passes if the first capture has no nodes.
+    eq({ 't 1' }, captures('(' .. pattern .. ' (#eq? @i @t))'))
+    eq({ 't 0', 'i 0', 't 1', 't 2', 'i 2' }, captures('(' .. pattern .. ' (#not-eq? @t @i))'))
+
+    t.matches(
+      '#eq%? does not support comparison with captures on multiple nodes',
+      t.pcall_err(
+        captures,
+        '(translation_unit (declaration type: (_) @t) . (declaration)+ @d (#eq? @t @d))'
+      )
+    )
+  end)
+
   it('supports "all" and "any" semantics for predicates on quantified captures #24738', function()
     local query_all = [[
       (((comment (comment_content))+) @bar
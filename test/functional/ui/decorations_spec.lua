@@ -906,6 +906,75 @@ describe('decorations providers', function()
     ]])
     eq(1, exec_lua('return _G.did_buf'))
   end)
+
+  it('skips on_line when over budget and redraws the window again', function()
+    api.nvim_buf_set_lines(0, 0, -1, true, { 'a', 'b', 'c', 'd', 'e', 'f' })
+    local ns = exec_lua(function()
+      _G.starts = 0
+      local ns = vim.api.nvim_create_namespace('slow')
+      vim.api.nvim_set_decoration_provider(ns, {
+        budget = 5,
+        on_start = function()
+          _G.starts = _G.starts + 1
+        end,
+        on_line = function(_, _, buf, row)
+          -- Only the first line is slow, so only the lines below it are skipped.
+          if row == 0 then
+            vim.uv.sleep(6)
+          end
+          vim.api.nvim_buf_set_extmark(buf, ns, row, 0, {
+            end_col = 1,
+            hl_group = 'ErrorMsg',
+            ephemeral = true,
+          })
+        end,
+      })
+      return ns
+    end)
+    local function stats()
+      for _, s in ipairs(api.nvim__decoration_provider_stats()) do
+        if s.ns_id == ns then
+          return s
+        end
+      end
+    end
+
+    -- The skipped lines are drawn once more, from the first skipped one, and
+    -- get their highlights then.
+    screen:expect([[
+      {2:^a}                                       |
+      {2:b}                                       |
+      {2:c}                                       |
+      {2:d}                                       |
+      {2:e}                                       |
+      {2:f}                                       |
+      {1:~                                       }|
+                                              |
+    ]])
+    eq(2, exec_lua('return _G.starts'))
+    local s = stats()
+    eq(5, s.budget)
+    eq(5, s.skipped_lines)
+    t.ok(s.time_max >= 5e6 and s.time_last < s.time_max and s.time_total >= s.time_max)
+
+    exec_lua(function()
+      vim.api.nvim_set_decoration_provider(ns, {
+        on_line = function() end,
+      })
+    end)
+    command('redraw!')
+    s = stats()
+    eq(0, s.budget)
+    eq(0, s.skipped_lines)
+    t.ok(s.calls > 0)
+
+    t.matches(
+      "Invalid 'budget': out of range",
+      pcall_err(exec_lua, function()
+        vim.api.nvim_set_decoration_provider(ns, { budget = -1 })
+      end)
+    )
+  end)
 end)
 
 describe('decoration_providers', function()
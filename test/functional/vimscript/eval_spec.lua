@@ -16,6 +16,8 @@ local Screen = require('test.functional.ui.screen')
 local mkdir = t.mkdir
 local clear = n.clear
 local eq = t.eq
+local ok = t.ok
+local retry = t.retry
 local exec = n.exec
 local exc_exec = n.exc_exec
 local exec_lua = n.exec_lua
@@ -225,6 +227,42 @@ describe('listing functions using :function', function()
   end)
 end)
 
+describe('calling a user function', function()
+  before_each(clear)
+
+  it('skips empty lines and comments, but not in heredocs or nested functions', function()
+    exec([[
+function Test()
+" comment
+
+let text =<< END
+" not a comment
+
+END
+function Inner()
+" inner comment
+return 1
+endfunction
+try
+" comment
+throw 'oops'
+catch
+return [text, v:throwpoint]
+endtry
+endfunction
+]])
+    eq({ { '" not a comment', '' }, 'function Test, line 13' }, eval('Test()'))
+    eq(
+      [[
+   function Inner()
+1  " inner comment
+2  return 1
+   endfunction]],
+      exec_capture('function Inner')
+    )
+  end)
+end)
+
 it('no double-free in garbage collection #16287', function()
   clear()
   -- Don't use exec() here as using a named script reproduces the issue better.
@@ -263,6 +301,24 @@ it('no double-free in garbage collection #16287', function()
   assert_alive()
 end)
 
+it('garbage collection when idle is skipped unless a reference was dropped', function()
+  clear()
+  command('set updatetime=1')
+  retry(nil, 1000, function()
+    ok(api.nvim__stats().gc_skip_count > 0)
+  end)
+
+  local before = api.nvim__stats()
+  command('let g:l = [] | call add(g:l, g:l) | unlet g:l')
+  retry(nil, 1000, function()
+    ok(api.nvim__stats().gc_count > before.gc_count)
+  end)
+  local after = api.nvim__stats()
+  ok(after.gc_freed > before.gc_freed)
+  ok(after.gc_time_max >= after.gc_time_last)
+  ok(after.gc_time_total >= after.gc_time_last)
+end)
+
 it('no heap-use-after-free with EXITFREE and partial as prompt callback', function()
   clear()
   exec([[
@@ -641,6 +641,26 @@ describe('json_encode() function', function()
     eq('"þÿþ"', fn.json_encode('þÿþ'))
   end)
 
+  it('dumps and parses long strings with special characters anywhere', function()
+    local plain = ('abcdefghij'):rep(5)
+    local escaped = {
+      ['"'] = '\\"',
+      ['\\'] = '\\\\',
+      ['\n'] = '\\n',
+      ['\27'] = '\\u001B',
+      ['\127'] = '\127',
+      ['ફ'] = 'ફ',
+    }
+    for special, json in pairs(escaped) do
+      for _, i in ipairs({ 0, 7, 8, 15, 16, 17, 31, 32, 33, 50 }) do
+        local str = plain:sub(1, i) .. special .. plain:sub(i + 1)
+        local encoded = '"' .. plain:sub(1, i) .. json .. plain:sub(i + 1) .. '"'
+        eq(encoded, fn.json_encode(str))
+        eq(str, fn.json_decode(encoded))
+      end
+    end
+  end)
+
   it('dumps blobs', function()
     eq('[]', eval('json_encode(0z)'))
     eq('[222, 173, 190, 239]', eval('json_encode(0zDEADBEEF)'))
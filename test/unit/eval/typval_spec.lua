@@ -1374,6 +1374,44 @@ describe('typval.c', function()
 
           alloc_log:check({})
         end)
+        itp('indexes long lists for random access', function()
+          local nums = {}
+          for i = 1, 200 do
+            nums[i] = i
+          end
+          local l = list(unpack(nums))
+          local lis = list_items(l)
+
+          local function check()
+            eq(#lis, l.lv_len)
+            for _, n in ipairs({ 0, 150, 3, 180, 70, 120, -1, -100 }) do
+              eq(lis[n >= 0 and n + 1 or #lis + n + 1], lib.tv_list_find(l, n))
+            end
+          end
+
+          check()
+          neq(nil, l.lv_items)
+          eq(200, l.lv_items_len)
+
+          lib.tv_list_append_number(l, 201)
+          lis = list_items(l)
+          eq(201, l.lv_items_len)
+          check()
+
+          lib.tv_list_item_remove(l, lis[100])
+          table.remove(lis, 100)
+          check()
+
+          local tv = lua2typvalt(0)
+          lib.tv_list_insert_tv(l, tv, lis[1])
+          lib.tv_clear(tv)
+          lis = list_items(l)
+          check()
+
+          lib.tv_list_reverse(l)
+          lis = list_items(l)
+          check()
+        end)
       end)
       describe('nr()', function()
         local function tv_list_find_nr(l, n, msg)
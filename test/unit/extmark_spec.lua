@@ -0,0 +1,34 @@
+local t = require('test.unit.testutil')
+local itp = t.gen_itp(it)
+
+local ffi = t.ffi
+local eq = t.eq
+local to_cstr = t.to_cstr
+
+local buffer = t.cimport('./src/nvim/buffer.h')
+local lib = t.cimport('./src/nvim/extmark.h', './src/nvim/marktree.h')
+
+describe('extmark_clear', function()
+  itp('deletes marks whose other side was already deleted', function()
+    local c_file = to_cstr('Xtest-unit-extmark')
+    local buf = buffer.buflist_new(c_file, c_file, 1, buffer.BLN_LISTED)
+    local ns = 1
+    local err = ffi.new('Error[1]')
+    local decor = ffi.new('DecorInline')
+    for i = 0, 2 do
+      lib.extmark_set(buf, ns, nil, i, 0, i + 1, 0, decor, 0, false, false, true, false, err)
+    end
+    eq(6, tonumber(buf.b_marktree[0].n_keys))
+
+    -- Leave the start of the first mark and the end of the second one.
+    local iter = ffi.new('MarkTreeIter[1]')
+    lib.marktree_lookup_ns(buf.b_marktree, ns, 1, true, iter)
+    lib.marktree_del_itr(buf.b_marktree, iter, false)
+    lib.marktree_lookup_ns(buf.b_marktree, ns, 2, false, iter)
+    lib.marktree_del_itr(buf.b_marktree, iter, false)
+    eq(4, tonumber(buf.b_marktree[0].n_keys))
+
+    eq(true, lib.extmark_clear(buf, ns, 0, 0, 100, 0))
+    eq(0, tonumber(buf.b_marktree[0].n_keys))
+  end)
+end)
@@ -645,4 +645,64 @@ describe('marktree', function()
     until not lib.marktree_itr_next_filter(tree, iter, 101, 0, filter)
     eq(tablelength(seen), tablelength(shadow))
   end)
+
+  itp('works with bulk put and delete', function()
+    local tree = ffi.new('MarkTree[1]') -- zero initialized by luajit
+    local iter = ffi.new('MarkTreeIter[1]')
+
+    for i = 1, 200 do
+      put(tree, i, 0, false, i + 100, 5, false)
+    end
+    check_intersections(tree)
+
+    -- big enough to rebuild the tree
+    local n = 1000
+    local pos = ffi.new('int[?]', 4 * n)
+    local expected = {}
+    for j = 0, n - 1 do
+      local row, col = (j * 37) % 500, j % 7
+      local end_row, end_col = row + j % 13, (j * 3) % 11
+      if end_row == row then
+        end_col = col
+      end
+      pos[4 * j], pos[4 * j + 1], pos[4 * j + 2], pos[4 * j + 3] = row, col, end_row, end_col
+      expected[201 + j] = { row, col, end_row, end_col }
+    end
+    lib.marktree_put_bulk_test(tree, ns, 201, pos, n)
+    check_intersections(tree)
+    eq(2 * (200 + n), tonumber(tree[0].n_keys))
+    for id, p in pairs(expected) do
+      local start = lib.marktree_lookup_ns(tree, ns, id, false, iter)
+      local stop = lib.marktree_lookup_ns(tree, ns, id, true, iter)
+      eq(p, { start.pos.row, start.pos.col, stop.pos.row, stop.pos.col })
+    end
+
+    -- small enough to put one at a time
+    pos[0], pos[1], pos[2], pos[3] = 10, 1, 300, 0
+    lib.marktree_put_bulk_test(tree, ns, 1201, pos, 1)
+    check_intersections(tree)
+    eq(2 * (201 + n), tonumber(tree[0].n_keys))
+
+    local ids = ffi.new('uint32_t[?]', 601)
+    for i = 0, 600 do
+      ids[i] = 2 * i + 1
+    end
+    lib.marktree_del_bulk_test(tree, ns, ids, 601)
+    check_intersections(tree)
+    eq(2 * 600, tonumber(tree[0].n_keys))
+    eq(-1, lib.marktree_lookup_ns(tree, ns, 1, false, iter).pos.row)
+    eq(expected[202][1], lib.marktree_lookup_ns(tree, ns, 202, false, iter).pos.row)
+
+    ids[0], ids[1] = 2, 1202
+    lib.marktree_del_bulk_test(tree, ns, ids, 2)
+    check_intersections(tree)
+    eq(2 * 599, tonumber(tree[0].n_keys))
+
+    for i = 0, 600 do
+      ids[i] = 2 * i
+    end
+    lib.marktree_del_bulk_test(tree, ns, ids, 601)
+    lib.marktree_check(tree)
+    eq(0, tonumber(tree[0].n_keys))
+  end)
 end)